@@ -0,0 +1,109 @@
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <functional>
+#include <vector>
+
+#include <JuceHeader.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Micro-benchmark of one DSP stage (Google Benchmark style, without the dependency): set up for a
+// point of its parameter sweep, then run one iteration at a time (typically one audio block) while
+// the runner times each of them (see BenchmarkRunner).
+//
+// A benchmark sweeps the parameter axes it declares, other parameters keep their default value.
+
+class Benchmark
+{
+	public:
+
+		enum Axis
+		{
+			blockSizeAxis = 1,
+			numImagesAxis = 2,
+			ambisonicOrderAxis = 4,
+			numBandsAxis = 8,
+			irSizeAxis = 16
+		};
+
+		struct Parameters
+		{
+			int blockSize = 512; // samples
+			int numImages = 100; // source images (or directions, delay taps...)
+			int ambisonicOrder = 1;
+			int numBands = 3; // frequency bands, 3 or 10
+			int irSize = 0; // FIR length, in samples
+
+			String toString(const int axes) const; // e.g. "block:512/images:100"
+			var toVar(const int axes) const;
+		};
+
+		Benchmark(const String& benchmarkName, const int benchmarkAxes) : name(benchmarkName), axes(benchmarkAxes) {}
+		virtual ~Benchmark() {}
+
+		virtual bool setUp(const Parameters& parameters, String& error) = 0; // not timed, false if unavailable (e.g. missing data file)
+		virtual void run() = 0; // one iteration, timed
+		virtual void tearDown() {} // not timed
+		virtual bool isPerBlock() const { return true; } // iteration renders blockSize samples (real time factor reported)
+
+		const String name; // stage/variant, e.g. "FilterBank/decomposeBuffer"
+		const int axes; // swept Axis flags
+
+		static constexpr double sampleRate = 48000.0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Benchmark)
+};
+
+void createDspBenchmarks(OwnedArray<Benchmark>& benchmarks, const int numRenderThreads); // see DspBenchmarks.cpp
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Run benchmarks over their parameter sweeps, results as JSON: one entry per benchmark and sweep
+// point with its iteration time statistics (ns) and, for per block benchmarks, the real time
+// factor (block duration over mean iteration time). Points that fail to set up are reported with
+// their error message instead.
+
+class BenchmarkRunner
+{
+	public:
+
+		struct Settings
+		{
+			Settings();
+
+			Array<int> blockSizes; // 32 .. 2048
+			Array<int> numImages; // 1 .. 2000
+			Array<int> ambisonicOrders; // 1 .. 7
+			Array<int> numBands; // 3, 10
+			Array<int> irSizes; // HRIR, Ambisonic to binaural decoder
+			double minTime = 0.1; // timed per sweep point, in s
+			int minIterations = 10;
+			String filter; // run benchmarks whose name contains it (all if empty)
+
+			void reduceSweeps(); // ends and middle of each sweep only (quick runs)
+		};
+
+		explicit BenchmarkRunner(const Settings& runSettings) : settings(runSettings) {}
+
+		void run(Benchmark& benchmark, std::function<void(const String&)> progress = nullptr);
+		var getResults() const; // { "context": {...}, "benchmarks": [...] }
+
+	private:
+
+		void runPoint(Benchmark& benchmark, const Benchmark::Parameters& parameters);
+		Array<Benchmark::Parameters> getSweep(const Benchmark& benchmark) const;
+
+		const Settings settings;
+		Array<var> results;
+		std::vector<double> iterationTimes; // ns, scratch
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BenchmarkRunner)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // BENCHMARK_H_INCLUDED
@@ -0,0 +1,192 @@
+#include <algorithm>
+
+#include "Benchmark.h"
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+String Benchmark::Parameters::toString(const int axes) const
+{
+	StringArray tokens;
+	if (axes & blockSizeAxis) { tokens.add("block:" + String(blockSize)); }
+	if (axes & numImagesAxis) { tokens.add("images:" + String(numImages)); }
+	if (axes & ambisonicOrderAxis) { tokens.add("order:" + String(ambisonicOrder)); }
+	if (axes & numBandsAxis) { tokens.add("bands:" + String(numBands)); }
+	if (axes & irSizeAxis) { tokens.add("ir:" + String(irSize)); }
+	return tokens.joinIntoString("/");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+var Benchmark::Parameters::toVar(const int axes) const
+{
+	DynamicObject::Ptr object = new DynamicObject();
+	if (axes & blockSizeAxis) { object->setProperty("block_size", blockSize); }
+	if (axes & numImagesAxis) { object->setProperty("num_images", numImages); }
+	if (axes & ambisonicOrderAxis) { object->setProperty("ambisonic_order", ambisonicOrder); }
+	if (axes & numBandsAxis) { object->setProperty("num_bands", numBands); }
+	if (axes & irSizeAxis) { object->setProperty("ir_size", irSize); }
+	return var(object.get());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+BenchmarkRunner::Settings::Settings()
+{
+	blockSizes = { 32, 64, 128, 256, 512, 1024, 2048 };
+	numImages = { 1, 10, 100, 500, 1000, 2000 };
+	ambisonicOrders = { 1, 2, 3, 4, 5, 6, 7 };
+	numBands = { 3, 10 };
+	irSizes = { 200, AMBI2BIN_IR_LENGTH }; // legacy HRIR set (see HrirStore), Ambisonic to binaural decoder
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BenchmarkRunner::Settings::reduceSweeps()
+{
+	for (auto* values : { &blockSizes, &numImages, &ambisonicOrders })
+	{
+		if (values->size() <= 3) { continue; }
+		Array<int> reduced { values->getFirst(), (*values)[values->size() / 2], values->getLast() };
+		*values = reduced;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Array<Benchmark::Parameters> BenchmarkRunner::getSweep(const Benchmark& benchmark) const
+// Cartesian product of the benchmark axes values
+{
+	Array<Benchmark::Parameters> sweep;
+	sweep.add(Benchmark::Parameters());
+
+	auto expand = [&sweep](const Array<int>& values, int Benchmark::Parameters::* member)
+	{
+		Array<Benchmark::Parameters> expanded;
+		for (auto& parameters : sweep)
+		{
+			for (auto value : values)
+			{
+				Benchmark::Parameters point = parameters;
+				point.*member = value;
+				expanded.add(point);
+			}
+		}
+		sweep.swapWith(expanded);
+	};
+
+	if (benchmark.axes & Benchmark::blockSizeAxis) { expand(settings.blockSizes, &Benchmark::Parameters::blockSize); }
+	if (benchmark.axes & Benchmark::numImagesAxis) { expand(settings.numImages, &Benchmark::Parameters::numImages); }
+	if (benchmark.axes & Benchmark::ambisonicOrderAxis) { expand(settings.ambisonicOrders, &Benchmark::Parameters::ambisonicOrder); }
+	if (benchmark.axes & Benchmark::numBandsAxis) { expand(settings.numBands, &Benchmark::Parameters::numBands); }
+	if (benchmark.axes & Benchmark::irSizeAxis) { expand(settings.irSizes, &Benchmark::Parameters::irSize); }
+	return sweep;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BenchmarkRunner::run(Benchmark& benchmark, std::function<void(const String&)> progress)
+// Run benchmark over its whole sweep (skipped if filtered out), progress called with the name of
+// each sweep point before it runs
+{
+	if (settings.filter.isNotEmpty() && !benchmark.name.contains(settings.filter)) { return; }
+
+	for (auto& parameters : getSweep(benchmark))
+	{
+		if (progress) { progress(benchmark.name + "/" + parameters.toString(benchmark.axes)); }
+		runPoint(benchmark, parameters);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BenchmarkRunner::runPoint(Benchmark& benchmark, const Benchmark::Parameters& parameters)
+// Warm up (caches, crossfades, filter states), then time iterations one by one until both
+// minIterations and minTime are reached
+{
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("name", benchmark.name + "/" + parameters.toString(benchmark.axes));
+	result->setProperty("family", benchmark.name);
+	result->setProperty("params", parameters.toVar(benchmark.axes));
+
+	String error;
+	if (!benchmark.setUp(parameters, error))
+	{
+		result->setProperty("error_occurred", true);
+		result->setProperty("error_message", error);
+		results.add(var(result.get()));
+		return;
+	}
+
+	const int64 ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+	const int64 warmUpEnd = Time::getHighResolutionTicks() + (int64)(0.1 * settings.minTime * ticksPerSecond);
+	for (int i = 0; i < settings.minIterations || Time::getHighResolutionTicks() < warmUpEnd; i++) { benchmark.run(); }
+
+	iterationTimes.clear();
+	const int64 start = Time::getHighResolutionTicks();
+	const int64 end = start + (int64)(settings.minTime * ticksPerSecond);
+	int64 now = start;
+	while ((int)iterationTimes.size() < settings.minIterations || now < end)
+	{
+		const int64 before = now;
+		benchmark.run();
+		now = Time::getHighResolutionTicks();
+		iterationTimes.push_back(1.0e9 * (now - before) / ticksPerSecond);
+	}
+
+	benchmark.tearDown();
+
+	// statistics (ns per iteration)
+	const int numIterations = (int)iterationTimes.size();
+	const double meanTime = 1.0e9 * (now - start) / ticksPerSecond / numIterations;
+	std::sort(iterationTimes.begin(), iterationTimes.end());
+	auto percentile = [this, numIterations](const double p) { return iterationTimes[jmin(numIterations - 1, (int)(p * numIterations))]; };
+
+	result->setProperty("iterations", numIterations);
+	result->setProperty("real_time", meanTime);
+	result->setProperty("min_time", iterationTimes.front());
+	result->setProperty("median_time", percentile(0.5));
+	result->setProperty("p99_time", percentile(0.99));
+	result->setProperty("max_time", iterationTimes.back());
+	result->setProperty("time_unit", "ns");
+	if (benchmark.isPerBlock())
+	{
+		// block duration over time it takes to render it: > 1 if faster than real time
+		const double blockDuration = 1.0e9 * parameters.blockSize / Benchmark::sampleRate;
+		result->setProperty("real_time_factor", blockDuration / meanTime);
+		result->setProperty("worst_real_time_factor", blockDuration / iterationTimes.back());
+	}
+	results.add(var(result.get()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+var BenchmarkRunner::getResults() const
+// Results of all benchmarks run, with the context needed to compare them across versions
+{
+	DynamicObject::Ptr context = new DynamicObject();
+	context->setProperty("date", Time::getCurrentTime().toISO8601(true));
+	context->setProperty("version", ProjectInfo::versionString);
+	context->setProperty("host_name", SystemStats::getComputerName());
+	context->setProperty("os", SystemStats::getOperatingSystemName());
+	context->setProperty("cpu_vendor", SystemStats::getCpuVendor());
+	context->setProperty("mhz_per_cpu", SystemStats::getCpuSpeedInMegaherz());
+	context->setProperty("num_cpus", SystemStats::getNumCpus());
+#if JUCE_DEBUG
+	context->setProperty("build_type", "debug");
+#else
+	context->setProperty("build_type", "release");
+#endif
+	context->setProperty("sample_rate", Benchmark::sampleRate);
+	context->setProperty("min_time", settings.minTime);
+
+	DynamicObject::Ptr root = new DynamicObject();
+	root->setProperty("context", var(context.get()));
+	root->setProperty("benchmarks", results);
+	return var(root.get());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,500 @@
+#include <memory>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Utils.h"
+#include "DelayLine.h"
+#include "FilterBank.h"
+#include "ReverbTail.h"
+#include "DirectivityHandler.h"
+#include "SourceImagesHandler.h"
+#include "OSCHandler.h"
+#include "FIRFilter/FIRFilter.h"
+#include "FIRFilter/MultichannelFIRFilter.h"
+#include "FIRFilter/OouraFFT.h"
+#include "SphericalHarmonic/SphericalHarmonic.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the stages of the audio callback, each fed white noise (fixed seed) so that the
+// timed work matches real signals (no denormals, no all zero shortcuts).
+
+static void fillWithNoise(AudioBuffer<float>& buffer, const int numChannels, const int numSamples)
+{
+	Random random(1234);
+	buffer.setSize(numChannels, numSamples);
+	for (int c = 0; c < numChannels; c++)
+	{
+		float* samples = buffer.getWritePointer(c);
+		for (int i = 0; i < numSamples; i++) { samples[i] = 2.f * random.nextFloat() - 1.f; }
+	}
+}
+
+static std::vector<float> getRandomValues(const int num, const float minValue, const float maxValue, const int64 seed)
+{
+	Random random(seed);
+	std::vector<float> values(num);
+	for (auto& value : values) { value = minValue + (maxValue - minValue) * random.nextFloat(); }
+	return values;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fractional delay taps (linear interpolation), one per source image, as in renderSourceImage
+
+class DelayLineBenchmark : public Benchmark
+{
+	public:
+
+		DelayLineBenchmark() : Benchmark("DelayLine/fillBufferWithPreciselyDelayedChunk", blockSizeAxis | numImagesAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			blockSize = parameters.blockSize;
+			delayLine.prepareToPlay(blockSize, sampleRate);
+			delayLine.setSize(1, (uint)sampleRate);
+			delayLine.clear();
+			fillWithNoise(input, 1, blockSize);
+			output.setSize(1, blockSize);
+			scratch.setSize(1, blockSize);
+			delays = getRandomValues(parameters.numImages, (float)blockSize, 0.5f * (float)sampleRate, 1);
+			return true;
+		}
+
+		void run() override
+		{
+			delayLine.copyFrom(0, input, 0, 0, blockSize);
+			for (auto delay : delays) { delayLine.fillBufferWithPreciselyDelayedChunk(output, 0, 0, 0, delay, blockSize, scratch); }
+			delayLine.incrementWriteIndex(blockSize);
+		}
+
+	private:
+
+		int blockSize = 0;
+		DelayLine<float> delayLine;
+		AudioBuffer<float> input, output, scratch;
+		std::vector<float> delays; // in samples
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Octave band decomposition of each source image (one filter bank state each)
+
+class FilterBankBenchmark : public Benchmark
+{
+	public:
+
+		FilterBankBenchmark() : Benchmark("FilterBank/decomposeBuffer", blockSizeAxis | numImagesAxis | numBandsAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			numImages = parameters.numImages;
+			filterBank.reset(new FilterBank());
+			filterBank->prepareToPlay(parameters.blockSize, sampleRate);
+			filterBank->reserve(numImages);
+			numBands = parameters.numBands;
+			fillWithNoise(input, 1, parameters.blockSize);
+			bands.setSize(NUM_OCTAVE_BANDS, parameters.blockSize);
+			return true;
+		}
+
+		void run() override
+		{
+			for (int j = 0; j < numImages; j++) { filterBank->decomposeBuffer(input, bands, j, numBands); }
+		}
+
+	private:
+
+		int numImages = 0;
+		int numBands = NUM_OCTAVE_BANDS;
+		std::unique_ptr<FilterBank> filterBank;
+		AudioBuffer<float> input, bands;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reverb tail FDN (16 delay lines x 3 bands), bus fed as by the render threads
+
+class ReverbTailBenchmark : public Benchmark
+{
+	public:
+
+		ReverbTailBenchmark() : Benchmark("ReverbTail/extractBusToBuffer", blockSizeAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			reverbTail.reset(new ReverbTail());
+			reverbTail->prepareToPlay(parameters.blockSize, sampleRate);
+			reverbTail->setFdnGains(reverbTail->getFdnGains(std::vector<float>(NUM_OCTAVE_BANDS, 1.5f)));
+			fillWithNoise(busInput, reverbTail->getNumBusChannels(), parameters.blockSize);
+			busInput.applyGain(0.01f);
+			tail.setSize(ReverbTail::fdnOrder, parameters.blockSize);
+			return true;
+		}
+
+		void run() override
+		{
+			reverbTail->addBusBuffers(busInput);
+			reverbTail->extractBusToBuffer(tail);
+		}
+
+	private:
+
+		std::unique_ptr<ReverbTail> reverbTail;
+		AudioBuffer<float> busInput, tail;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Mono FFT convolution, at HRIR and Ambisonic to binaural decoder filter lengths
+
+class FIRFilterBenchmark : public Benchmark
+{
+	public:
+
+		FIRFilterBenchmark() : Benchmark("FIRFilter/process", blockSizeAxis | irSizeAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			filter.init(parameters.blockSize, parameters.irSize);
+			filter.setImpulseResponse(getRandomValues(parameters.irSize, -0.1f, 0.1f, 2).data());
+			input = getRandomValues(parameters.blockSize, -1.f, 1.f, 3);
+			buffer.resize(parameters.blockSize);
+			return true;
+		}
+
+		void run() override
+		{
+			std::copy(input.begin(), input.end(), buffer.begin());
+			filter.process(buffer.data());
+		}
+
+	private:
+
+		FIRFilter filter;
+		std::vector<float> input, buffer;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Ambisonic to binaural decoding of one listener: (order+1)^2 channels in, 2 ears out
+
+class Ambi2binBenchmark : public Benchmark
+{
+	public:
+
+		Ambi2binBenchmark() : Benchmark("MultichannelFIRFilter/ambi2bin", blockSizeAxis | ambisonicOrderAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			const int numAmbiChannels = getNumAmbiChannels(parameters.ambisonicOrder);
+			filter.init(parameters.blockSize, AMBI2BIN_IR_LENGTH, numAmbiChannels, 2);
+			for (int i = 0; i < numAmbiChannels; i++)
+			{
+				for (int ear = 0; ear < 2; ear++)
+				{
+					filter.setImpulseResponse(i, ear, getRandomValues(AMBI2BIN_IR_LENGTH, -0.1f, 0.1f, 2 * i + ear).data());
+				}
+			}
+			fillWithNoise(inputs, numAmbiChannels, parameters.blockSize);
+			outputs.setSize(2, parameters.blockSize);
+			return true;
+		}
+
+		void run() override
+		{
+			filter.process(inputs.getArrayOfReadPointers(), outputs.getArrayOfWritePointers());
+		}
+
+	private:
+
+		MultichannelFIRFilter filter;
+		AudioBuffer<float> inputs, outputs;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Forward + inverse real FFT, of twice the block size (FIR filter with IR as long as the block)
+
+class OouraFFTBenchmark : public Benchmark
+{
+	public:
+
+		OouraFFTBenchmark() : Benchmark("OouraFFT/fftAndIfft", blockSizeAxis) {}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			const int nfft = 2 * parameters.blockSize;
+			fft.init(nfft);
+			input = getRandomValues(nfft, -1.f, 1.f, 4);
+			output.resize(nfft);
+			spectrum.resize(nfft / 2 + 1);
+			return true;
+		}
+
+		void run() override
+		{
+			fft.fft(input.data(), spectrum.data());
+			fft.ifft(spectrum.data(), output.data());
+		}
+
+		bool isPerBlock() const override { return false; }
+
+	private:
+
+		OouraFFT fft;
+		std::vector<float> input, output;
+		ComplexVector<float> spectrum;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Spherical harmonics of all source image directions (scene update), one direction at a time
+// (Calc) or by batches (CalcBatch, as the directivity handler)
+
+class SphericalHarmonicBenchmark : public Benchmark
+{
+	public:
+
+		SphericalHarmonicBenchmark(const bool batch) :
+			Benchmark(batch ? "SphericalHarmonic/CalcBatch" : "SphericalHarmonic/Calc", ambisonicOrderAxis | numImagesAxis),
+			useBatch(batch)
+		{}
+
+		bool setUp(const Parameters& parameters, String&) override
+		{
+			numCoefs = getNumAmbiChannels(parameters.ambisonicOrder);
+			sphericalHarmonic.Init(parameters.ambisonicOrder);
+			azims = getRandomValues(parameters.numImages, (float)-M_PI, (float)M_PI, 5);
+			elevs = getRandomValues(parameters.numImages, (float)(-M_PI / 2), (float)(M_PI / 2), 6);
+			output.resize(parameters.numImages * numCoefs);
+			return true;
+		}
+
+		void run() override
+		{
+			if (useBatch)
+			{
+				sphericalHarmonic.CalcBatch(azims.data(), elevs.data(), (int)azims.size(), output.data(), numCoefs);
+				return;
+			}
+			for (int j = 0; j < azims.size(); j++) { sphericalHarmonic.Calc(azims[j], elevs[j]); }
+		}
+
+		bool isPerBlock() const override { return false; }
+
+	private:
+
+		const bool useBatch;
+		int numCoefs = 0;
+		SphericalHarmonic sphericalHarmonic;
+		std::vector<float> azims, elevs, output;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Source directivity band gains of all source image directions (scene update), from the SH
+// expansion of the pattern or from its lookup tables
+
+class DirectivityBenchmark : public Benchmark
+{
+	public:
+
+		DirectivityBenchmark(const bool sphericalHarmonics) :
+			Benchmark(sphericalHarmonics ? "DirectivityHandler/getGains/sh" : "DirectivityHandler/getGains/table", numImagesAxis | numBandsAxis)
+		{
+			directivityHandler.useSphericalHarmonics = sphericalHarmonics;
+		}
+
+		bool setUp(const Parameters& parameters, String& error) override
+		{
+			if (!isLoaded && !directivityHandler.loadFile("directivity/directional.sofa"))
+			{
+				error = "cannot load directivity/directional.sofa";
+				return false;
+			}
+			isLoaded = true;
+
+			numBands = parameters.numBands;
+			azims = getRandomValues(parameters.numImages, (float)-M_PI, (float)M_PI, 5);
+			elevs = getRandomValues(parameters.numImages, (float)(-M_PI / 2), (float)(M_PI / 2), 6);
+			gains.resize(parameters.numImages * NUM_OCTAVE_BANDS);
+			return true;
+		}
+
+		void run() override
+		{
+			directivityHandler.getGains(azims.data(), elevs.data(), (int)azims.size(), numBands, gains.data(), NUM_OCTAVE_BANDS);
+		}
+
+		bool isPerBlock() const override { return false; }
+
+	private:
+
+		DirectivityHandler directivityHandler;
+		bool isLoaded = false;
+		int numBands = 3;
+		std::vector<float> azims, elevs, gains;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Whole source images rendering of one block (delay taps, filter bank, directivity, Ambisonic
+// encoding, reverb tail) of a single source / listener scene of random source images, set
+// through the OSC scene as the raytracer would (see OSCHandler, offline mode)
+
+class SourceImagesBenchmark : public Benchmark, private OSCHandler::SceneListener
+{
+	public:
+
+		SourceImagesBenchmark(const int renderThreads) :
+			Benchmark("SourceImagesHandler/getNextAudioBlock", blockSizeAxis | numImagesAxis | ambisonicOrderAxis),
+			numRenderThreads(renderThreads)
+		{}
+
+		~SourceImagesBenchmark() { tearDown(); }
+
+		bool setUp(const Parameters& parameters, String& error) override
+		{
+			blockSize = parameters.blockSize;
+
+			// HRIR set loaded by the binaural encoders (throws if missing)
+			try { sourceImagesHandler.reset(new SourceImagesHandler()); }
+			catch (const std::exception& exception)
+			{
+				error = exception.what();
+				return false;
+			}
+			sourceImagesHandler->setAmbisonicOrder(parameters.ambisonicOrder);
+			sourceImagesHandler->setNumRenderThreads(numRenderThreads);
+			sourceImagesHandler->prepareToPlay(blockSize, sampleRate);
+
+			delayLines.clear();
+			delayLines.add(new DelayLine<float>());
+			delayLines[0]->prepareToPlay(blockSize, sampleRate);
+			delayLines[0]->setSize(1, (uint)sampleRate);
+			fillWithNoise(input, 1, blockSize);
+			ambisonicBuffer.setSize(2 + getNumAmbiChannels(parameters.ambisonicOrder), blockSize);
+
+			// scene committed at once, then crossfaded in
+			scene.reset(new OSCHandler(false));
+			scene->setMinCommitInterval(0);
+			scene->setSceneListener(this);
+			sendScene(parameters.numImages);
+			scene->updateScene(1000);
+			if (!sourceImagesHandler->acquireUpdate())
+			{
+				error = "scene not committed";
+				return false;
+			}
+			for (int i = 0; i < 1000 && !sourceImagesHandler->crossfadeOver; i++) { run(); }
+			return true;
+		}
+
+		void run() override
+		{
+			delayLines[0]->copyFrom(0, input, 0, 0, blockSize);
+			sourceImagesHandler->getNextAudioBlock(delayLines, ambisonicBuffer);
+			delayLines[0]->incrementWriteIndex(blockSize);
+		}
+
+		void tearDown() override
+		{
+			if (scene != nullptr) { scene->setSceneListener(nullptr); }
+			scene.reset();
+			sourceImagesHandler.reset();
+		}
+
+	private:
+
+		bool oscSceneUpdated(OSCHandler& handler) override
+		{
+			if (!sourceImagesHandler->isReadyForUpdate()) { return false; }
+			sourceImagesHandler->updateFromOscHandler(handler);
+			return true;
+		}
+
+		void sendScene(const int numImages)
+		// Source, listener, RT60 then numImages source images (direct path first) of a 6 x 4 x 3 m
+		// room, reflection points drawn at random on its walls
+		{
+			const Eigen::Vector3f roomSize(6.f, 4.f, 3.f);
+			const Eigen::Vector3f sourcePosition(2.f, 2.f, 1.5f);
+			const Eigen::Vector3f listenerPosition(4.5f, 2.f, 1.7f);
+			for (int e = 0; e < 2; e++)
+			{
+				OSCMessage message(e == 0 ? "/source" : "/listener");
+				const Eigen::Vector3f& position = e == 0 ? sourcePosition : listenerPosition;
+				message.addString(e == 0 ? "source" : "listener");
+				for (int a = 0; a < 3; a++) { message.addFloat32(position[a]); }
+				for (int k = 0; k < 9; k++) { message.addFloat32(k % 4 == 0 ? 1.f : 0.f); }
+				scene->receiveMessage(message);
+			}
+
+			OSCMessage rt60("/rt60");
+			for (int k = 0; k < NUM_OCTAVE_BANDS; k++) { rt60.addFloat32(1.5f - 0.1f * k); }
+			scene->receiveMessage(rt60);
+
+			// format: [ /in pathID order r1x r1y r1z rNx rNy rNz dist abs1 .. abs10 ]
+			Random random(7);
+			for (int id = 0; id < numImages; id++)
+			{
+				const int order = id == 0 ? 0 : 1 + id % 10;
+				Eigen::Vector3f firstPoint = listenerPosition;
+				Eigen::Vector3f lastPoint = sourcePosition;
+				float pathLength = (listenerPosition - sourcePosition).norm();
+				if (order > 0)
+				{
+					for (int a = 0; a < 3; a++)
+					{
+						firstPoint[a] = random.nextFloat() * roomSize[a];
+						lastPoint[a] = random.nextFloat() * roomSize[a];
+					}
+					firstPoint[id % 3] = (id / 3) % 2 == 0 ? 0.f : roomSize[id % 3]; // on a wall
+					lastPoint[(id + 1) % 3] = (id / 2) % 2 == 0 ? 0.f : roomSize[(id + 1) % 3];
+					pathLength = (firstPoint - sourcePosition).norm() + (listenerPosition - lastPoint).norm() + (float)order * random.nextFloat() * 4.f;
+				}
+
+				OSCMessage message("/in");
+				message.addInt32(id);
+				message.addInt32(order);
+				for (int a = 0; a < 3; a++) { message.addFloat32(firstPoint[a]); }
+				for (int a = 0; a < 3; a++) { message.addFloat32(lastPoint[a]); }
+				message.addFloat32(pathLength);
+				for (int k = 0; k < NUM_OCTAVE_BANDS; k++) { message.addFloat32(1.f - std::pow(1.f - 0.05f * (k + 1), (float)order)); }
+				scene->receiveMessage(message);
+			}
+			scene->receiveMessage(OSCMessage("/frame"));
+		}
+
+		const int numRenderThreads;
+		int blockSize = 0;
+		std::unique_ptr<SourceImagesHandler> sourceImagesHandler;
+		std::unique_ptr<OSCHandler> scene;
+		OwnedArray<DelayLine<float>> delayLines;
+		AudioBuffer<float> input, ambisonicBuffer;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void createDspBenchmarks(OwnedArray<Benchmark>& benchmarks, const int numRenderThreads)
+// All benchmarks, in audio callback order
+{
+	benchmarks.add(new DelayLineBenchmark());
+	benchmarks.add(new FilterBankBenchmark());
+	benchmarks.add(new DirectivityBenchmark(true));
+	benchmarks.add(new DirectivityBenchmark(false));
+	benchmarks.add(new SphericalHarmonicBenchmark(false));
+	benchmarks.add(new SphericalHarmonicBenchmark(true));
+	benchmarks.add(new ReverbTailBenchmark());
+	benchmarks.add(new FIRFilterBenchmark());
+	benchmarks.add(new Ambi2binBenchmark());
+	benchmarks.add(new OouraFFTBenchmark());
+	benchmarks.add(new SourceImagesBenchmark(numRenderThreads));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
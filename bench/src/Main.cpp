@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Micro-benchmarks of the auralisation engine DSP stages (see Benchmark.h),
+    results written as JSON to track performance regressions across versions.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Benchmark.h"
+#include <iostream>
+
+//==============================================================================
+// Options:
+//   --filter <text>          run benchmarks whose name contains text (e.g. FilterBank)
+//   --min-time <s>           time measured per sweep point (default 0.1)
+//   --quick                  first, middle and last values of each sweep only
+//   --render-threads <n>     source images render threads (default 1)
+//   --output <file>          JSON results file (default: standard output)
+//   --list                   list benchmarks and their sweep axes, then quit
+int main (int argc, char* argv[])
+{
+    // message manager: OSC scene change broadcasts (see OSCHandler)
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+    for (int i = 1; i < argc; i++) { args.add (argv[i]); }
+    auto getOption = [&args] (const String & name) -> String
+    {
+        int index = args.indexOf (name);
+        if (index < 0 || index + 1 >= args.size()) { return String(); }
+        return args[index + 1].unquoted();
+    };
+
+    BenchmarkRunner::Settings settings;
+    settings.filter = getOption ("--filter");
+    String minTime = getOption ("--min-time");
+    if (minTime.isNotEmpty()) { settings.minTime = jmax (0.001, minTime.getDoubleValue()); }
+    if (args.contains ("--quick")) { settings.reduceSweeps(); }
+    String numThreads = getOption ("--render-threads");
+
+    OwnedArray<Benchmark> benchmarks;
+    createDspBenchmarks (benchmarks, numThreads.isNotEmpty() ? jmax (1, numThreads.getIntValue()) : 1);
+
+    if (args.contains ("--list"))
+    {
+        for (auto* benchmark : benchmarks)
+        {
+            std::cout << benchmark->name << " " << Benchmark::Parameters().toString (benchmark->axes).replace ("/", " ") << std::endl;
+        }
+        return 0;
+    }
+
+    // progress on standard error, results on standard output unless written to file
+    BenchmarkRunner runner (settings);
+    for (auto* benchmark : benchmarks)
+    {
+        runner.run (*benchmark, [] (const String & name) { std::cerr << name << std::endl; });
+    }
+
+    const String json = JSON::toString (runner.getResults());
+    String outputFile = getOption ("--output");
+    if (outputFile.isEmpty())
+    {
+        std::cout << json << std::endl;
+        return 0;
+    }
+    if (!File::getCurrentWorkingDirectory().getChildFile (outputFile).replaceWithText (json))
+    {
+        std::cerr << "cannot write " << outputFile << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,8 +2,9 @@
 #define AMBI2BINIRCONTAINER_H_INCLUDED
 
 #include <array>
+#include <vector>
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "Utils.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -16,9 +17,14 @@ class Ambi2binIRContainer
 		Ambi2binIRContainer();
 		~Ambi2binIRContainer(){};
 
-		void loadIR(const File& filename);
+		void setAmbisonicOrder(const int order);
+		void loadIR(const File& filename, const int numChannels);
 
-		std::array<std::array<std::array<float, AMBI2BIN_IR_LENGTH>, 2>, N_AMBI_CH> ambi2binIrDict;
+		// [ch x ear x sampID], (order+1)^2 channels. Channels above the order of the loaded decoder
+		// are left with null filters.
+		std::vector<std::array<std::array<float, AMBI2BIN_IR_LENGTH>, 2>> ambi2binIrDict;
+		int ambisonicOrder = 0;
+		int decoderOrder = 0; // order of the decoder file actually loaded
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Ambi2binIRContainer)
 };
@@ -0,0 +1,64 @@
+#ifndef AMBISONICROTATION_H_INCLUDED
+#define AMBISONICROTATION_H_INCLUDED
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Rotation of an Ambisonic sound field (ACN, N3D or SN3D) in the spherical harmonics domain.
+//
+// Source images are encoded once in a world-fixed frame, the listener orientation is applied to
+// the whole sound field once per audio block. The rotation matrix is block diagonal (one
+// (2l+1)x(2l+1) block per order l), computed from the 3x3 rotation matrix with the Ivanic &
+// Ruedenberg recurrence. Blocks are linearly interpolated sample-wise when the rotation changes.
+
+class AmbisonicRotation
+{
+	public:
+
+		AmbisonicRotation();
+		~AmbisonicRotation(){};
+
+		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate);
+		void setOrder(const int order);
+		void setRotation(const Eigen::Matrix3f& rotationMatrix, const bool skipInterpolation);
+		void process(AudioBuffer<float>& buffer, const int startChannel);
+
+		// Fill bands with the SH rotation matrix of order l ((2l+1)x(2l+1), row-major, l in
+		// [0, order]): Y(R * u) = M * Y(u) for any direction u (SPAT convention, see Utils.h)
+		static void computeBandMatrices(const Eigen::Matrix3f& rotationMatrix, const int order, std::vector<std::vector<float>>& bands);
+
+	private:
+
+		static float getCentered(const std::vector<float>& band, const int l, const int m, const int n);
+		static float getP(const std::vector<std::vector<float>>& bands, const int i, const int a, const int b, const int l);
+
+		int ambisonicOrder = AMBI_ORDER;
+
+		// rotation applied at the start of the block (past) and reached at its end (future)
+		std::vector<std::vector<float>> bandsPast;
+		std::vector<std::vector<float>> bandsFuture;
+		bool isIdentity = true;
+
+		// target rotation, set from message thread, read by audio thread (try lock)
+		SpinLock targetLock;
+		Eigen::Matrix3f targetRotationMatrix = Eigen::Matrix3f::Identity();
+		bool targetChanged = false;
+		bool targetSkipInterpolation = false;
+
+		AudioBuffer<float> inputBuffer; // copy of (unrotated) Ambisonic channels
+		AudioBuffer<float> deltaBuffer; // future - past rotated channel
+		std::vector<float> ramp;
+		int rampLength = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AmbisonicRotation)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // AMBISONICROTATION_H_INCLUDED
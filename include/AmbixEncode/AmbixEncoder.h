@@ -25,7 +25,9 @@
 
 #include <iostream>
 #include <array>
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+#include <unordered_map>
+#include <JuceHeader.h>
 #include "SphericalHarmonic/SphericalHarmonic.h"
 #include "../Utils.h"
 #include "ambi_weight_lookup.h"
@@ -46,6 +48,24 @@ SphericalHarmonic sph_h;
 private:
 
 float _azimuth, _elevation, _size; // buffer to realize changes
+int _order; // runtime order, in [1, AMBI_ORDER]
+int _numChannels; // (_order+1)^2, stride of gains arrays
+
+// gain cache, keyed by image id: gains are only recomputed when the (quantised) direction changes
+struct GainCacheEntry
+{
+    int quantAzimuth;
+    int quantElevation;
+    int slot; // index in _gainCachePool (in _numChannels units)
+};
+static constexpr float GAIN_CACHE_STEP = 0.001f; // direction quantisation step (rad)
+std::unordered_map<int64, GainCacheEntry> _gainCache; // source image key -> cached gains
+std::vector<float> _gainCachePool;
+std::vector<int> _gainCacheFreeSlots;
+std::vector<int> _missIndices; // scratch, grow only
+std::vector<float> _missAzimuths, _missElevations, _missGains;
+
+static constexpr float SPREAD_WEIGHT_THRESHOLD = 0.001f; // orders weighted below are skipped
 
 //==========================================================================
 // METHODS
@@ -55,14 +75,35 @@ public:
 AmbixEncoder() :
 size(0.f),
 _azimuth(0.1f),
-_elevation(0.1f)
+_elevation(0.1f),
+_order(0),
+_numChannels(0)
 {
-    sph_h.Init(AMBI_ORDER, true, false); // order, norm(true: N3D, false: SN3D), elevConvention
-    ambi_gain.resize(N_AMBI_CH);
+    setOrder(AMBI_ORDER);
 }
 
 ~AmbixEncoder() {}
 
+void setOrder(int order)
+// not thread safe: cached gains are dropped, gains stride becomes (order+1)^2
+{
+    jassert(order >= 1 && order <= AMBI_ORDER);
+    if (order == _order) { return; }
+    
+    sph_h.Init(order, true, false); // order, norm(true: N3D, false: SN3D), elevConvention
+    _order = order;
+    _numChannels = (order+1)*(order+1);
+    ambi_gain.resize(_numChannels);
+    _azimuth = _elevation = 1111.f;
+    
+    _gainCache.clear();
+    _gainCachePool.clear();
+    _gainCacheFreeSlots.clear();
+}
+
+int getOrder() const { return _order; }
+int getNumChannels() const { return _numChannels; }
+
 Array<float> calcParams(double azimuth, double elevation)
 {
     if (_azimuth != azimuth || _elevation != elevation )
@@ -71,7 +112,7 @@ Array<float> calcParams(double azimuth, double elevation)
         sph_h.Calc(azimuth, elevation);
         
         // set ambisonic gains
-        for( int i=0; i < N_AMBI_CH; ++i ) {
+        for( int i=0; i < _numChannels; ++i ) {
             ambi_gain.set(i, (float)sph_h.Ymn(i));
         }
         
@@ -82,6 +123,126 @@ Array<float> calcParams(double azimuth, double elevation)
     
     return ambi_gain;
 }
+
+void calcParams(const float* azimuths, const float* elevations, int numDirections, float* gains)
+// batch version: gains [direction * _numChannels + channel], no allocation
+{
+    sph_h.CalcBatch(azimuths, elevations, numDirections, gains, _numChannels);
+}
+
+void calcParams(const int64* ids, const float* azimuths, const float* elevations, int numDirections, float* gains)
+// cached batch version: only directions of new images, or images that moved by more than
+// GAIN_CACHE_STEP, are evaluated. Entries of images absent from this call are kept (e.g. images
+// left unchanged since), until released with releaseGains.
+{
+    _missIndices.clear();
+    _missAzimuths.clear();
+    _missElevations.clear();
+    
+    // copy cached gains, list misses
+    for (int j = 0; j < numDirections; j++)
+    {
+        const int quantAzimuth = (int)std::lround(azimuths[j] / GAIN_CACHE_STEP);
+        const int quantElevation = (int)std::lround(elevations[j] / GAIN_CACHE_STEP);
+        auto it = _gainCache.find(ids[j]);
+        if (it != _gainCache.end() && it->second.quantAzimuth == quantAzimuth && it->second.quantElevation == quantElevation)
+        {
+            FloatVectorOperations::copy(gains + j * _numChannels, _gainCachePool.data() + it->second.slot * _numChannels, _numChannels);
+            continue;
+        }
+        _missIndices.push_back(j);
+        _missAzimuths.push_back(azimuths[j]);
+        _missElevations.push_back(elevations[j]);
+    }
+    
+    // evaluate misses at once, store them
+    const int numMisses = (int)_missIndices.size();
+    if (_missGains.size() < numMisses * _numChannels) { _missGains.resize(numMisses * _numChannels); }
+    sph_h.CalcBatch(_missAzimuths.data(), _missElevations.data(), numMisses, _missGains.data(), _numChannels);
+    for (int i = 0; i < numMisses; i++)
+    {
+        const int j = _missIndices[i];
+        FloatVectorOperations::copy(gains + j * _numChannels, _missGains.data() + i * _numChannels, _numChannels);
+        
+        auto inserted = _gainCache.emplace(ids[j], GainCacheEntry());
+        GainCacheEntry& entry = inserted.first->second;
+        if (inserted.second) // new entry
+        {
+            if (_gainCacheFreeSlots.empty())
+            {
+                _gainCacheFreeSlots.push_back((int)_gainCachePool.size() / _numChannels);
+                _gainCachePool.resize(_gainCachePool.size() + _numChannels);
+            }
+            entry.slot = _gainCacheFreeSlots.back();
+            _gainCacheFreeSlots.pop_back();
+        }
+        entry.quantAzimuth = (int)std::lround(azimuths[j] / GAIN_CACHE_STEP);
+        entry.quantElevation = (int)std::lround(elevations[j] / GAIN_CACHE_STEP);
+        FloatVectorOperations::copy(_gainCachePool.data() + entry.slot * _numChannels, _missGains.data() + i * _numChannels, _numChannels);
+    }
+}
+
+void releaseGains(const int64* ids, int numIds)
+// release cache entries of images that disappeared (ids without entry are ignored)
+{
+    for (int j = 0; j < numIds; j++)
+    {
+        auto it = _gainCache.find(ids[j]);
+        if (it == _gainCache.end()) { continue; }
+        _gainCacheFreeSlots.push_back(it->second.slot);
+        _gainCache.erase(it);
+    }
+}
+
+void clearGainCache()
+// release all cache entries (slots kept for reuse)
+{
+    for (auto& entry : _gainCache) { _gainCacheFreeSlots.push_back(entry.second.slot); }
+    _gainCache.clear();
+}
+    
+float getSpreadWeight(int l, float spread) const
+// order weighting window: orders above (1 - spread) * _order are faded out along the
+// ambi_weight_lookup half window (spread in [0, 1], 0: point source)
+{
+    if (spread <= 0.f || l == 0) { return 1.f; }
+    
+    const float position = (float)l / _order;
+    const float start = 1.f - jmin(spread, 1.f);
+    if (position <= start) { return 1.f; }
+    
+    return ambi_weight_lookup[jmin((int)std::lround((position - start) / (1.f - start) * 128.f), 128)];
+}
+
+void applySpread(const float* spreads, int numDirections, float* gains, int* numActiveChannels) const
+// apply per-order spread weights (diagonal, energy preserving) to batch gains
+// [direction * _numChannels + channel]. numActiveChannels receives, per direction, the number
+// of channels up to the highest order left with a non negligible weight (others are zeroed).
+{
+    for (int j = 0; j < numDirections; j++)
+    {
+        numActiveChannels[j] = _numChannels;
+        if (spreads[j] <= 0.f) { continue; }
+        
+        float weights[AMBI_ORDER + 1];
+        float energyIn = 0.f, energyOut = 0.f;
+        for (int l = 0; l <= _order; l++)
+        {
+            weights[l] = getSpreadWeight(l, spreads[j]);
+            energyIn += 2 * l + 1;
+            energyOut += (2 * l + 1) * weights[l] * weights[l];
+        }
+        const float norm = std::sqrt(energyIn / energyOut);
+        
+        for (int l = 0; l <= _order; l++)
+        {
+            float weight = weights[l] * norm;
+            if (weights[l] < SPREAD_WEIGHT_THRESHOLD) { weight = 0.f; }
+            else { numActiveChannels[j] = (l + 1) * (l + 1); }
+            FloatVectorOperations::multiply(gains + j * _numChannels + l * l, weight, 2 * l + 1);
+        }
+    }
+}
     
 };
 
@@ -21,6 +21,7 @@
 #define __ambix_matrix_test__SphericalHarmonic__
 
 #include <iostream>
+#include <vector>
 #include "ShNorm.h"
 #include "ShLegendre.h"
 #include "ShChebyshev.h"
@@ -36,10 +37,16 @@ public:
     
     void Calc(double phi, double theta);
     
+    // batch evaluation in float for numDirections (phi, theta) pairs, Ymn written to
+    // output[direction * outputStride + acn]. No heap allocation (scratch sized in Init).
+    void CalcBatch(const float* phi, const float* theta, int numDirections, float* output, int outputStride);
+    
     void Get(Eigen::VectorXd &GetYmn);
     
     Eigen::VectorXd Ymn;
     
+    static const int BATCH_LANES = 8; // directions processed together (SIMD friendly inner loops)
+    
 private:
     
     int _order;
@@ -53,5 +60,11 @@ private:
     ShLegendre Legendre;
     ShChebyshev Chebyshev;
     
+    // float scratch for CalcBatch: [index][lane]
+    std::vector<float> _normFloat; // Nmn, ACN
+    std::vector<float> _legendreBatch; // P_n^m, m >= 0 at index n*(n+1)+m
+    std::vector<float> _cosBatch; // cos(m*phi)
+    std::vector<float> _sinBatch; // -sin(m*phi) (mtx_sph_h compatibility)
+    
 };
 #endif /* defined(__ambix_matrix_test__SphericalHarmonic__) */
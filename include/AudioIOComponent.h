@@ -20,7 +20,7 @@ class AudioIOComponent :
 		bool loadAudioFile(const File& file);
 		bool openAudioFile();
 		void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
-		void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill);
+		void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill, const int numSources = 1);
 		void saveIR(const AudioBuffer<float>& source, double sampleRate, String fileName);
 
 		AudioTransportSource transportSource;
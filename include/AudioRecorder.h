@@ -13,7 +13,7 @@ class AudioRecorder
 		void stopRecording();
 		bool isRecording() const;
 		void recordBuffer(const float** inputChannelData, int numInputChannels, int numSamples);
-		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate);
+		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate, const unsigned int numChannels);
     
 private:
 
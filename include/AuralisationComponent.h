@@ -34,21 +34,30 @@ private:
 		labelReverbTail,
 		labelCrossfadeFactor,
 		labelNumFrequencyBands,
-		labelSourceDirectivity;
+		labelSourceDirectivity,
+		labelNumBinauralImages,
+		labelAmbisonicOrder,
+		labelMaxSceneUpdateRate,
+		labelSpreadFactor;
 
 	TextButton buttonSaveRIR,
 		buttonClearSourceImage;
 
 	ToggleButton buttonReverbTail,
-		buttonDirectToBinaural;
+		buttonDirectToBinaural,
+		buttonSoundFieldRotation;
 
 	ComboBox comboNumFrequencyBands,
-		comboSourceDirectivity;
+		comboSourceDirectivity,
+		comboAmbisonicOrder,
+		comboMaxSceneUpdateRate;
 
 	Slider sliderDirectPathGain,
 		sliderEarlyReflectionsGain,
 		sliderReverbTailGain,
-		sliderCrossfadeFactor;
+		sliderCrossfadeFactor,
+		sliderNumBinauralImages,
+		sliderSpreadFactor;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
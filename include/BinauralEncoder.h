@@ -1,14 +1,11 @@
 #ifndef BINAURALENCODER_H_INCLUDED
 #define BINAURALENCODER_H_INCLUDED
 
-#include "../JuceLibraryCode/JuceHeader.h"
-#include "FIRFilter/FIRFilter.h"
+#include <array>
 
-#define HRIR_LENGTH 200 // Length of loaded HRIR (in time samples)
-#define AZIM_STEP 5.0f // HRIR spatial grid step
-#define ELEV_STEP 5.0f // HRIR spatial grid step
-#define N_AZIM_VALUES int(360 / AZIM_STEP) // total number of azimuth values in HRIR
-#define N_ELEV_VALUES int(180 / ELEV_STEP) + 1 // total number of elevation values in HRIR
+#include <JuceHeader.h>
+#include "FIRFilter/MultichannelFIRFilter.h"
+#include "HrirStore.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -17,39 +14,59 @@ class BinauralEncoder
 {
 	public:
     
-		BinauralEncoder();
+		BinauralEncoder(){};
 		~BinauralEncoder(){};
 
 		void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
 		void encodeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination);
-		void updateCrossfade();
-		void setPosition(double azim, double elev);
+		void setTargetPosition(double azim, double elev, bool reassigned); // scene thread, see below
     
     float crossfadeStep = 0.1f;
 
 	private:
 
-		void loadHrir(const File& hrirFile);
-    
-		// Buffer to hold the HRIR for a given position
-		using HrirBuffer = std::array<std::array<float, HRIR_LENGTH>, 2 >;
-
-		// Holds all HRIR as loaded from HRIR
-		std::map<int, std::array<HrirBuffer, N_ELEV_VALUES>> hrirDict;
-
-		// Current HRIR data.
-		HrirBuffer hrir;
+		// HRIR set, shared across all encoders
+		SharedResourcePointer<HrirStore> hrirStore;
 
-		// HRIR FIR filters.
-		FIRFilter hrirFir[2];
-		FIRFilter hrirFirFuture[2];
-
-		// Array holding index for HRIR linear interpolation.
-		std::array<int, 2> azimId;
-		std::array<int, 2> elevId;
-
-		// Stereo output buffer.
-		AudioBuffer<float> workingBuffer;
+		void fetchTarget();
+		void updateCrossfade();
+		void reset();
+		void applyDelays(AudioBuffer<float>& destination, const int startSample, const int numSamples);
+		void resampleHrir(const float* input, float* output) const;
+
+		// Scene thread: (min-phase) HRIR data, at HRIR set sample rate, and resampled to the engine
+		// one if they differ (band limited interpolation, see resampleHrir)
+		std::array<std::vector<float>, 2> hrir;
+		std::array<std::vector<float>, 2> hrirResampled;
+		double hrirRateRatio = 1.0; // engine over HRIR set sample rate
+		int hrirLength = 0; // at engine sample rate
+
+		// Per ear delays (ITD), applied after min-phase HRIR filtering. Ramped over each block.
+		std::array<float, 2> delayPast;
+		std::array<float, 2> delayFuture;
+		std::array<float, 2> delayCurrent;
+		std::array<std::vector<float>, 2> delayBuffers; // circular, power of 2 size
+		int delayWriteIndex = 0;
+
+		// HRIR FIR filter (mono in, stereo out), and its zero padded input / outputs for chunks
+		// shorter than a block (see encodeBuffer)
+		MultichannelFIRFilter hrirFir;
+		AudioBuffer<float> chunkBuffer;
+
+		// HRTF past / future (interpolated in frequency domain during crossfade).
+		std::array<ComplexVector<float>, 2> hrtfPast;
+		std::array<ComplexVector<float>, 2> hrtfFuture;
+		ComplexVector<float> hrtfInterp;
+
+		// Target HRTF / ITD, computed by the scene thread (see setTargetPosition) while the encoder
+		// renders, picked up at next encodeBuffer (try lock: left for next block if being written)
+		SpinLock targetLock;
+		std::array<ComplexVector<float>, 2> hrtfTarget;
+		std::array<float, 2> delayTarget;
+		bool targetChanged = false;
+		bool targetReassigned = false;
+		std::array<ComplexVector<float>, 2> hrtfScratch; // scene thread, filled outside of the lock
+		std::array<float, 2> delayScratch;
 
 		// Miscelanneous.
 		double localSampleRate;
@@ -63,4 +80,4 @@ class BinauralEncoder
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-#endif // BINAURALENCODER_H_INCLUDED
\ No newline at end of file
+#endif // BINAURALENCODER_H_INCLUDED
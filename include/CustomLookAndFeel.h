@@ -54,4 +54,13 @@ class CustomLookAndFeel :
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+static Rectangle<int> pad(int x, int y, int width, int height, int hPad = 0, int vPad = 5)
+// Convenience function that returns the coordinates of the padded rectangle.
+{
+	return Rectangle<int>(x + vPad, y + hPad, width - 2 * vPad, height - 2 * hPad);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 #endif // CUSTOMLOOKANDFEEL_H_INCLUDED
\ No newline at end of file
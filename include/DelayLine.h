@@ -1,7 +1,7 @@
 #ifndef DELAYLINE_H_INCLUDED
 #define DELAYLINE_H_INCLUDED
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "Utils.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,7 @@ class DelayLine
 		void incrementWriteIndex(const uint);
 		void fillBufferWithDelayedChunk(AudioBuffer<T>&, const uint, const uint, const uint, const uint, const uint) const;
 		void fillBufferWithPreciselyDelayedChunk(AudioBuffer<T>&, const uint, const uint, const uint, const T, const uint);
+		void fillBufferWithPreciselyDelayedChunk(AudioBuffer<T>&, const uint, const uint, const uint, const T, const uint, AudioBuffer<T>&) const;
 		void clear();
 
 	private:
@@ -195,6 +195,29 @@ void DelayLine<T>::fillBufferWithPreciselyDelayedChunk(AudioBuffer<T>& dest,
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Same as above, with caller provided scratch buffer (1 channel, at least numSamples long) instead
+// of the DelayLine's own, so that several threads may read the DelayLine at once.
+
+template <class T>
+void DelayLine<T>::fillBufferWithPreciselyDelayedChunk(AudioBuffer<T>& dest,
+																											 const uint destChannel,
+																											 const uint destStartSample,
+																											 const uint sourceChannel,
+																											 const T delayInSamples,
+																											 const uint numSamples,
+																											 AudioBuffer<T>& scratch) const
+{
+	fillBufferWithDelayedChunk(dest, destChannel, destStartSample, sourceChannel, static_cast<uint>(delayInSamples), numSamples);
+	fillBufferWithDelayedChunk(scratch, 0, 0, sourceChannel, static_cast<uint>(delayInSamples + 1), numSamples);
+
+	// Apply linear interpolation gains and sum up the result in the dest buffer.
+	T prevGain = delayInSamples - floor(delayInSamples);
+	dest.applyGain(destChannel, destStartSample, numSamples, static_cast<T>(1) - prevGain);
+	dest.addFrom(destChannel, destStartSample, scratch, 0, 0, numSamples, prevGain);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 // Clear the DelayLine.
 
 template <class T>
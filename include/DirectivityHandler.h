@@ -1,8 +1,12 @@
 #ifndef DIRECTIVITYHANDLER_H_INCLUDED
 #define DIRECTIVITYHANDLER_H_INCLUDED
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
 
+#include <JuceHeader.h>
+#include "SphericalHarmonic/SphericalHarmonic.h"
+
+#include <Eigen/Eigen>
 #include <mysofa.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -12,16 +16,27 @@ class DirectivityHandler
 {
 	public:
     
-		DirectivityHandler(){};
+		DirectivityHandler() { sphericalHarmonic.Init(SH_ORDER, true, false); };
 		~DirectivityHandler();
   
-		void loadFile(const String& filenameStr);
-		Array<float> getGains(const double azim, const double elev);
+		bool loadFile(const String& filenameStr);
+		void getGains(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride);
+		void setOrientation(const Eigen::Matrix3f& rotationMatrix);
 		void printGains(const unsigned int bandId, const unsigned int step);
 		struct MYSOFA_EASY* mysofa_open_noNorm(const char* filename, float samplerate, int* filterlength, int* err);
+
+		// evaluate gains from SH expansion of the pattern rather than from the lookup tables (opt-in:
+		// smoothed pattern, gains clamped to the measured range of each band)
+		bool useSphericalHarmonics = false;
     
 	private:
     
+		void computeLookupTables();
+		void fitSphericalHarmonics();
+		void rotateDirections(const float*& azims, const float*& elevs, const int numDirections);
+		void getGainsFromTable(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride) const;
+		void getGainsFromSphericalHarmonics(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride);
+
 		const static int FILTER_LENGTH = 10; // num frequency bands expected
 		int filter_length; // num freq bands in file
 		float sampleRate = 48000; // dummy, just made it fit .sofa file to avoid resampling
@@ -35,7 +50,33 @@ class DirectivityHandler
 		float leftDelay; // dummy
 		float rightDelay; // dummy
 
-		Array<float> dirGains; // [gainReal0 gainReal1 .. gainRealFILTER_LENGTH-1 gainImag0 gainImag1 .. gainImagFILTER_LENGTH-1]
+		// Dense azim / elev grids of (real) band gains, [elev][azim][band] with azim in [0, 360] (last
+		// column duplicates first to avoid wrapping in bilinear reads), one grid per band layout
+		// (10 bands, 3 bands). Empty (omni) until a file is loaded.
+		const static int GRID_STEP_DEG = 2;
+		const static int GRID_N_AZIM = 360 / GRID_STEP_DEG + 1;
+		const static int GRID_N_ELEV = 180 / GRID_STEP_DEG + 1;
+		const static int GRID_STRIDE_10 = 16; // padded so that each grid point starts on a 64 bytes boundary
+		const static int GRID_STRIDE_3 = 4; // padded so that each grid point starts on a 16 bytes boundary
+		std::vector<float> gridStorage10;
+		std::vector<float> gridStorage3;
+		const float* grid10 = nullptr; // aligned pointers in storage
+		const float* grid3 = nullptr;
+		float maxGains10[FILTER_LENGTH]; // max measured gain per band, per band layout
+		float maxGains3[3];
+
+		// SH expansion of the pattern (least-squares fit at load), [coefficient][band] per band
+		// layout, evaluated as one matrix product against the SH basis of all directions
+		const static int SH_ORDER = 4;
+		const static int SH_NUM_COEFS = (SH_ORDER + 1) * (SH_ORDER + 1);
+		Eigen::MatrixXf shCoefs10;
+		Eigen::MatrixXf shCoefs3;
+		SphericalHarmonic sphericalHarmonic;
+		std::vector<float> shBasis; // [direction][coefficient], grows only
+		std::vector<float> rotatedAzims; // directions in pattern frame, grow only
+		std::vector<float> rotatedElevs;
+		Eigen::Matrix3f orientation = Eigen::Matrix3f::Identity(); // pattern rotation (source frame)
+		bool hasOrientation = false;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DirectivityHandler)
 };
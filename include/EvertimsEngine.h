@@ -0,0 +1,133 @@
+#ifndef EVERTIMSENGINE_H_INCLUDED
+#define EVERTIMSENGINE_H_INCLUDED
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+#include "DelayLine.h"
+#include "OSCHandler.h"
+#include "SourceImagesHandler.h"
+#include "StageProfiler.h"
+#include "Ambi2binIRContainer.h"
+#include "FIRFilter/MultichannelFIRFilter.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Auralisation engine without GUI nor audio device: OSC scene, source images rendering (delay
+// lines, absorption / directivity filtering, Ambisonic / binaural encoding, reverb tail) and
+// Ambisonic to binaural decoding, driven by its host through prepare / process. The JUCE app
+// (MainComponent) and the offline renderer (OfflineRenderer) are clients of it, like any other
+// real time host would be (see engine/EvertimsEngine.jucer for the library target).
+//
+// Input channel s feeds source s (sources sorted by name). Outputs are grouped per listener
+// (sorted by name), see getNumChannelsPerListener: its Ambisonic channels (ACN, SN3D) and / or
+// their binaural decoding (direct to binaural source images included). Listeners without output
+// channels are not rendered. Without source images, input 0 is played as is.
+//
+// Realtime engines receive OSC and update their scene on its own thread (see OSCHandler), host
+// driven ones have their scene advanced by the host, at audio time (see commitScene).
+//
+// Threads: prepare, process and commitScene from the audio thread (or while it is held off),
+// setParameter and setSourceDirectivity from any other thread.
+
+class EvertimsEngine : private OSCHandler::SceneListener
+{
+	public:
+
+		enum Mode { realtime, hostDriven };
+		enum OutputFormat { ambisonicOutput, binauralOutput, ambisonicAndBinauralOutput };
+
+		enum Parameter
+		{
+			ambisonicOrder, // 1 .. 7, applied at next prepare
+			outputFormat, // OutputFormat, applied at next prepare
+			numFrequencyBands, // 3 or 10
+			directPathGain, // linear
+			earlyReflectionsGain, // linear
+			reverbTailGain, // linear
+			enableReverbTail, // 0 / 1
+			enableDirectToBinaural, // 0 / 1
+			enableSoundFieldRotation, // 0 / 1
+			numBinauralImages, // 1 .. SourceImagesHandler::maxNumBinauralImages
+			spreadFactor, // 0 .. 1
+			sphericalHarmonicDirectivity, // 0 / 1, directivity gains from SH expansion of the patterns
+			crossfadeFactor, // crossfade step per block, 0 .. 1
+			maxSceneUpdateRate, // per second
+			numRenderThreads // audio thread included, only while process is not running
+		};
+
+		explicit EvertimsEngine(const Mode mode = realtime);
+		~EvertimsEngine();
+
+		void prepare(const double sampleRate, const int blockSize, const int numInputs, const int numOutputs);
+		void process(const float* const* inputs, float** outputs, const int numSamples);
+		void reset();
+		void commitScene();
+		void setParameter(const Parameter parameter, const double value);
+		double getParameter(const Parameter parameter) const;
+		bool setSourceDirectivity(const String& pattern, const int sourceIndex = -1);
+
+		OSCHandler& getScene() { return scene; }
+		StageProfiler& getProfiler() { return profiler; } // disabled by default, host callback stages timed by the host
+		int getNumSources() const { return sourceImagesHandler.getNumSources(); } // audio thread
+		int getNumSourceImages() const { return sourceImagesHandler.numSourceImages; } // audio thread
+		int getAmbisonicOrder() const { return sourceImagesHandler.getAmbisonicOrder(); } // as prepared
+		int getNumChannelsPerListener() const; // for next prepare
+		double getSampleRate() const { return localSampleRate; }
+		int getBlockSize() const { return localBlockSize; }
+
+	private:
+
+		bool oscSceneUpdated(OSCHandler& handler) override;
+		void renderSourceImages(const AudioBuffer<float>& sourceInputs);
+		void writeOutputs(const float* passthroughInput, float** outputs);
+		void updateSceneCommitInterval();
+
+		const Mode mode;
+		OSCHandler scene; // receive OSC messages (realtime) or fed by host, ready them for sourceImagesHandler
+		StageProfiler profiler; // per stage timing of process (see SourceImagesHandler::setProfiler)
+
+		// Settings (see Parameter), those applied at next prepare
+		int nextAmbisonicOrder = AMBI_ORDER;
+		OutputFormat nextOutputFormat = ambisonicOutput;
+		int numFreqBands = 3;
+		int sceneUpdateRate = 30; // max number of source images updates per second
+
+		// Prepared state
+		double localSampleRate = 0.0;
+		int localBlockSize = 0;
+		int numInputChannels = 0;
+		int numOutputChannels = 0;
+		OutputFormat format = ambisonicOutput;
+		int numChannelsPerListener = 0;
+		int numOutputListeners = 0; // listeners with (part of) a group of output channels
+		int64 numSamplesProcessed = 0; // audio time, see commitScene
+
+		// Delay lines (one per source, see SourceImagesHandler::maxNumSources)
+		OwnedArray<DelayLine<float>> delayLines;
+		int numDelayLinesUsed = 0;
+		bool requireDelayLineSizeUpdate = false;
+
+		// Sources images
+		SourceImagesHandler sourceImagesHandler;
+
+		// Buffers: source inputs (missing ones read from silentInput), stereo + Ambisonic channels
+		// per rendered listener, binaural decoding scratch
+		std::vector<float*> sourceInputChannels;
+		AudioBuffer<float> silentInput;
+		AudioBuffer<float> ambisonicBuffer;
+		AudioBuffer<float> binauralBuffer;
+
+		// Ambisonic to binaural decoding, one filter per output listener
+		Ambi2binIRContainer ambi2binContainer;
+		OwnedArray<MultichannelFIRFilter> ambi2binFilters; // (order+1)^2 in x 2 ears out
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EvertimsEngine)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // EVERTIMSENGINE_H_INCLUDED
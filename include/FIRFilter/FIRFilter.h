@@ -3,7 +3,7 @@
 #include <vector>
 #include "OouraFFT.h"
 #include "../Utils.h"
-#include "../JuceLibraryCode/JuceHeader.h" // to use DBG
+#include <JuceHeader.h> // to use DBG
 
 /**
 * Class for fast (FFT based) finite-impulse-response (mono) filtering.
@@ -43,16 +43,71 @@ public:
 private:
 	OouraFFT oouraFFT;
 
-	ComplexVector<float> H_; // transfer function
+	ComplexVector<float> H_; // transfer function (ifft normalization folded in)
 	ComplexVector<float> freqBuffer_; // input's dft buffer
 	std::vector<float> ir_; // impulse response
-	std::vector<float> tail_; // processing tail (buffer for the next block)
-	std::vector<float> timeBuffer_; // buffer of the input samples
+	std::vector<float> inputBuffer_; // zero-padded input (padding is never written to)
+	std::vector<float> timeBuffer_; // ifft output buffer
+	std::vector<float> overlap_; // linear overlap-add buffer (nfft - bufferSize samples)
 
 	size_t irSize_;
 	size_t bufferSize_;
 	size_t nfft_;
 	bool initialized_;
-
-    int currentReadPos_;
 };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Spectral product helpers shared by the FIR filters. Written on interleaved floats rather than
+// std::complex operators so that the compiler vectorises them (no NaN/Inf recovery calls).
+
+inline void complexMultiply(std::complex<float>* dest, const std::complex<float>* a, const std::complex<float>* b, size_t num)
+// dest[i] = a[i] * b[i]
+{
+	float* d = reinterpret_cast<float*>(dest);
+	const float* x = reinterpret_cast<const float*>(a);
+	const float* y = reinterpret_cast<const float*>(b);
+	for (size_t i = 0; i < 2 * num; i += 2)
+	{
+		const float re = x[i] * y[i] - x[i + 1] * y[i + 1];
+		const float im = x[i] * y[i + 1] + x[i + 1] * y[i];
+		d[i] = re;
+		d[i + 1] = im;
+	}
+}
+
+inline void complexMultiplyAdd(std::complex<float>* dest, const std::complex<float>* a, const std::complex<float>* b, size_t num)
+// dest[i] += a[i] * b[i]
+{
+	float* d = reinterpret_cast<float*>(dest);
+	const float* x = reinterpret_cast<const float*>(a);
+	const float* y = reinterpret_cast<const float*>(b);
+	for (size_t i = 0; i < 2 * num; i += 2)
+	{
+		d[i] += x[i] * y[i] - x[i + 1] * y[i + 1];
+		d[i + 1] += x[i] * y[i + 1] + x[i + 1] * y[i];
+	}
+}
+
+inline void overlapAdd(float* out, const float* timeBlock, float* overlap, size_t bufferSize, size_t overlapSize)
+// Linear overlap-add of one ifft block (bufferSize + overlapSize samples): writes the first
+// bufferSize samples (plus pending overlap) to out, then shifts the overlap buffer by bufferSize
+// and accumulates the remaining samples of the block into it. Contiguous vector ops only.
+{
+	// output: head of the block + head of the pending overlap
+	const size_t numOverlapped = jmin(bufferSize, overlapSize);
+	FloatVectorOperations::add(out, timeBlock, overlap, (int)numOverlapped);
+	if (bufferSize > numOverlapped)
+	{
+		FloatVectorOperations::copy(out + numOverlapped, timeBlock + numOverlapped, (int)(bufferSize - numOverlapped));
+	}
+
+	// overlap: discard consumed samples, add the new block's tail
+	const size_t numKept = overlapSize > bufferSize ? overlapSize - bufferSize : 0;
+	if (numKept > 0)
+	{
+		memmove(overlap, overlap + bufferSize, numKept * sizeof(float));
+		FloatVectorOperations::add(overlap, timeBlock + bufferSize, (int)numKept);
+	}
+	FloatVectorOperations::copy(overlap + numKept, timeBlock + bufferSize + numKept, (int)(overlapSize - numKept));
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <complex>
+#include <vector>
+#include "FIRFilter.h"
+#include "OouraFFT.h"
+#include "../Utils.h"
+#include <JuceHeader.h>
+
+/**
+* Class for fast (FFT based) multi-input multi-output finite-impulse-response filtering.
+* Each output is the sum of all inputs convolved with their (input, output) impulse response,
+* e.g. N Ambisonic channels to 2 ears. Every input is transformed once per block and the
+* products are accumulated in the frequency domain, so a block costs numInputs ffts and
+* numOutputs iffts (instead of numInputs * numOutputs of each with separate FIRFilters).
+*/
+class MultichannelFIRFilter
+{
+public:
+	MultichannelFIRFilter();
+	~MultichannelFIRFilter();
+
+	/**
+	* Prepares the filter set for processing. Allocates everything: process() never allocates.
+	*
+	* @param bufferSize size of the input time data
+	* @param irSize size of the impulse responses
+	* @param numInputs number of input channels
+	* @param numOutputs number of output channels
+	*/
+	void init(size_t bufferSize, size_t irSize, size_t numInputs, size_t numOutputs);
+
+	/**
+	* Sets the impulse response from input inputId to output outputId.
+	* It will copy 'irSize' samples from the given array.
+	*/
+	void setImpulseResponse(size_t inputId, size_t outputId, const float* ir);
+
+	/**
+	* Computes the (normalized) transfer function of an impulse response of 'irSize' samples,
+	* in the format expected by setTransferFunction (getNumBins() complex values). Uses its own
+	* FFT scratch: may run on another thread than process() (not concurrently with itself).
+	*/
+	void computeTransferFunction(const float* ir, std::complex<float>* H);
+
+	/**
+	* Sets the transfer function from input inputId to output outputId directly (e.g. for
+	* frequency-domain interpolation between filters). Copies getNumBins() values.
+	*/
+	void setTransferFunction(size_t inputId, size_t outputId, const std::complex<float>* H);
+
+	/**
+	* Filter numInputs channels of bufferSize samples into numOutputs channels (overwritten).
+	* Inputs and outputs must not alias.
+	*/
+	void process(const float* const* inputs, float* const* outputs);
+
+	/**
+	* Resets the internal state of the filters (removes tails from the previous processing block).
+	*/
+	void reset();
+
+	size_t getNumInputs() const { return numInputs_; }
+	size_t getNumOutputs() const { return numOutputs_; }
+	size_t getNumBins() const { return freqBuffer_.size(); }
+
+private:
+	OouraFFT oouraFFT;
+	OouraFFT transferFunctionFFT; // computeTransferFunction scratch, see above
+
+	std::vector<ComplexVector<float>> H_; // transfer functions [input * numOutputs + output]
+	ComplexVector<float> freqBuffer_; // current input's dft buffer
+	std::vector<ComplexVector<float>> accumulators_; // per output spectrum accumulators
+	std::vector<float> ir_; // zero-padded impulse response
+	std::vector<float> inputBuffer_; // zero-padded input (padding is never written to)
+	std::vector<float> timeBuffer_; // ifft output buffer
+	std::vector<std::vector<float>> overlaps_; // per output linear overlap-add buffers
+
+	size_t irSize_;
+	size_t bufferSize_;
+	size_t nfft_;
+	size_t numInputs_;
+	size_t numOutputs_;
+	bool initialized_;
+};
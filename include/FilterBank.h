@@ -2,14 +2,22 @@
 #define FILTERBANK_H_INCLUDED
 
 #include <array>
-#include <vector>
+#include <atomic>
+#include <memory>
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "Utils.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Octave band decomposition of source images, one filter bank per source image (stateful filters).
+//
+// Filter banks are allocated by chunks on the scene thread (see reserve) before it publishes a
+// render state with more source images, and never move nor get freed until destruction: render
+// threads may use them meanwhile. The band layout (3 or 10 bands) is part of the render state,
+// passed to decomposeBuffer: each filter bank switches to it the first time it sees it.
+
 class FilterBank
 {
 	public:
@@ -18,26 +26,30 @@ class FilterBank
 		~FilterBank() {};
 
 		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate);
-		void setNumFilters(const unsigned int numBands, const unsigned int numSourceImages);
-		void _setNumFilters(const unsigned int numBands, const unsigned int numSourceImages);
-		void decomposeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination, const unsigned int sourceImageId);
-    
-		int numOctaveBands = 0;
-		int numIndptStream = 0;
+		void reserve(const int numSourceImages); // scene thread
+		int getNumFilterBanks() const { return numFilterBanks.load(std::memory_order_acquire); }
+		void decomposeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination, const int sourceImageId, const int numBands);
+
+		static const int maxNumSourceImages = 1 << 16; // source images beyond are not decomposed
 
 	private:
 
+		// Filters of a source image, and band layout their coefficients are set for (0: none yet)
+		struct SourceImageFilters
+		{
+			std::array<IIRFilter, NUM_OCTAVE_BANDS - 1> filters;
+			int numBands = 0;
+		};
+		static const int chunkSize = 256;
+
 		double localSampleRate;
 		int localSamplesPerBlockExpected;
 
-		int _numOctaveBands = 0;
-		int _numIndptStream = 0;
-		bool updateRequired = false;
-
-		std::vector<std::array<IIRFilter, NUM_OCTAVE_BANDS - 1>> octaveFilterBanks;
+		std::array<IIRCoefficients, NUM_OCTAVE_BANDS - 1> coefficients10; // 10 bands layout
+		std::array<IIRCoefficients, 2> coefficients3; // 3 bands layout
 
-		AudioBuffer<float> bufferFiltered;
-		AudioBuffer<float> bufferRemains;
+		std::array<std::unique_ptr<SourceImageFilters[]>, maxNumSourceImages / chunkSize> chunks;
+		std::atomic<int> numFilterBanks { 0 }; // allocated in chunks, written by scene thread only
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterBank)
 };
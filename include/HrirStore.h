@@ -0,0 +1,104 @@
+#ifndef HRIRSTORE_H_INCLUDED
+#define HRIRSTORE_H_INCLUDED
+
+#include <vector>
+#include <memory>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// HRIR set shared by all binaural encoders (use through SharedResourcePointer<HrirStore>, so that
+// the file is read once, whatever the number of encoders).
+//
+// Sets are loaded from SOFA files (any measurement grid) or from the legacy 5deg grid .bin format,
+// then serialised next to the source file to a flat binary cache (see CacheHeader) which is memory
+// mapped on later startups. Lookup relies on a k-d tree over measurement directions, returning the
+// 3 vertices of the (nearest) enclosing triangle along with their barycentric weights.
+//
+// HRIR are stored as minimum-phase filters plus a separate (fractional) onset delay per ear, so
+// that interpolating between positions blends filters without comb filtering, the interaural
+// time difference being applied as a delay by the encoder.
+
+class HrirStore
+{
+	public:
+
+		HrirStore();
+		~HrirStore(){};
+
+		bool loadFile(const File& hrirFile);
+		int getNeighbours(double azim, double elev, int* ids, float* weights) const;
+		void getInterpolatedHrir(double azim, double elev, float* left, float* right, float* earDelays) const;
+
+		const float* getHrir(const int positionId, const int earId) const;
+		const float* getDelays(const int positionId) const { return delays + 2 * positionId; }
+		const float* getPosition(const int positionId) const { return positions + 3 * positionId; }
+		int getNumPositions() const { return numPositions; }
+		int getHrirLength() const { return hrirLength; }
+		float getSampleRate() const { return sampleRate; }
+		float getMaxDelay() const { return maxDelay; }
+
+		static const int maxNumNeighbours = 3;
+		static const int numCandidates = 24; // nearest positions searched for an enclosing triangle
+
+	private:
+
+		// Flat binary cache layout: header, positions (unit vectors xyz, SOFA convention), delays
+		// [position][ear] (in samples) then min-phase HRIR data [position][ear][sample], each
+		// block starting on a cacheAlignment boundary.
+		struct CacheHeader
+		{
+			char magic[8];
+			uint32 version;
+			uint32 numPositions;
+			uint32 hrirLength;
+			uint32 hrirStride; // hrirLength rounded up to alignment
+			float sampleRate;
+			uint32 positionsOffset;
+			uint32 delaysOffset;
+			uint32 dataOffset;
+			int64 sourceSize; // to detect outdated cache
+			int64 sourceModificationTime; // to detect outdated cache
+		};
+
+		static const int cacheAlignment = 64; // bytes
+		static const uint32 cacheVersion = 2;
+
+		bool loadSofa(const File& sofaFile, std::vector<float>& pos, std::vector<float>& data, int& length, float& rate);
+		bool loadLegacyGrid(const File& binFile, std::vector<float>& pos, std::vector<float>& data, int& length, float& rate);
+		void decomposeMinPhase(std::vector<float>& data, std::vector<float>& dels, int& length);
+		bool writeCache(const File& cacheFile, const File& sourceFile, const std::vector<float>& pos, const std::vector<float>& dels, const std::vector<float>& data, const int length, const float rate);
+		bool mapCache(const File& cacheFile, const File& sourceFile);
+		void useInMemory(std::vector<float>& pos, std::vector<float>& dels, std::vector<float>& data, const int length, const float rate);
+		void updateMaxDelay();
+
+		void buildTree(const int begin, const int end, const int depth);
+		void searchTree(const int begin, const int end, const int depth, const float* query, int* ids, float* dists, int& numFound) const;
+
+		// HRIR set, either pointing to mapped cache or to in-memory fallback (cache not writable)
+		std::unique_ptr<MemoryMappedFile> mappedCache;
+		std::vector<float> positionsInMemory;
+		std::vector<float> delaysInMemory;
+		std::vector<float> hrirDataInMemory;
+		const float* positions = nullptr;
+		const float* delays = nullptr;
+		const float* hrirData = nullptr;
+		int numPositions = 0;
+		int hrirLength = 0;
+		int hrirStride = 0;
+		float sampleRate = 48000.f;
+		float maxDelay = 0.f;
+
+		// k-d tree (implicit, median split): permutation of position ids
+		std::vector<int> tree;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HrirStore)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // HRIRSTORE_H_INCLUDED
@@ -0,0 +1,77 @@
+#ifndef IMAGESOURCEFRAME_H_INCLUDED
+#define IMAGESOURCEFRAME_H_INCLUDED
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Complete set of source images of one frame, received in binary form as an alternative to one
+// /in (or /upd) OSC message per image: [ /frame blob ]. The blob holds a header followed by packed
+// records, all values little endian:
+//
+//   header (24 bytes): char magic[4] "EVIS", uint16 version, uint16 recordSize, uint32 frameId,
+//                      uint32 numImages (in frame), uint32 firstImage, uint32 numRecords (in blob)
+//   record (76 bytes): int32 id, int32 reflectionOrder, float32 r1[3], float32 rN[3],
+//                      float32 totalPathDistance, float32 absorption[10]
+//
+// A frame larger than a datagram is split over several blobs sharing the same frameId, sent in
+// order (firstImage of one blob = firstImage + numRecords of the previous one). Later versions may
+// append fields to records: recordSize is the stride, fields unknown to the decoder are skipped.
+//
+// Records are decoded straight into preallocated per-field arrays (structure of arrays), no
+// allocation once sized for the largest frame received.
+
+class ImageSourceFrame
+{
+	public:
+
+		ImageSourceFrame();
+		~ImageSourceFrame(){};
+
+		// Decode blob into frame, false if invalid. Blob of another frameId restarts the frame.
+		bool decodeBlob(const void* data, const size_t size);
+		bool isComplete() const { return numReceived == numImages; }
+
+		int getNumImages() const { return numImages; }
+		uint32 getFrameId() const { return frameId; }
+
+		// Per image fields (index in [0, getNumImages()))
+		const int* getIds() const { return ids.data(); }
+		const int* getReflectionOrders() const { return reflectionOrders.data(); }
+		const float* getPositionsFirst() const { return positionsFirst.data(); } // [image][xyz]
+		const float* getPositionsLast() const { return positionsLast.data(); } // [image][xyz]
+		const float* getPathDistances() const { return pathDistances.data(); }
+		const float* getAbsorptions() const { return absorptions.data(); } // [image][band]
+
+		static const uint16 formatVersion = 1;
+		static const int headerSize = 24; // bytes
+		static const int recordSize = 76; // bytes, version 1
+		static const int maxNumImages = 1 << 16; // sanity check on header
+
+	private:
+
+		void setNumImages(const int newNumImages);
+		static float readFloat(const uint8* data);
+
+		int numImages = 0;
+		int numReceived = 0; // images decoded so far (blobs received in order)
+		uint32 frameId = 0;
+
+		std::vector<int> ids;
+		std::vector<int> reflectionOrders;
+		std::vector<float> positionsFirst;
+		std::vector<float> positionsLast;
+		std::vector<float> pathDistances;
+		std::vector<float> absorptions;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageSourceFrame)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // IMAGESOURCEFRAME_H_INCLUDED
@@ -0,0 +1,104 @@
+#ifndef LOCKFREE_H_INCLUDED
+#define LOCKFREE_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <JuceHeader.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Wait-free single producer / single consumer queue of (POD) items, fixed capacity allocated at
+// construction. push() and pop() must each be called from a single thread.
+
+template <typename T>
+class SpscQueue
+{
+	public:
+
+		SpscQueue(const int capacity) : fifo(capacity + 1), items(capacity + 1) {} // AbstractFifo keeps one slot free
+		~SpscQueue(){};
+
+		bool push(const T& item)
+		// Producer thread: returns false (item dropped) if queue is full
+		{
+			int start1, size1, start2, size2;
+			fifo.prepareToWrite(1, start1, size1, start2, size2);
+			if (size1 + size2 < 1) { return false; }
+			items[size1 > 0 ? start1 : start2] = item;
+			fifo.finishedWrite(1);
+			return true;
+		}
+
+		bool pop(T& item)
+		// Consumer thread: returns false if queue is empty
+		{
+			int start1, size1, start2, size2;
+			fifo.prepareToRead(1, start1, size1, start2, size2);
+			if (size1 + size2 < 1) { return false; }
+			item = items[size1 > 0 ? start1 : start2];
+			fifo.finishedRead(1);
+			return true;
+		}
+
+		int getNumReady() const { return fifo.getNumReady(); }
+
+	private:
+
+		AbstractFifo fifo;
+		std::vector<T> items;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpscQueue)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Triple buffer: the producer fills the back buffer then publishes it, the consumer acquires the
+// latest published buffer (intermediate ones are skipped). Buffer exchange is a single atomic
+// swap on either side, the producer never writes a buffer the consumer holds.
+
+template <typename T>
+class TripleBuffer
+{
+	public:
+
+		TripleBuffer(){};
+		~TripleBuffer(){};
+
+		T& getWriteBuffer() { return buffers[backIndex]; } // producer
+		T& getReadBuffer() { return buffers[frontIndex]; } // consumer
+
+		void publish()
+		// Producer: hand back buffer over to consumer, get a free one in exchange
+		{
+			backIndex = middleIndex.exchange(backIndex | newFlag) & indexMask;
+		}
+
+		bool acquire()
+		// Consumer: switch read buffer to latest published one, false if nothing new
+		{
+			if ((middleIndex.load() & newFlag) == 0) { return false; }
+			frontIndex = middleIndex.exchange(frontIndex) & indexMask;
+			return true;
+		}
+
+	private:
+
+		static const int newFlag = 4;
+		static const int indexMask = 3;
+
+		std::array<T, 3> buffers;
+		std::atomic<int> middleIndex { 1 };
+		int frontIndex = 0;
+		int backIndex = 2;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TripleBuffer)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // LOCKFREE_H_INCLUDED
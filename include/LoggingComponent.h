@@ -17,6 +17,8 @@ public:
 	~LoggingComponent() {};
 
 	void updateLoggingText(const String& text);
+	void updateProfilingText(const String& text);
+	void setProfilingState(bool enable);
 
 	LedComponent ledClipping;
 
@@ -31,11 +33,15 @@ private:
 		labelClipping;
 
 	ToggleButton buttonEnableLogs,
-		buttonRecordAmbisonicToDisk;
+		buttonRecordAmbisonicToDisk,
+		buttonCaptureOsc,
+		buttonEnableProfiling;
 
-	TextButton buttonSaveOscState;
+	TextButton buttonSaveOscState,
+		buttonLoadOscState;
 
-	TextEditor textLogging;
+	TextEditor textLogging,
+		textProfiling;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -6,14 +6,10 @@
 #include <unordered_map>
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#include "OSCHandler.h"
+#include "EvertimsEngine.h"
 #include "AudioIOComponent.h"
 #include "AudioRecorder.h"
-#include "Ambi2binIRContainer.h"
-#include "FIRFilter/FIRFilter.h"
 #include "Utils.h"
-#include "DelayLine.h"
-#include "SourceImagesHandler.h"
 #include "AuralisationComponent.h"
 #include "LoggingComponent.h"
 
@@ -38,7 +34,6 @@ class MainComponent :
 		void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) override;
 		void releaseResources() override;
     
-		void processAmbisonicBuffer( AudioBuffer<float> *const audioBufferToFill );
 		void fillNextAudioBlock( AudioBuffer<float> *const audioBufferToFill );
 		void recordAmbisonicBuffer();
 		void recordIr();
@@ -51,17 +46,32 @@ class MainComponent :
     
 		void enableReverbTail(bool enable);
 		void enableDirectToBinaural(bool enable);
+		void enableSoundFieldRotation(bool enable);
+		void updateNumBinauralImages(int value);
 		void saveRIR();
 		void clearSourceImage();
 		void updateNumFrequencyBands(int value);
-		void updateSourceDirectivity(String value);
+		void updateAmbisonicOrder(int value);
+		void updateSourceDirectivity(String value, int sourceIndex = -1);
+		void setNumRenderThreads(int value);
+		void enableSphericalHarmonicDirectivity(bool enable);
 		void updateDirectPathGain(double value);
 		void updateEarlyReflectionsGain(double value);
 		void updateReverbTailGain(double value);
+		void updateSpreadFactor(double value);
 		void updateCrossfadeFactor(double value);
+		void updateMaxSceneUpdateRate(int value);
 		String getLogs(bool enable);
 		void enableRecordAmbisonicToDisk(bool enable);
+		void enableProfiling(bool enable);
+		bool sendProfilingStats(const String& host, int port);
 		void saveOscState();
+		void loadOscState();
+		bool loadOscState(const File& stateFile);
+		bool enableOscCapture(bool enable);
+		bool startOscCapture(const File& captureFile);
+		bool startOscReplay(const File& captureFile, double speed, bool inProcess);
+		bool startSceneGenerator(const SceneGenerator::Settings& settings, bool inProcess);
 
 		AudioDeviceSelectorComponent audioSetupComponent;
 
@@ -72,9 +82,9 @@ private:
     float clipOutput(float input);
     
     // Miscellaneaous.
-    double localSampleRate;
-    int localSamplesPerBlockExpected;
-    OSCHandler oscHandler; // receive OSC messages, ready them for other components
+    double localSampleRate = 0.0;
+    int localSamplesPerBlockExpected = 0;
+    EvertimsEngine engine; // OSC scene + auralisation, see EvertimsEngine
     bool isRecordingIr = false;
     
     // GUI elements.
@@ -96,35 +106,21 @@ private:
     // Audio components.
 
     // Buffers
-    AudioBuffer<float> workingBuffer; // working buffer
+    AudioBuffer<float> outputBuffer; // engine output, Ambisonic channels of each listener
     AudioBuffer<float> recordingBufferOutput; // recording buffer
     AudioBuffer<float> recordingBufferAmbisonicOutput; // recording buffer
     AudioBuffer<float> recordingBufferInput; // recording buffer
     
-    // Audio player (GUI + audio reader + adc input)
+    // Audio player (GUI + audio reader + adc input), one input channel per source
     AudioIOComponent audioIOComponent;
+    AudioBuffer<float> inputBuffer;
     
     // Audio stream recorder
     AudioRecorder audioRecorder;
     
-    // Delay line
-    DelayLine<float> delayLine;
-    bool requireDelayLineSizeUpdate = false;
-   
-    // Sources images
-    SourceImagesHandler sourceImagesHandler;
-    bool sourceImageHandlerNeedsUpdate = false;
-    
-    // Ambisonic to binaural decoding
-    AudioBuffer<float> ambisonicBuffer;
+    // Ambisonic recording
     AudioBuffer<float> ambisonicRecordBuffer;
-    AudioBuffer<float> ambisonicBuffer2ndEar;
-    Ambi2binIRContainer ambi2binContainer;
-    FIRFilter ambi2binFilters[2*N_AMBI_CH]; // holds current ABIR (room reverb) filters
-    
-    // Frequency band
-    int numFreqBands = 0;
-    bool updateNumFreqBandrequired = false;
+    int ambisonicOrder = AMBI_ORDER; // applied at next prepareToPlay
    
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
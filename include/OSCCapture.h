@@ -0,0 +1,143 @@
+#ifndef OSCCAPTURE_H_INCLUDED
+#define OSCCAPTURE_H_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <JuceHeader.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Capture of incoming OSC traffic to a binary file, played back later (in process or over UDP)
+// so that scene update load can be reproduced without a raytracer.
+//
+// File layout (little endian): char magic[8] "EVOSCCAP", uint32 version, then one record per
+// received packet: uint32 size (of what follows), float64 time (ms since capture start), element.
+// Element: uint8 'm' + message or uint8 '#' + bundle. Message: string address, uint32 numArgs,
+// then per argument uint8 type ('i', 'f', 's' or 'b') and value (string and blob: uint32 size +
+// bytes). Bundle: uint64 raw time tag, uint32 numElements, then elements.
+
+struct OSCCaptureFormat
+{
+	static const char* magic() { return "EVOSCCAP"; }
+	static const uint32 version = 1;
+	static const int headerSize = 12; // bytes
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Packets are serialised on the receiver thread into a lock-free ring buffer, written to disk by
+// a background thread (packets dropped if the disk can't keep up, see getNumDroppedPackets).
+
+class OSCCaptureWriter : private Thread
+{
+	public:
+
+		OSCCaptureWriter();
+		~OSCCaptureWriter();
+
+		bool start(const File& captureFile);
+		void stop();
+		bool isCapturing() const { return capturing; }
+		int getNumDroppedPackets() const { return numDroppedPackets; }
+
+		// Receiver thread
+		void write(const OSCMessage& message);
+		void write(const OSCBundle& bundle);
+
+	private:
+
+		void run() override;
+		void writeRecord();
+		void drain();
+
+		void appendMessage(const OSCMessage& message);
+		void appendBundle(const OSCBundle& bundle);
+		void appendString(const String& string);
+		void appendData(const void* data, const size_t size);
+		void appendUint32(const uint32 value);
+		void appendUint64(const uint64 value);
+
+		static const int ringSize = 1 << 22; // bytes
+
+		std::unique_ptr<FileOutputStream> stream;
+		SpinLock writeLock; // held by receiver thread while writing a packet, taken by start / stop
+		std::atomic<bool> capturing { false };
+		std::atomic<int> numDroppedPackets { 0 };
+		double startTime = 0.0; // ms
+
+		std::vector<uint8> record; // receiver thread scratch
+		AbstractFifo ringFifo { ringSize };
+		std::vector<uint8> ring;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OSCCaptureWriter)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Plays a capture back, either to a Target (in process) or as UDP packets sent to a local port.
+// Speed: 1 for original timing, > 1 accelerated, 0 as fast as the target accepts packets.
+// Offline replay (see openOffline) has no player thread: the caller pulls packets (playNext) on
+// its own time base, e.g. audio time when rendering to file.
+
+class OSCCapturePlayer : private Thread
+{
+	public:
+
+		class Target
+		{
+			public:
+				virtual ~Target(){};
+				virtual void replayMessage(const OSCMessage& message) = 0;
+				virtual void replayBundle(const OSCBundle& bundle) = 0;
+				// Back pressure, polled before each packet (max speed replay)
+				virtual bool isReadyForReplay() { return true; }
+		};
+
+		OSCCapturePlayer();
+		~OSCCapturePlayer();
+
+		bool start(const File& captureFile, const double playbackSpeed, Target* replayTarget);
+		bool start(const File& captureFile, const double playbackSpeed, const int udpPort);
+		void stop();
+		bool isPlaying() const { return isThreadRunning(); }
+		bool openOffline(const File& captureFile, Target* replayTarget);
+		bool playNext(const double maxTime);
+		int getNumPacketsPlayed() const { return numPacketsPlayed; }
+
+	private:
+
+		bool open(const File& captureFile, const double playbackSpeed);
+		void run() override;
+		bool readRecord();
+		bool playRecord(const uint8* data, const uint8* end);
+
+		// Record decoding, data advanced past what was read, false if record truncated
+		static bool readMessage(const uint8*& data, const uint8* end, OSCMessage& message);
+		static bool readBundle(const uint8*& data, const uint8* end, OSCBundle& bundle);
+		static bool readString(const uint8*& data, const uint8* end, String& string);
+		static bool readBytes(const uint8*& data, const uint8* end, const uint8*& bytes, const size_t size);
+		static bool readUint32(const uint8*& data, const uint8* end, uint32& value);
+		static bool readUint64(const uint8*& data, const uint8* end, uint64& value);
+
+		std::unique_ptr<FileInputStream> stream;
+		double speed = 1.0;
+		Target* target = nullptr;
+		OSCSender sender;
+		std::atomic<int> numPacketsPlayed { 0 };
+		MemoryBlock record;
+		uint32 recordSize = 0; // bytes, time included
+		double recordTime = 0.0; // ms since capture start
+		bool recordPending = false; // offline replay: record read, not played yet (see playNext)
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OSCCapturePlayer)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // OSCCAPTURE_H_INCLUDED
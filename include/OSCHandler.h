@@ -1,53 +1,250 @@
 #ifndef OSCHANDLER_H_INCLUDED
 #define OSCHANDLER_H_INCLUDED
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "Utils.h"
-#include <map>
+#include "LockFree.h"
+#include "ImageSourceFrame.h"
+#include "SourceImageStore.h"
+#include "OSCCapture.h"
+#include "SceneGenerator.h"
+#include "OSCStateFile.h"
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+// OSC messages are parsed on the receiver thread into POD scene deltas, handed over to the scene
+// update thread through a wait-free queue. The scene thread applies them to the future scene,
+// then lets its SceneListener read the (swapped) current scene. Getters below are to be called
+// from the scene thread (SceneListener callback) or while holding getSceneLock(). Spans returned
+// are valid until next update.
+//
+// Scene updates are committed a whole frame at a time. Frame boundaries are, by order of
+// precedence: an explicit end of frame message (/frame, once a client sent one), a change of
+// bundle time tag (or an immediate bundle), or a short period without messages. Commits are rate
+// limited (see setMinCommitInterval), frames received meanwhile are coalesced into one update.
+// Listener rotation only updates (head tracking) bypass both frames and rate limit.
+//
+// Incoming traffic can be captured to file, then replayed in place of the receiver (see
+// OSCCapture), e.g. to reproduce a scene update load without a raytracer. A synthetic scene
+// (see SceneGenerator) can be fed the same way. A saved scene state (see getMapContentForLog,
+// OSCStateFile) is loaded back in a single commit, in place of the whole scene.
+//
+// Offline (non realtime) handlers neither receive OSC nor run a scene thread: their owner
+// advances the scene itself (see updateScene), e.g. at audio time when rendering to file.
+//
+// Source images are sent either one message per image (/in, /upd, /out) or all at once, in
+// binary form, with the end of frame message: [ /frame blob ] (see ImageSourceFrame). The blob
+// then replaces the whole source image set, images not in it are removed.
+//
+// Scenes may hold several sources (sorted by name, see getNumSources). An /in, /upd or /out
+// message names the source its image originates from as an optional last argument, images without
+// one (binary frames) belong to the first source. Image ids are only unique per source: images are
+// identified by a key combining both (see SourceImageStore::makeKey, getSourceImageKeys).
+//
+// Scenes may also hold several listeners (sorted by name, see getNumListeners). Source images are
+// traced for the first one and shared by the others: each image is seen by every listener from
+// its image source position (first listener position, pushed back along the last segment of
+// the path to the path length), from which path lengths and DOAs of other listeners derive.
+
 class OSCHandler :
-	public Component,
 	private OSCReceiver,
-	public OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>,
-	public ChangeBroadcaster
+	public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>,
+	public ChangeBroadcaster,
+	private Thread,
+	private OSCCapturePlayer::Target
 {
 	public:
 
-		OSCHandler();
-		~OSCHandler(){};
-
-		std::vector<int> getSourceImageIDs();
-		std::vector<float> getSourceImageDelays();
-		std::vector<float> getSourceImagePathsLength();
-		std::vector<Eigen::Vector3f> getSourceImageDOAs();
-		std::vector<Eigen::Vector3f> getSourceImageDODs();
-		Array<float> getSourceImageAbsorption(const unsigned int sourceID);
-		std::vector<float> getRT60Values();
-		int getDirectPathId();
+		explicit OSCHandler(const bool realtime = true);
+		~OSCHandler();
+
+		class SceneListener
+		{
+			public:
+				virtual ~SceneListener(){};
+				// Called on the scene thread, scene lock held, after updateInternals(). Return
+				// false if the update could not be consumed yet: it will be retried shortly.
+				virtual bool oscSceneUpdated(OSCHandler& oscHandler) = 0;
+		};
+
+		Span<SourceImageStore::Key> getSourceImageKeys(); // unique in scene, see SourceImageStore::makeKey
+		Span<float> getSourceImageDelays();
+		Span<float> getSourceImagePathsLength();
+		Span<int> getSourceImageReflectionOrders();
+		int getSourceImageReflectionOrder(const SourceImageStore::Key sourceID);
+		void getSourceImageDOAs(std::vector<Eigen::Vector3f>& doas, const int listenerIndex = 0);
+		void getSourceImageWorldDOAs(std::vector<Eigen::Vector3f>& doas, const int listenerIndex = 0);
+		Eigen::Vector3f getSourceImageDOA(const SourceImageStore::Key sourceID, const bool worldFrame, const int listenerIndex = 0);
+		void getSourceImagePathLengths(std::vector<float>& pathLengths, const int listenerIndex);
+		Eigen::Vector3f getSourceImageDOD(const SourceImageStore::Key sourceID, const bool worldFrame = false);
+		int getSourceImageSourceIndex(const SourceImageStore::Key sourceID);
+		int getNumSources() { return (int)current->sources.size(); }
+		int getNumListeners() { return (int)current->listeners.size(); }
+		Eigen::Matrix3f getListenerRotationMatrix(const int listenerIndex = 0);
+		Eigen::Matrix3f getSourceRotationMatrix(const int sourceIndex);
+		bool hasSceneChanged();
+		bool isSourceImageChanged(const SourceImageStore::Key sourceID);
+		bool hasSourceChanged();
+		bool hasListenerMoved();
+		bool hasListenerRotated();
+		bool hasRT60Changed();
+		bool isFullUpdateRequired();
+		void getSourceImageDODs(std::vector<Eigen::Vector3f>& dods);
+		Span<float> getSourceImageAbsorption(const SourceImageStore::Key sourceID);
+		const std::vector<float>& getRT60Values();
+		SourceImageStore::Key getDirectPathKey(); // -1 if none
 		String getMapContentForGUI();
 		String getMapContentForLog();
+		bool loadState(const File& stateFile, int& errorLine);
 		void clear(const bool force);
 		void updateInternals();
+		void setSceneListener(SceneListener* newListener);
+		void requestUpdate(const bool wakeUp = true);
+		void setMinCommitInterval(const int intervalInMs) { minCommitInterval = intervalInMs; }
+		CriticalSection& getSceneLock() { return sceneLock; }
+		String getConnectionError() const { return connectionError; } // empty if connected, see ChangeBroadcaster
+		void clearConnectionError() { connectionError.clear(); }
+		int getNumDroppedDeltas() const { return numDroppedDeltas; } // queue full, scene resynced since
+
+		bool startCapture(const File& captureFile) { return captureWriter.start(captureFile); }
+		void stopCapture() { captureWriter.stop(); }
+		bool isCapturing() const { return captureWriter.isCapturing(); }
+		bool startReplay(const File& captureFile, const double speed, const bool inProcess);
+		void stopReplay();
+		bool isReplaying() const { return capturePlayer.isPlaying(); }
+		bool startGenerator(const SceneGenerator::Settings& settings, const bool inProcess);
+		void setGeneratorSettings(const SceneGenerator::Settings& settings) { sceneGenerator.setSettings(settings); }
+		void stopGenerator();
+		bool isGenerating() const { return sceneGenerator.isGenerating(); }
+
+		// Offline mode only (see OSCHandler(false))
+		bool startOfflineReplay(const File& captureFile) { return capturePlayer.openOffline(captureFile, this); }
+		void updateScene(const uint32 timeInMs);
+		void receiveMessage(const OSCMessage& msg);
+		void receiveBundle(const OSCBundle& bundle);
 
 	private:
     
 		void oscMessageReceived(const OSCMessage& msg) override;
 		void oscBundleReceived(const OSCBundle& bundle) override;
-		void showConnectionErrorMessage(const String& messageText);
+		void connectReceiver();
+		void run() override;
+		void processDeltas(const uint32 now);
+		void restoreReceiver();
+
+		void replayMessage(const OSCMessage& msg) override { oscMessageReceived(msg); } // OSCCapturePlayer::Target
+		void replayBundle(const OSCBundle& bundle) override { oscBundleReceived(bundle); } // OSCCapturePlayer::Target
+		bool isReadyForReplay() override { return deltaQueue.getNumReady() < replayQueueThreshold; } // OSCCapturePlayer::Target
+
+		// Scene delta, parsed from one OSC message (receiver thread) then applied to future (scene thread)
+		struct SceneDelta
+		{
+			enum Type { imageUpdate, imageRemove, sourceUpdate, listenerUpdate, rt60Update, frameEnd, imageFrame };
+			int type;
+			int id; // source image id / frameEnd: 1 if explicit (/frame), 0 if derived from bundles / imageFrame: frame id
+			int reflectionOrder;
+			int numValues;
+			bool inBundle; // received in a bundle (frame delimited by time tag) or as a lone message
+			float values[17]; // image: r1 xyz, rN xyz, dist, abs1 .. abs10 / source, listener: pos xyz, rot 3x3 / rt60
+			char name[32]; // source / listener name / image: originating source name (empty: first source)
+		};
+
+		bool parseMessage(const OSCMessage& msg, SceneDelta& delta);
+		void pushDelta(const SceneDelta& delta);
+		void pushFrameEnd(const bool isExplicit);
+		void applyDelta(const SceneDelta& delta);
+		bool applyImageFrame(const ImageSourceFrame& frame);
+		void applyState(const OSCStateFile& state);
+		void applyClear(const bool force);
+		void carryOverChanges();
+		int getSourceKey(const char* sourceName);
+		const EL_Source* getSourceImageSource(const int slot);
+		Eigen::Vector3f getSourceImageRelativePosition(const int slot, const int listenerIndex);
+		const EL_Listener& getListener(const int listenerIndex) const;
+
+		template <typename T>
+		static typename std::vector<T>::iterator findByName(std::vector<T>& elements, const String& name)
+		// Element named name, or its (sorted) insertion position if not found
+		{
+			return std::lower_bound(elements.begin(), elements.end(), name, [](const T& element, const String& n) { return element.name < n; });
+		}
 
 		int port = 3860;
+		const bool isRealtime; // false: offline, no receiver nor scene thread
+		String connectionError; // message thread
+
+		// Address patterns, built once (matched on receiver thread)
+		const OSCAddressPattern patternIn { "/in" };
+		const OSCAddressPattern patternUpd { "/upd" };
+		const OSCAddressPattern patternR60 { "/rt60" };
+		const OSCAddressPattern patternSource { "/source" };
+		const OSCAddressPattern patternListener { "/listener" };
+		const OSCAddressPattern patternOut { "/out" };
+		const OSCAddressPattern patternFrame { "/frame" };
+
+		// Receiver thread to scene thread
+		SpscQueue<SceneDelta> deltaQueue { 4096 };
+		std::atomic<bool> updateRequested { false };
+		std::atomic<bool> clearRequested { false };
+		std::atomic<bool> clearForced { false };
+		std::atomic<int> minCommitInterval { 0 }; // ms
+		std::atomic<int> numDroppedDeltas { 0 };
+		std::atomic<bool> resyncRequested { false }; // deltas dropped: images rebuilt from next frame
+		TripleBuffer<ImageSourceFrame> imageFrames; // binary frames, latest one wins
 
-		// Prepare struct for thread safe update (pointer swap based)
+		// Message thread to scene thread: saved states loaded (see loadState), latest one wins
+		TripleBuffer<OSCStateFile> stateFiles;
+		std::atomic<bool> stateLoadRequested { false };
+
+		// Capture / replay / generator (in process replay or generator stands in for the receiver
+		// thread, disconnected meanwhile)
+		OSCCaptureWriter captureWriter;
+		OSCCapturePlayer capturePlayer;
+		SceneGenerator sceneGenerator;
+		bool receiverReplaced = false;
+		static const int replayQueueThreshold = 1024; // max speed replay / generator: deltas left for scene thread
+
+		// Receiver thread: frame boundaries derived from bundle time tags
+		uint64 bundleTimeTag = 0;
+		bool bundleTimeTagOpen = false;
+
+		// Scene thread
+		CriticalSection sceneLock; // guards current / future and sceneListener
+		SceneListener* sceneListener = nullptr;
+		bool updatePending = false; // future holds changes not yet consumed by sceneListener
+		bool messageFrameOpen = false; // future holds part of a frame sent as lone messages
+		bool bundleFrameOpen = false; // future holds part of a frame sent as bundles
+		bool explicitFrames = false; // client sends end of frame messages
+		uint32 frameStartTime = 0; // ms
+		uint32 lastCommitTime = 0; // ms
+		static const int coalesceInterval = 2; // ms, wait for the end of a burst of messages
+		static const int idleInterval = 20; // ms
+		static const int maxFrameDuration = 100; // ms, frame committed even if incomplete (lost end of frame)
+		uint32 offlineTime = 0; // ms, offline mode scene time (see updateScene)
+		std::vector<SourceImageStore::Key> frameKeysSorted; // applyImageFrame / applyState scratch
+		std::vector<String> sourceKeyNames; // source image source key - 1 -> source name (append only, key 0: first source)
+
+		// Scene state, future written then swapped with current by the scene thread (future then
+		// brought up to date with the changes of current, see updateInternals)
 		struct localVariablesStruct
 		{
-			std::map<int,EL_ImageSource> sourceImageMap;
-			std::map<String,EL_Source> sourceMap;
-			std::map<String,EL_Listener> listenerMap;
+			SourceImageStore sourceImages;
+			std::vector<EL_Source> sources; // sorted by name
+			std::vector<EL_Listener> listeners; // sorted by name
 			std::vector<float> valuesR60;
+			bool sceneChanged = true; // false if only listener orientation changed since last update
+
+			// changes since last update (source images: see sourceImages), so that listener only
+			// recomputes what changed
+			bool sourceChanged = true;
+			bool listenerMoved = true;
+			bool listenerRotated = true;
+			bool rt60Changed = true;
+			bool fullUpdateRequired = true; // see requestUpdate
 		};
     
 		localVariablesStruct *current = new localVariablesStruct();
@@ -0,0 +1,69 @@
+#ifndef OSCSTATEFILE_H_INCLUDED
+#define OSCSTATEFILE_H_INCLUDED
+
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+#include "SourceImageStore.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Scene state saved to disk (see OSCHandler::getMapContentForLog), one line per element:
+//
+//   listener: name pos: x y z rot: r11 r12 r13 r21 .. r33
+//   source: name pos: x y z rot: r11 r12 r13 r21 .. r33
+//   rt60: t1 .. t10
+//   imgSrc: id order: n posFirst: x y z posLast: x y z pathLength: d abs: a1 .. a10 (src: name)
+//
+// Image ids being unique per source only, images of named sources (see OSCHandler::getSourceKey)
+// end with the source name, source keys of the state being indices in getSourceKeyNames (+ 1).
+//
+// Parsed in a single pass over the file content, straight into scene storage (no allocation per
+// line or token but for element names), so that scenes of thousands of images load in a few ms.
+
+class OSCStateFile
+{
+	public:
+
+		OSCStateFile(){};
+		~OSCStateFile(){};
+
+		bool load(const File& stateFile);
+		bool parse(const char* text); // null terminated
+		int getErrorLine() const { return errorLine; } // first invalid line (1 based) if parsing failed
+
+		const SourceImageStore& getSourceImages() const { return sourceImages; }
+		const std::vector<EL_Source>& getSources() const { return sources; } // sorted by name
+		const std::vector<EL_Listener>& getListeners() const { return listeners; } // sorted by name
+		const std::vector<float>& getRT60Values() const { return valuesR60; }
+		const std::vector<String>& getSourceKeyNames() const { return sourceKeyNames; } // source key - 1 -> name
+
+	private:
+
+		bool parseLine(const char*& text);
+		bool parseElement(const char*& text, const bool isListener);
+
+		// Tokens (spaces and tabs skipped, never past end of line), text advanced past what was read
+		static bool readKeyword(const char*& text, const char* keyword);
+		static bool readName(const char*& text, String& name);
+		static bool readInt(const char*& text, int& value);
+		static bool readFloats(const char*& text, float* values, const int numValues);
+		static bool isEndOfLine(const char*& text);
+		static void skipSpaces(const char*& text);
+
+		SourceImageStore sourceImages;
+		std::vector<EL_Source> sources;
+		std::vector<EL_Listener> listeners;
+		std::vector<float> valuesR60;
+		std::vector<String> sourceKeyNames;
+		int errorLine = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OSCStateFile)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // OSCSTATEFILE_H_INCLUDED
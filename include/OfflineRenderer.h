@@ -0,0 +1,94 @@
+#ifndef OFFLINERENDERER_H_INCLUDED
+#define OFFLINERENDERER_H_INCLUDED
+
+#include <functional>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Headless rendering of audio files through a scene, faster than real time: a host driven engine
+// (see EvertimsEngine) processed in a loop, fed from the input file. The scene is a saved OSC
+// state (see OSCStateFile) or an OSC capture (see OSCCapture), advanced at audio time: capture
+// packets are applied at their capture time, as if received while the input file played.
+//
+// Input channel s feeds source s (sorted by name), downmixed to mono for a single source. Outputs
+// are those of the first listener: Ambisonic channels (as sent to the audio device) and / or
+// their binaural decoding, plus direct to binaural source images.
+//
+// Jobs (one input file each) are rendered in parallel, one thread each, and timed: the speed-up
+// factor is the duration of the audio rendered over the time it took. Run from the command line by
+// the EvertimsOffline console application (offline/src/Main.cpp).
+
+class OfflineRenderer : private Thread
+{
+	public:
+
+		struct Settings
+		{
+			int blockSize = 512;
+			int ambisonicOrder = AMBI_ORDER;
+			int numFreqBands = 3;
+			String sourceDirectivity = "omni";
+			bool sphericalHarmonicDirectivity = false; // see EvertimsEngine::sphericalHarmonicDirectivity
+			bool enableReverbTail = true;
+			bool enableDirectToBinaural = false;
+			int numBinauralImages = 1;
+			int maxSceneUpdateRate = 30; // per second, see MainComponent::updateSceneCommitInterval
+			int numRenderThreads = 1; // per job (see SourceImagesHandler::setNumRenderThreads)
+			double tailDuration = 2.0; // in seconds, rendered past the end of the input file
+		};
+
+		struct Job
+		{
+			File input;
+			File scene; // saved OSC state or OSC capture
+			File ambisonicOutput; // either output may be left empty, not both
+			File binauralOutput;
+
+			// results
+			bool succeeded = false;
+			String error;
+			double audioDuration = 0.0; // s
+			double renderDuration = 0.0; // s
+			double getSpeedUp() const { return renderDuration > 0.0 ? audioDuration / renderDuration : 0.0; }
+		};
+
+		OfflineRenderer();
+		~OfflineRenderer();
+
+		bool start(const Array<Job>& jobsToRender, const Settings& renderSettings, const int numParallelJobs);
+		void stop() { stopThread(10000); } // jobs left interrupted
+		bool isRendering() const { return isThreadRunning(); }
+		const Array<Job>& getJobs() const { return jobs; } // once rendering is over
+		int getNumFailedJobs() const;
+		String getReport() const;
+		static int getDefaultNumParallelJobs() { return jmax(1, SystemStats::getNumCpus()); }
+
+		static void render(Job& job, const Settings& settings);
+
+		// Called on the renderer thread once all jobs are done: signal or post to another thread from it
+		// (e.g. MessageManager::callAsync), the renderer is still running
+		std::function<void()> onFinished;
+
+	private:
+
+		class RenderChain;
+		class RenderJob;
+
+		void run() override;
+
+		Array<Job> jobs;
+		Settings settings;
+		int numThreads = 1;
+		double batchDuration = 0.0; // s
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // OFFLINERENDERER_H_INCLUDED
@@ -0,0 +1,77 @@
+#ifndef RENDERTHREADPOOL_H_INCLUDED
+#define RENDERTHREADPOOL_H_INCLUDED
+
+#include <atomic>
+
+#include <JuceHeader.h>
+#include "StageProfiler.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fork / join pool of render threads, for the audio thread to spread one block of work over
+// several cores: run() wakes the worker threads, runs its share of the job on the calling thread,
+// then waits for the workers to be done. The job itself splits its work (e.g. chunks picked from
+// an atomic counter, see SourceImagesHandler).
+//
+// No allocation in run(). Waking a worker signals its start event (short lock, shared with the
+// sleeping worker only); the join spins then yields on an atomic counter, without lock. Workers
+// run at real time priority, as the audio thread: a preempted worker does not leave the audio
+// thread waiting behind lower priority threads. Time spent waiting for them is reported by
+// getLastWaitTicks (see StageProfiler::renderThreadWait).
+
+class RenderThreadPool
+{
+	public:
+
+		class Job
+		{
+			public:
+				virtual ~Job(){};
+				// Called once per thread and per run(), threadIndex in [0, getNumThreads()), 0 being
+				// the calling thread
+				virtual void runJob(const int threadIndex) = 0;
+		};
+
+		RenderThreadPool(){};
+		~RenderThreadPool() { setNumThreads(1); }
+
+		void setNumThreads(const int numThreads); // calling thread included, not to be called while running
+		int getNumThreads() const { return workers.size() + 1; }
+		void run(Job& job);
+		int64 getLastWaitTicks() const { return lastWaitTicks; } // calling thread, last run() join (StageProfiler::getTicks)
+
+		static int getDefaultNumThreads(); // one core left for the scene and GUI threads
+
+		static const int maxNumThreads = 8;
+
+	private:
+
+		class Worker : public Thread
+		{
+			public:
+				Worker(RenderThreadPool& ownerPool, const int index);
+				~Worker(){};
+				void run() override;
+
+				WaitableEvent startEvent;
+
+			private:
+				RenderThreadPool& pool;
+				const int threadIndex;
+		};
+
+		OwnedArray<Worker> workers;
+		Job* currentJob = nullptr;
+		std::atomic<int> numWorkersRunning { 0 };
+		int64 lastWaitTicks = 0;
+		static const int spinCount = 2000; // spin before yielding (short waits)
+		static const int workerPriority = 10; // real time, as the audio thread
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderThreadPool)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // RENDERTHREADPOOL_H_INCLUDED
@@ -3,7 +3,7 @@
 
 #include <array>
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "DelayLine.h"
 #include "Utils.h"
 
@@ -17,21 +17,25 @@ class ReverbTail
 		ReverbTail();
 		~ReverbTail() {};
 
+		static const int numOctaveBands = 3;
+		static const int MAX_FDN_ORDER = 16;
+		static const int fdnOrder = 16;
+
+		typedef std::array<std::array<float, MAX_FDN_ORDER>, numOctaveBands> FdnGains; // [band][fdn], S.I.
+
 		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate);
-		void updateInternals(const std::vector<float>& rt60Values);
-		void addToBus(const unsigned int busId, const AudioBuffer<float>& source);
+		FdnGains getFdnGains(const std::vector<float>& rt60Values) const; // scene thread, see setFdnGains
+		void setFdnGains(const FdnGains& gains) { fdnGains = gains; } // audio thread
+		void addToBus(const unsigned int busId, const AudioBuffer<float>& source, const int numBands);
+		void addToBus(const unsigned int busId, const AudioBuffer<float>& source, const int numBands, AudioBuffer<float>& busBuffers) const;
+		void addBusBuffers(const AudioBuffer<float>& busBuffers);
+		int getNumBusChannels() const { return fdnOrder * numOctaveBands; }
 		void extractBusToBuffer(AudioBuffer<float>& destination);
 		void clear();
 
-		std::vector<float> valuesRT60; // in sec
-    
-		static const int numOctaveBands = 3;
-		static const int MAX_FDN_ORDER = 16;
-		static const int fdnOrder = 16;
-    
 	private:
     
-		void updateFdnParameters();
+		void defineFdnDelays();
 		void defineFdnFeedbackMatrix();
 
 		// Local delay line
@@ -39,7 +43,7 @@ class ReverbTail
     
 		// Setup FDN (static FDN order of 16 is max for now)
 		std::array<unsigned int, MAX_FDN_ORDER> fdnDelays; // in samples
-		std::array<std::array<float, MAX_FDN_ORDER>, numOctaveBands> fdnGains; // S.I.
+		FdnGains fdnGains {}; // S.I., silent tail until first setFdnGains
 		std::array<std::array<float, MAX_FDN_ORDER>, MAX_FDN_ORDER> fdnFeedbackMatrix; // S.I.
     
 		// Audio buffers
@@ -0,0 +1,118 @@
+#ifndef SCENEGENERATOR_H_INCLUDED
+#define SCENEGENERATOR_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+#include "OSCCapture.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Synthetic scene, stand-in for the EVERTims raytracer (load testing): image sources of a shoebox
+// room (image source model) with moving source and listener, sent at a fixed rate as the OSC
+// traffic a client would send: /source, /listener, /rt60, then /in (new image), /upd (image
+// changed) and /out (image removed), followed by an end of frame message (/frame).
+//
+// Room spans [0, roomSize] (z up), all walls share the same absorption. Images are taken by
+// increasing reflection order up to numImages (ids stable across frames), the direct path being
+// sent as order 0. Traffic goes either to a Target (in process) or as UDP packets to a local port.
+
+class SceneGenerator : private Thread
+{
+	public:
+
+		// Circular path in the horizontal plane (static if radius is 0)
+		struct MotionPath
+		{
+			Eigen::Vector3f centre { 3.f, 2.f, 1.5f }; // m
+			float radius = 0.f; // m
+			float period = 10.f; // s
+		};
+
+		struct Settings
+		{
+			Settings()
+			{
+				sourcePath.centre = Eigen::Vector3f(2.f, 2.f, 1.5f);
+				sourcePath.radius = 1.f;
+				listenerPath.centre = Eigen::Vector3f(4.5f, 2.f, 1.7f);
+			}
+
+			Eigen::Vector3f roomSize { 6.f, 4.f, 3.f }; // m
+			std::array<float, NUM_OCTAVE_BANDS> wallAbsorption {{ 0.02f, 0.03f, 0.05f, 0.08f, 0.12f, 0.18f, 0.25f, 0.3f, 0.35f, 0.4f }};
+			int maxReflectionOrder = 20;
+			int numImages = 500; // direct path included, at most maxNumImages
+			float updateRate = 20.f; // frames per second
+			int messagesPerBundle = 256; // images sent in bundles of (at most) that many messages, 0: lone messages
+			MotionPath sourcePath;
+			MotionPath listenerPath;
+			float listenerYawRate = 0.f; // deg/s, head rotation
+		};
+
+		static const int maxNumImages = 5000;
+
+		SceneGenerator();
+		~SceneGenerator();
+
+		bool start(const Settings& newSettings, OSCCapturePlayer::Target* newTarget);
+		bool start(const Settings& newSettings, const int udpPort);
+		void stop();
+		void setSettings(const Settings& newSettings); // applied from next frame
+		bool isGenerating() const { return isThreadRunning(); }
+		int getNumFramesSent() const { return numFramesSent; }
+
+	private:
+
+		// Image of the source, mirrored m[axis] times along each axis (order = sum of |m|)
+		struct Lattice
+		{
+			int m[3];
+			int order;
+			int id;
+		};
+
+		void run() override;
+		void applySettings();
+		void sendFrame(const double time);
+		void computeImage(const Lattice& lattice, float* values) const;
+		Eigen::Vector3f foldIntoRoom(const Eigen::Vector3f& position) const;
+		Eigen::Vector3f getPosition(const MotionPath& path, const double time) const;
+
+		void addMessage(const OSCMessage& message);
+		void flushBundle();
+		void send(const OSCMessage& message);
+		bool waitForTarget();
+
+		CriticalSection settingsLock;
+		Settings pendingSettings;
+		bool settingsChanged = false;
+
+		OSCCapturePlayer::Target* target = nullptr;
+		OSCSender sender;
+		std::atomic<int> numFramesSent { 0 };
+
+		// Generator thread
+		Settings settings;
+		bool rt60Pending = true;
+		std::vector<Lattice> lattices; // images sent, sorted by id
+		std::vector<int> sentIds; // sorted
+		std::vector<float> sentValues; // per sent id: r1 xyz, rN xyz, dist, abs1 .. abs10
+		std::vector<int> frameIds; // scratch
+		std::vector<float> frameValues; // scratch
+		Eigen::Vector3f sourcePosition;
+		Eigen::Vector3f listenerPosition;
+		OSCTimeTag frameTimeTag;
+		OSCBundle bundle;
+		int bundleSize = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SceneGenerator)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // SCENEGENERATOR_H_INCLUDED
@@ -0,0 +1,97 @@
+#ifndef SOURCEIMAGESTORE_H_INCLUDED
+#define SOURCEIMAGESTORE_H_INCLUDED
+
+#include <algorithm>
+#include <vector>
+
+#include <JuceHeader.h>
+#include "Utils.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Source images of a scene, stored as a structure of arrays (one contiguous array per field,
+// images sorted by key) so that consumers read whole fields as spans. Each image refers to its
+// originating source through a source key, assigned by the scene owner (see OSCHandler).
+//
+// Image ids (path ids) are only unique among the images of a source: images are identified by
+// their key, combining source key and id (see makeKey), unique in the scene.
+//
+// Lookup by key relies on an open addressing hash table (key -> slot), built once the store is
+// complete (see buildIndex), binary search on keys being used meanwhile. Images added, updated or
+// removed since last clearChanges() are tracked so that a copy of the store is brought up to date
+// in O(changed) (see syncFrom). No allocation once sized for the largest scene received.
+
+class SourceImageStore
+{
+	public:
+
+		typedef int64 Key; // source key in high bits, id in low bits (sorted by source, then unsigned id)
+
+		SourceImageStore();
+		~SourceImageStore(){};
+
+		static Key makeKey(const int sourceKey, const int id) { return ((Key)sourceKey << 32) | (uint32)id; }
+
+		// Insert or update image, returns false (image left untouched) if values are the same
+		bool set(const int id, const int reflectionOrder, const float* positionFirst, const float* positionLast, const float pathLength, const float* absorption, const int sourceKey = 0);
+		bool remove(const Key key);
+		void clear();
+
+		int getNumImages() const { return (int)keys.size(); }
+		int findSlot(const Key key) const; // -1 if not found
+
+		// Fields, image i at index i (or [i][xyz], [i][band])
+		Span<Key> getKeys() const { return keys; }
+		Span<int> getIds() const { return ids; }
+		Span<int> getReflectionOrders() const { return reflectionOrders; }
+		Span<float> getPathLengths() const { return pathLengths; }
+		Span<float> getDelays() const { return delays; }
+		Span<float> getPositionsFirst() const { return positionsFirst; }
+		Span<float> getPositionsLast() const { return positionsLast; }
+		Span<float> getAbsorptions() const { return absorptions; }
+		Span<int> getSourceKeys() const { return sourceKeys; }
+
+		// Changes since last clearChanges()
+		bool isChanged(const Key key) const;
+		Span<Key> getChangedKeys() const { return changedKeys; } // may hold duplicates
+		void markChanged(const Key key);
+		void clearChanges();
+
+		// Apply changes of other (this being a copy of other before those changes), then clear changes
+		void syncFrom(const SourceImageStore& other);
+		void buildIndex();
+
+	private:
+
+		int insertAt(const int slot, const Key key);
+		void copyImage(const SourceImageStore& other, const int otherSlot, const int slot);
+		void copyFrom(const SourceImageStore& other);
+		void flagChanged(const int slot);
+		static uint32 hash(const Key key) { return (uint32)(((uint64)key * 11400714819323198485ull) >> 32); } // Fibonacci hashing
+
+		std::vector<Key> keys;
+		std::vector<int> ids;
+		std::vector<int> reflectionOrders;
+		std::vector<float> positionsFirst;
+		std::vector<float> positionsLast;
+		std::vector<float> pathLengths;
+		std::vector<float> delays;
+		std::vector<float> absorptions;
+		std::vector<int> sourceKeys;
+		std::vector<char> changed;
+
+		std::vector<Key> changedKeys;
+
+		// key -> slot, linear probing, size power of 2 (at least twice the number of images)
+		std::vector<int> index;
+		int indexShift = 28; // hash bits kept: 32 - log2(index size)
+		bool indexValid = false;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SourceImageStore)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // SOURCEIMAGESTORE_H_INCLUDED
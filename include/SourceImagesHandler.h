@@ -1,29 +1,78 @@
 #ifndef SOURCEIMAGESHANDLER_H_INCLUDED
 #define SOURCEIMAGESHANDLER_H_INCLUDED
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <JuceHeader.h>
+#include "LockFree.h"
 #include "AmbixEncode/AmbixEncoder.h"
+#include "AmbisonicRotation.h"
 #include "BinauralEncoder.h"
 #include "FilterBank.h"
 #include "ReverbTail.h"
 #include "DirectivityHandler.h"
 #include "OSCHandler.h"
+#include "RenderThreadPool.h"
+#include "StageProfiler.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-class SourceImagesHandler
+// Source images of all sources are rendered in a single pass, each tapped from the delay line of
+// its originating source (see OSCHandler::getSourceImageSourceIndex), into shared Ambisonic and
+// reverb tail accumulators. Source images are split in chunks among render threads (see
+// setNumRenderThreads), each with its own scratch buffers and accumulators, summed afterwards.
+//
+// Several listeners (see OSCHandler::getNumListeners) are rendered in the same pass, each to its
+// own group of stereo + Ambisonic channels of the output buffer (see getListenerFirstChannel).
+// Listeners share the source images: delay tap, absorption / directivity filtering and reverb
+// tail feed are done once per image, at the delay of the closest listener. The filtered image is
+// then written to a short delay line (listenerOffsetLines), read by each listener at its own delay
+// offset and gain before its Ambisonic encoding / binaural encoding (see getRenderCost).
+
+class SourceImagesHandler :
+	private RenderThreadPool::Job
 {
 	public:
     
-		SourceImagesHandler() {};
+		SourceImagesHandler();
 		~SourceImagesHandler(){};
 
 		void prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate);
-		void getNextAudioBlock(DelayLine<float>* delayLine, AudioBuffer<float>& ambisonicBuffer);
+		void getNextAudioBlock(const OwnedArray<DelayLine<float>>& delayLines, AudioBuffer<float>& ambisonicBuffer);
 		float getMaxDelayFuture();
 		void updateFromOscHandler(OSCHandler& oscHandler);
-		void setFilterBankSize(const unsigned int numFreqBands);
+		bool updateListenerOrientation(OSCHandler& oscHandler);
+		bool isReadyForUpdate() const { return readyForUpdate; }
+		bool acquireUpdate();
+		void setFilterBankSize(const int numBands);
+		void setBinauralCrossfadeStep(const float step);
+		void setAmbisonicOrder(const int order);
+		int getAmbisonicOrder() const { return ambisonicOrder; }
+		int getNumSources() const { return jmax(current->numSources, future->numSources); } // audio thread
+		int getNumListeners() const { return (int)jmax(current->listeners.size(), future->listeners.size()); } // audio thread
+		int getListenerFirstChannel(const int listenerIndex) const { return listenerIndex * (2 + getNumAmbiChannels(ambisonicOrder)); }
+		bool setSourceDirectivity(const int sourceIndex, const String& filename);
+		void setNumRenderThreads(const int numThreads) { renderThreadPool.setNumThreads(numThreads); } // not thread safe, see setAmbisonicOrder
+		int getNumRenderThreads() const { return renderThreadPool.getNumThreads(); }
+		void setProfiler(StageProfiler* stageProfiler) { profiler = stageProfiler; } // stages timed while enabled, nullptr: none
+
+		static const int maxNumSources = 16; // one delay line (input) each
+		static const int maxNumListeners = 4; // one stereo + Ambisonic channel group each
+
+		// Render cost model, in multiply-adds per sample: listener independent part (delay taps,
+		// filter bank, gains, reverb tail feed, for each source image), and part added by each
+		// listener (delay offset read, Ambisonic encoding or binaural encoding of each source image,
+		// reverb tail and sound field rotation). Rough estimate, meant to size scenes / listeners.
+		struct RenderCost
+		{
+			float shared = 0.f;
+			float perListener = 0.f;
+			float getTotal(const int numListeners) const { return shared + numListeners * perListener; }
+		};
+		RenderCost getRenderCost() const; // audio thread (current scene and settings)
 
 		// Sources images
 		int numSourceImages = 0;
@@ -37,57 +86,179 @@ class SourceImagesHandler
 		bool enableReverbTail = true;
 		float reverbTailGain = 1.0f;
     
-		// Direct path to binaural
-		int directPathId = -1;
+		// Direct path and early reflections to binaural
+		SourceImageStore::Key directPathId = -1;
 		float directPathGain = 1.0f;
 		bool enableDirectToBinaural = false;
+		int numBinauralImages = 1; // direct path + (numBinauralImages - 1) most energetic source images
+		static const int maxNumBinauralImages = 16;
     
+		// Source image spreading: high order reflections rendered wider (Ambisonic orders faded
+		// out), spread = spreadFactor * (1 - exp(-reflectionOrder * pathLength / spreadDistance))
+		float spreadFactor = 0.0f;
+		float spreadDistance = 100.0f; // in meters
+
+		// Head tracking: source images encoded in world frame, listener orientation applied to
+		// the whole sound field (see AmbisonicRotation)
+		bool enableSoundFieldRotation = false;
+
 		// Crossfade mechanism
 		float crossfadeStep = 0.1f;
 		bool crossfadeOver = true;
+
+		// Multiple listeners: longest path length difference of a source image between listeners
+		// (delay offsets clamped beyond), sets the listener offset delay line length at prepareToPlay
+		float maxListenerPathDifference = 10.0f; // in meters
     
-		// Direct binaural encoding (for direct path only)
-		BinauralEncoder binauralEncoder;
+		// Direct binaural encoding: pool of preallocated encoders per listener, twice the max number
+		// of binaural images so that newly assigned encoders never collide with the ones still
+		// fading out. Listener l uses encoders [l * numEncodersPerListener, (l + 1) * numEncodersPerListener).
+		OwnedArray<BinauralEncoder> binauralEncoders;
+		static const int numEncodersPerListener = 2 * maxNumBinauralImages;
     
-		// Source / listener directivity
+		// Source / listener directivity: default pattern, and per source ones (nullptr: default),
+		// evaluated from lookup tables or from their SH expansion (see DirectivityHandler)
 		DirectivityHandler directivityHandler;
+		OwnedArray<DirectivityHandler> sourceDirectivityHandlers;
+		bool useSphericalHarmonicDirectivity = false;
     
-		// Prepare struct for thread safe update (pointer swap based)
+		// Render state: written by the scene thread (updateFromOscHandler) in the triple buffer back
+		// buffer, published, then acquired by the audio thread (acquireUpdate) as the crossfade target
+		struct ListenerState
+		{
+			std::vector<float> delayOffsets; // delay on top of the shared tap one, in seconds, [image]
+			std::vector<float> pathGains; // path length gain relative to the shared tap one, [image]
+			std::vector<float> ambisonicGains; // Ambisonic encoding gains [image * (order+1)^2 + channel]
+			std::vector<int> ambisonicNumChannels; // number of non null Ambisonic gains (spread), [image]
+			std::vector<int> binauralEncoderIds; // index in binauralEncoders, -1 if Ambisonic encoded
+		};
 		struct localVariablesStruct
 		{
-			std::vector<int> ids; // source images indices
-			std::vector<float> delays; // in seconds
-			std::vector<float> pathLengths; // in meters
+			std::vector<SourceImageStore::Key> ids; // source images keys, sorted (see SourceImageStore::makeKey)
+			std::vector<int> sourceIndices; // originating source (delay line), [image]
+			std::vector<float> delays; // shared tap delay (closest listener), in seconds
+			std::vector<float> pathLengths; // closest listener, in meters
 			std::vector< Array<float> > absorptionCoefs; // room frequency absorption coefficients
-			std::vector< Array<float> > directivityGains; // source directivity gains
-			std::vector< Array<float> > ambisonicGains; // buffer for input data
+			std::vector<float> directivityGains; // source directivity gains [image * NUM_OCTAVE_BANDS + band]
+			std::vector<char> imageChanged; // 0 if same image at same index in previous state (not crossfaded), [image]
+			std::vector<ListenerState> listeners; // [listener], first one being the one images are traced for
+			int numSources = 1; // number of delay lines (inputs) read
+			int numBands = NUM_OCTAVE_BANDS; // filter bank band layout (3 or 10), absorption coefficients in it
+			ReverbTail::FdnGains fdnGains {}; // reverb tail FDN gains (see ReverbTail::setFdnGains)
 		};
     
-		localVariablesStruct *current = new localVariablesStruct();
-		localVariablesStruct *future = new localVariablesStruct();
+		TripleBuffer<localVariablesStruct> states;
+		localVariablesStruct *current = &states.getReadBuffer(); // audio thread
+		localVariablesStruct *future = current; // audio thread, crossfade target
     
 	private:
 
+		// Render thread scratch buffers and accumulators
+		struct RenderContext
+		{
+			AudioBuffer<float> workingBuffer; // working buffer
+			AudioBuffer<float> workingBufferTemp; // 2nd working buffer, e.g. for crossfade mechanism
+			AudioBuffer<float> delayBuffer; // delay line interpolation scratch
+			AudioBuffer<float> listenerBuffer; // source image as heard by one listener (multiple listeners)
+			AudioBuffer<float> bandBuffer; // N band buffer returned by the filterbank for f(freq) absorption
+			AudioBuffer<float> binauralBuffer; // stereo buffer to handle binaural encoder output
+			AudioBuffer<float> ambisonicBuffer; // stereo + Ambisonic channels of each listener, sum of rendered source images
+			AudioBuffer<float> reverbBusBuffer; // reverb tail bus input, sum of rendered source images
+			bool isUsed = false; // rendered source images during current block
+
+			// Profiling: time spent per stage during current block, summed over rendered source images
+			int64 stageTicks[StageProfiler::numStages] {};
+			int64 lapTicks = 0;
+			void lap(const StageProfiler::Stage stage) // time since previous lap added to stage
+			{
+				const int64 now = StageProfiler::getTicks();
+				stageTicks[stage] += now - lapTicks;
+				lapTicks = now;
+			}
+		};
+
+		void runJob(const int threadIndex) override; // RenderThreadPool::Job
+		void renderSourceImage(const int j, RenderContext& context);
+		void renderListenerImage(const int j, const int listenerIndex, const bool crossfadeImage, RenderContext& context);
 		void updateCrossfade();
+		void updateListenerPaths(const int listenerIndex);
+		void reserveListenerOffsetLines(const int numImages);
+		DelayLine<float>& getListenerOffsetLine(const int j) { return *listenerOffsetLines[j / listenerOffsetChunkSize]; } // channel j % listenerOffsetChunkSize
+		void updateBinauralEncoders(OSCHandler& oscHandler, const int listenerIndex, const bool updateAllPositions);
+		void encodeAmbisonic(const int j, const int listenerIndex, const bool crossfade, const AudioBuffer<float>& input, AudioBuffer<float>& ambisonicBuffer);
+		template <int NumAmbiChannels> void addToAmbisonicBuffer(const int j, const int listenerIndex, const bool crossfade, const AudioBuffer<float>& input, AudioBuffer<float>& ambisonicBuffer);
+		DirectivityHandler& getSourceDirectivity(const int sourceIndex);
+
+		// Directions of departure / arrival, as fed to directivity handler / Ambisonic encoder
+		std::vector<float> dodAzims;
+		std::vector<float> dodElevs;
+		std::vector<float> doaAzims;
+		std::vector<float> doaElevs;
+		std::vector<float> spreads;
+		std::vector<Eigen::Vector3f> headDOAs; // head tracking update
+		std::vector< std::vector<float> > listenerPathLengths; // [listener][image]
+
+		// Incremental update: indices (in next state) of source images to recompute, and their
+		// compacted ids / gains
+		std::vector<int> changedIndices;
+		std::vector<SourceImageStore::Key> changedIds;
+		std::vector<SourceImageStore::Key> removedIds; // in current state, not in next one
+		std::vector<float> changedGains;
+		std::vector<int> changedNumChannels;
+		std::vector<int> changedBySource; // indices in changed images, sorted by source
+
+		// Binaural image selection (see updateBinauralEncoders): energies and ranking [image],
+		// encoders of the listener pool taken
+		std::vector<float> binauralEnergies;
+		std::vector<int> binauralSelected; // first numSelected ones picked
+		std::vector<bool> binauralEncoderInUse;
 
 		// Audio buffers
-		AudioBuffer<float> workingBuffer; // working buffer
-		AudioBuffer<float> workingBufferTemp; // 2nd working buffer, e.g. for crossfade mechanism
-		AudioBuffer<float> clipboardBuffer; // to be used as local copy of working buffer when working buffer modified in loops
-		AudioBuffer<float> bandBuffer; // N band buffer returned by the filterbank for f(freq) absorption
 		AudioBuffer<float> tailBuffer; // FDN_ORDER band buffer returned by the FDN reverb tail
-		AudioBuffer<float> binauralBuffer; // stereo buffer to handle binaural encoder output
+
+		// Render threads: source images picked by chunks (load balancing) during getNextAudioBlock
+		RenderThreadPool renderThreadPool;
+		OwnedArray<RenderContext> renderContexts; // [thread index]
+		const OwnedArray<DelayLine<float>>* renderDelayLines = nullptr;
+		int numRenderListeners = 1;
+		std::atomic<int> nextImageChunk { 0 };
+		static const int imageChunkSize = 16;
+
+		// Profiling (see StageProfiler), isProfiling fixed for the whole block
+		StageProfiler* profiler = nullptr;
+		bool isProfiling = false;
+    
+		// Multiple listeners: filtered source images [image], read at each listener delay offset.
+		// Delay lines of listenerOffsetChunkSize images each, added by the scene thread before it
+		// publishes a state that needs them (see reserveListenerOffsetLines), never moved meanwhile
+		static const int listenerOffsetChunkSize = 64;
+		std::array<std::unique_ptr<DelayLine<float>>, FilterBank::maxNumSourceImages / listenerOffsetChunkSize> listenerOffsetLines;
+		std::atomic<int> numListenerOffsetChannels { 0 }; // written by scene thread only
+		int numListenerOffsetImages = 0; // audio thread, channels available during current block
+		int maxListenerOffsetSamples = 0;
+		bool listenerOffsetLineUsed = false;
     
 		// Miscellaneaous
-		double localSampleRate;
-		int localSamplesPerBlockExpected;
+		double localSampleRate = 0.0;
+		int localSamplesPerBlockExpected = 0;
     
 		// Crossfade mechanism
 		float crossfadeGain = 0.0;
+
+		// Scene thread to audio thread hand over: at most one published state pending, the next one
+		// is only written once the crossfade towards the previous one is over, so that the triple
+		// buffer never hands the scene thread a state the audio thread still reads
+		localVariablesStruct *next = &states.getWriteBuffer(); // scene thread
+		std::atomic<bool> readyForUpdate { true };
+
+		// Scene thread settings, copied to each state it writes
+		int numFreqBands = NUM_OCTAVE_BANDS; // see setFilterBankSize
+		ReverbTail::FdnGains fdnGains {}; // updated on RT60 change
     
-		// Ambisonic encoding
-		AmbixEncoder ambisonicEncoder;
-		AudioBuffer<float> ambisonicBuffer; // output buffer, N (Ambisonic) channels
+		// Ambisonic encoding, per listener (encoder gain caches are per source image)
+		int ambisonicOrder = AMBI_ORDER;
+		OwnedArray<AmbixEncoder> ambisonicEncoders; // [listener]
+		OwnedArray<AmbisonicRotation> ambisonicRotations; // [listener]
     
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SourceImagesHandler)
 };
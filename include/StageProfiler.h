@@ -0,0 +1,125 @@
+#ifndef STAGEPROFILER_H_INCLUDED
+#define STAGEPROFILER_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Real time profiling of the audio callback: time spent per block in each DSP stage (summed over
+// render threads for source images stages) as a fixed bucket latency histogram per stage, and
+// number of callbacks that missed their deadline (took longer than the block they render lasts).
+//
+// Counters are written by the audio thread without lock, and read by a low priority thread that
+// publishes, once per publishInterval, statistics of the blocks rendered since its previous read:
+// as an OSC /stats message (see setOscTarget) and as a text summary (see getSummary, change message
+// sent on update). Stages are timed in CPU ticks (TSC on x86, steady_clock elsewhere, see getTicks).
+//
+// Clients only read the clock if isEnabled: disabled profiling costs one atomic load per block.
+
+class StageProfiler :
+	public ChangeBroadcaster,
+	private Thread
+{
+	public:
+
+		enum Stage
+		{
+			delayTaps, // source delay lines and listener offset reads, path gains
+			filterBank, // band decomposition, absorption / directivity gains, recompose
+			reverbTail, // FDN bus feed, FDN and tail Ambisonic encoding
+			binauralEncoding, // direct to binaural source images
+			ambisonicEncoding, // spherical harmonics encoding of source images
+			soundFieldRotation, // head tracking
+			binauralDecoding, // Ambisonic to binaural decoder (see EvertimsEngine)
+			levelMeter, // output level meters (see MainComponent)
+			renderThreadWait, // audio thread waiting for render threads to finish (see RenderThreadPool)
+			callback, // whole audio callback, deadline checked (see addCallbackTime)
+			numStages
+		};
+
+		StageProfiler();
+		~StageProfiler();
+
+		void setEnabled(const bool enable); // not from the audio thread
+		bool isEnabled() const { return enabled.load(std::memory_order_acquire); }
+		bool setOscTarget(const String& host, const int port); // /stats destination, false if unreachable (empty host: none)
+		String getSummary() const; // latest published statistics
+
+		// Audio thread, lock free
+		void addStageTime(const Stage stage, const int64 ticks);
+		void addCallbackTime(const int64 ticks, const int numSamples, const double sampleRate);
+
+		static inline int64 getTicks()
+		{
+		#if JUCE_INTEL
+			return (int64)__rdtsc();
+		#else
+			return (int64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		#endif
+		}
+		static double getTicksPerSecond(); // calibrated at first call (TSC)
+		static const char* getStageName(const Stage stage);
+
+		static const int numBuckets = 48; // bucket b: [2^(b-1), 2^b) ticks, last one unbounded
+		static const int publishInterval = 1000; // ms
+
+	private:
+
+		// Counters cumulative since construction, but maxTicks (reset by each read)
+		struct StageCounters
+		{
+			std::atomic<uint32> histogram[numBuckets];
+			std::atomic<int64> totalTicks;
+			std::atomic<int64> maxTicks;
+		};
+
+		// Statistics of one stage over a publish interval
+		struct StageStats
+		{
+			uint32 count = 0; // blocks timed
+			double mean = 0.0; // us
+			double p99 = 0.0; // us, upper bound of the 99th percentile bucket
+			double max = 0.0; // us
+			double load = 0.0; // time spent over interval duration (render threads summed)
+		};
+
+		void run() override;
+		void readStats(StageStats* stats, uint32& numDeadlineMisses, const double intervalDuration);
+		void publish(const StageStats* stats, const uint32 numDeadlineMisses, const double intervalDuration);
+
+		std::atomic<bool> enabled { false };
+		StageCounters counters[numStages];
+		std::atomic<uint32> deadlineMisses { 0 };
+
+		// Publisher thread: counters at previous read
+		uint32 previousHistograms[numStages][numBuckets];
+		int64 previousTotalTicks[numStages];
+		uint32 previousDeadlineMisses = 0;
+		uint32 totalDeadlineMisses = 0; // since enabled
+
+		CriticalSection senderLock;
+		OSCSender sender;
+		bool hasOscTarget = false;
+
+		CriticalSection summaryLock;
+		String summary;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StageProfiler)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // STAGEPROFILER_H_INCLUDED
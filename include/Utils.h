@@ -7,7 +7,7 @@
 #include <complex>
 #include <Eigen/Eigen>
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 
 // Define M_PI for Windows
 #ifndef M_PI
@@ -16,8 +16,8 @@
 
 #define SOUND_SPEED 343 // Speed of sound in m.s-1
 #define NUM_OCTAVE_BANDS 10 // Number of octave bands used in filter bank for room absorption
-#define AMBI_ORDER 7 // Ambisonic order
-#define N_AMBI_CH 64 // Associated number of Ambisonic channels [pow(AMBI_ORDER+1,2)]
+#define AMBI_ORDER 7 // Max Ambisonic order (actual order selected at runtime, see getNumAmbiChannels)
+#define N_AMBI_CH 64 // Associated max number of Ambisonic channels [pow(AMBI_ORDER+1,2)]
 #define AMBI2BIN_IR_LENGTH 221 // Length of loaded filters (in time samples)
 
 template <typename T>
@@ -25,21 +25,33 @@ using ComplexVector = std::vector<std::complex<T>>;
 
 typedef unsigned int uint;
 
+// Read-only view on contiguous elements (e.g. one field of a structure of arrays), valid until
+// the viewed storage is modified.
+template <typename T>
+class Span
+{
+public:
+    Span() {}
+    Span( const T* data, const int size ) : ptr(data), length(size) {}
+    Span( const std::vector<T>& vect ) : ptr(vect.data()), length((int)vect.size()) {}
+
+    const T* data() const { return ptr; }
+    int size() const { return length; }
+    bool empty() const { return length == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + length; }
+    const T& operator[]( const int i ) const { return ptr[i]; }
+
+private:
+    const T* ptr = nullptr;
+    int length = 0;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 // EVERTims structures.
 
-struct EL_ImageSource
-{
-    int ID;
-    int reflectionOrder;
-    Eigen::Vector3f positionRelectionFirst;
-    Eigen::Vector3f positionRelectionLast;
-    float totalPathDistance;
-    Array<float> absorption;
-};
-
 struct EL_Source
 {
     String name;
@@ -74,6 +86,13 @@ inline int nextPowerOf2( int x )
     return x + 1;
 }
 
+// Ambisonic methods.
+
+inline int getNumAmbiChannels( const int ambisonicOrder )
+{
+    return (ambisonicOrder + 1) * (ambisonicOrder + 1);
+}
+
 // Math methods.
 
 inline Eigen::Vector3f cartesianToSpherical(const Eigen::Vector3f& p)
@@ -114,8 +133,9 @@ inline Type round2(Type x, int numberOfDecimals){
     return round(x * pow(10,numberOfDecimals)) / pow(10,numberOfDecimals);
 }
 
-inline float getMaxValue(std::vector<float> vectIn)
-// Return max value of vector
+template <typename Container>
+inline float getMaxValue( const Container & vectIn )
+// Return max value of vector (or span)
 {
     if( vectIn.size() == 0 ) { return 0; } // not sure this is wise..
     else{
@@ -124,8 +144,9 @@ inline float getMaxValue(std::vector<float> vectIn)
     }
 }
 
-inline float getMinValue( const std::vector<float> & vectIn )
-// Return min value of vector
+template <typename Container>
+inline float getMinValue( const Container & vectIn )
+// Return min value of vector (or span)
 {
     if( vectIn.size() == 0 ) { return 0; } // not sure this is wise..
     else{
@@ -210,13 +231,12 @@ inline File getFileFromString( const String & fileName )
     }
     else
     {
-        AlertWindow::showMessageBoxAsync ( AlertWindow::WarningIcon, "Cannot locate file (OS not supported)", fileName, "OK");
         DBG(String("Cannot locate file (OS not supported): ") + fileName);
     }
     
-    if (!resourceDirDefined) // skip loading
+    if (!resourceDirDefined) // skip loading (file loaders report the missing file)
     {
-        AlertWindow::showMessageBoxAsync ( AlertWindow::WarningIcon, "Cannot locate file", fileName, "OK");
+        DBG(String("Cannot locate file: ") + fileName);
     }
     
     return resourceDir.getChildFile(fileName).getFullPathName();
@@ -235,13 +255,4 @@ inline void saveStringToDesktop( const String & fileName, const String & data)
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-static Rectangle<int> pad(int x, int y, int width, int height, int hPad = 0, int vPad = 5)
-// Convenience function that returns the coordinates of the padded rectangle.
-{
-	return Rectangle<int>(x + vPad, y + hPad, width - 2 * vPad, height - 2 * hPad);
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
 #endif // UTILS_H_INCLUDED
\ No newline at end of file
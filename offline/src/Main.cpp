@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    Headless offline rendering of audio files through a scene (see
+    OfflineRenderer), faster than real time and without sound card.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OfflineRenderer.h"
+#include <iostream>
+
+//==============================================================================
+// Options:
+//   --input <file>           audio file to render, starts a new job (repeatable)
+//   --scene <file>           saved OSC state or OSC capture (default: previous job's one)
+//   --ambisonic <file>       Ambisonic output WAV    (default if neither output given:
+//   --binaural <file>        binaural output WAV      <input>_ambisonic / _binaural.wav)
+//   --jobs <n>               files rendered in parallel (default: one per core)
+//   --block-size <n>         samples per block (default 512)
+//   --order <n>              Ambisonic order (default 7)
+//   --tail <s>               seconds rendered past the end of each input (default 2)
+//   --sh-directivity         directivity gains from SH expansion of the patterns
+// Returns 1 if any file failed to render, 2 if no input was given.
+int main (int argc, char* argv[])
+{
+    // message manager: OSC scene change broadcasts (see OSCHandler)
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+    for (int i = 1; i < argc; i++) { args.add (argv[i]); }
+
+    Array<OfflineRenderer::Job> jobs;
+    OfflineRenderer::Settings settings;
+    int numParallelJobs = OfflineRenderer::getDefaultNumParallelJobs();
+    for (int i = 0; i + 1 < args.size(); i++)
+    {
+        String value = args[i + 1].unquoted();
+        File file = File::getCurrentWorkingDirectory().getChildFile (value);
+        if (args[i] == "--input")
+        {
+            OfflineRenderer::Job job;
+            job.input = file;
+            if (jobs.size() > 0) { job.scene = jobs.getLast().scene; }
+            jobs.add (job);
+        }
+        else if (args[i] == "--scene" && jobs.size() > 0) { jobs.getReference (jobs.size() - 1).scene = file; }
+        else if (args[i] == "--ambisonic" && jobs.size() > 0) { jobs.getReference (jobs.size() - 1).ambisonicOutput = file; }
+        else if (args[i] == "--binaural" && jobs.size() > 0) { jobs.getReference (jobs.size() - 1).binauralOutput = file; }
+        else if (args[i] == "--jobs") { numParallelJobs = value.getIntValue(); }
+        else if (args[i] == "--block-size") { settings.blockSize = jlimit (32, 8192, value.getIntValue()); }
+        else if (args[i] == "--order") { settings.ambisonicOrder = jlimit (1, AMBI_ORDER, value.getIntValue()); }
+        else if (args[i] == "--tail") { settings.tailDuration = jmax (0.0, value.getDoubleValue()); }
+    }
+
+    settings.sphericalHarmonicDirectivity = args.contains ("--sh-directivity");
+
+    if (jobs.isEmpty())
+    {
+        std::cerr << "usage: EvertimsOffline --input <file> --scene <file> [--ambisonic <file>] [--binaural <file>] ..." << std::endl;
+        return 2;
+    }
+
+    for (auto& job : jobs)
+    {
+        if (job.ambisonicOutput == File() && job.binauralOutput == File())
+        {
+            job.ambisonicOutput = job.input.getSiblingFile (job.input.getFileNameWithoutExtension() + "_ambisonic.wav");
+            job.binauralOutput = job.input.getSiblingFile (job.input.getFileNameWithoutExtension() + "_binaural.wav");
+        }
+    }
+
+    // onFinished only signals (renderer thread): report written from here, once rendering is over
+    OfflineRenderer renderer;
+    WaitableEvent finished;
+    renderer.onFinished = [&finished]() { finished.signal(); };
+    renderer.start (jobs, settings, numParallelJobs);
+    finished.wait();
+    renderer.stop();
+
+    std::cout << renderer.getReport() << std::flush;
+    return renderer.getNumFailedJobs() > 0 ? 1 : 0;
+}
@@ -5,20 +5,49 @@
 
 Ambi2binIRContainer::Ambi2binIRContainer()
 {
-	// load HRIR, ITD, ILD, etc.
-	File hoa2binFile = getFileFromString("irs/hoa2bin_order2_IRC_1008_R_HRIR.bin");
-	loadIR(hoa2binFile);
+	setAmbisonicOrder(AMBI_ORDER);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Ambi2binIRContainer::loadIR(const File & filename)
+void Ambi2binIRContainer::setAmbisonicOrder(const int order)
+// Load the decoder matching order: lowest available order above it (truncated to the first
+// (order+1)^2 channels), or highest available order below it otherwise.
+{
+	if (order == ambisonicOrder) { return; }
+
+	File hoa2binFile;
+	for (int k = order; k <= AMBI_ORDER && !hoa2binFile.existsAsFile(); k++)
+	{
+		hoa2binFile = getFileFromString("irs/hoa2bin_order" + String(k) + "_IRC_1008_R_HRIR.bin");
+		decoderOrder = k;
+	}
+	for (int k = order - 1; k >= 1 && !hoa2binFile.existsAsFile(); k--)
+	{
+		hoa2binFile = getFileFromString("irs/hoa2bin_order" + String(k) + "_IRC_1008_R_HRIR.bin");
+		decoderOrder = k;
+	}
+
+	loadIR(hoa2binFile, getNumAmbiChannels(order));
+	ambisonicOrder = order;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Ambi2binIRContainer::loadIR(const File & filename, const int numChannels)
 // load Ambisonic to binaural room impulse response from file
 {
 	FileInputStream istream(filename);
 	if (istream.openedOk())
 	{
-		for (int j = 0; j < N_AMBI_CH; ++j) // loop ambi channels
+		std::array<std::array<float, AMBI2BIN_IR_LENGTH>, 2> nullFilters;
+		for (auto& filter : nullFilters) { filter.fill(0.f); }
+		ambi2binIrDict.assign(numChannels, nullFilters);
+
+		// number of channels in file: left and right IRs per channel
+		int numFileChannels = (int)(filename.getSize() / (2 * AMBI2BIN_IR_LENGTH * sizeof(float)));
+
+		for (int j = 0; j < jmin(numChannels, numFileChannels); ++j) // loop ambi channels
 		{
 			for (int i = 0; i < AMBI2BIN_IR_LENGTH; ++i) // extract left ear IRs
 			{
@@ -0,0 +1,207 @@
+#include "AmbisonicRotation.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+AmbisonicRotation::AmbisonicRotation()
+{
+	setOrder(AMBI_ORDER);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AmbisonicRotation::prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate)
+// Local equivalent of prepareToPlay
+{
+	inputBuffer.setSize(N_AMBI_CH, samplesPerBlockExpected);
+	deltaBuffer.setSize(1, samplesPerBlockExpected);
+	ramp.resize(samplesPerBlockExpected);
+	rampLength = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AmbisonicRotation::setOrder(const int order)
+// Not thread safe: to be called while audio is stopped
+{
+	ambisonicOrder = order;
+
+	Eigen::Matrix3f rotationMatrix;
+	{
+		const SpinLock::ScopedLockType lock(targetLock);
+		rotationMatrix = targetRotationMatrix;
+		targetChanged = false;
+	}
+	computeBandMatrices(rotationMatrix, ambisonicOrder, bandsFuture);
+	bandsPast = bandsFuture;
+	isIdentity = rotationMatrix.isIdentity(1e-6f);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AmbisonicRotation::setRotation(const Eigen::Matrix3f& rotationMatrix, const bool skipInterpolation)
+// Set rotation reached at the end of next audio block
+{
+	const SpinLock::ScopedLockType lock(targetLock);
+	targetRotationMatrix = rotationMatrix;
+	targetSkipInterpolation = targetSkipInterpolation || skipInterpolation;
+	targetChanged = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AmbisonicRotation::process(AudioBuffer<float>& buffer, const int startChannel)
+// Rotate (in place) Ambisonic channels [startChannel, startChannel + (order+1)^2) of buffer
+{
+	// fetch latest target rotation (skipped if being written, will be picked up next block)
+	bool interpolate = false;
+	if (targetLock.tryEnter())
+	{
+		if (targetChanged)
+		{
+			computeBandMatrices(targetRotationMatrix, ambisonicOrder, bandsFuture);
+			if (targetSkipInterpolation) { bandsPast = bandsFuture; }
+			else { interpolate = true; }
+			isIdentity = targetRotationMatrix.isIdentity(1e-6f) && !interpolate;
+			targetChanged = false;
+			targetSkipInterpolation = false;
+		}
+		targetLock.exit();
+	}
+	if (isIdentity) { return; }
+
+	int numSamples = jmin(buffer.getNumSamples(), inputBuffer.getNumSamples());
+	if (interpolate && numSamples != rampLength)
+	{
+		for (int i = 0; i < numSamples; i++) { ramp[i] = (float)(i + 1) / numSamples; }
+		rampLength = numSamples;
+	}
+
+	// keep copy of unrotated channels (order 0 left untouched)
+	int numChannels = getNumAmbiChannels(ambisonicOrder);
+	for (int k = 1; k < numChannels; k++)
+	{
+		inputBuffer.copyFrom(k, 0, buffer, startChannel + k, 0, numSamples);
+	}
+
+	// apply block diagonal rotation matrix, order per order
+	float* delta = deltaBuffer.getWritePointer(0);
+	for (int l = 1; l <= ambisonicOrder; l++)
+	{
+		const int size = 2 * l + 1;
+		const std::vector<float>& past = bandsPast[l];
+		const std::vector<float>& future = bandsFuture[l];
+
+		for (int m = 0; m < size; m++)
+		{
+			float* out = buffer.getWritePointer(startChannel + l * l + m);
+			FloatVectorOperations::copyWithMultiply(out, inputBuffer.getReadPointer(l * l), past[m * size], numSamples);
+			for (int n = 1; n < size; n++)
+			{
+				FloatVectorOperations::addWithMultiply(out, inputBuffer.getReadPointer(l * l + n), past[m * size + n], numSamples);
+			}
+
+			// linear interpolation: out += ramp * (future - past) * in
+			if (interpolate)
+			{
+				FloatVectorOperations::clear(delta, numSamples);
+				for (int n = 0; n < size; n++)
+				{
+					FloatVectorOperations::addWithMultiply(delta, inputBuffer.getReadPointer(l * l + n), future[m * size + n] - past[m * size + n], numSamples);
+				}
+				FloatVectorOperations::addWithMultiply(out, delta, ramp.data(), numSamples);
+			}
+		}
+	}
+
+	if (interpolate)
+	{
+		for (int l = 1; l <= ambisonicOrder; l++) { bandsPast[l] = bandsFuture[l]; }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void AmbisonicRotation::computeBandMatrices(const Eigen::Matrix3f& rotationMatrix, const int order, std::vector<std::vector<float>>& bands)
+// Ivanic & Ruedenberg recurrence ("Rotation Matrices for Real Spherical Harmonics. Direct
+// Determination by Recursion", J. Phys. Chem. 1996, with 1998 erratum). Allocates only if
+// bands is not already sized for order.
+{
+	bands.resize(order + 1);
+	for (int l = 0; l <= order; l++) { bands[l].resize((2 * l + 1) * (2 * l + 1)); }
+
+	// order 0: invariant
+	bands[0][0] = 1.f;
+	if (order < 1) { return; }
+
+	// order 1: ACN channels 1, 2, 3 (m = -1, 0, 1) are proportional to -x, z, y (SPAT azimuth
+	// is measured clockwise from y, see cartesianToSpherical)
+	const int axis[3] = { 0, 2, 1 };
+	const float sign[3] = { -1.f, 1.f, 1.f };
+	for (int m = -1; m <= 1; m++)
+	{
+		for (int n = -1; n <= 1; n++)
+		{
+			bands[1][(m + 1) * 3 + (n + 1)] = sign[m + 1] * sign[n + 1] * rotationMatrix(axis[m + 1], axis[n + 1]);
+		}
+	}
+
+	// order l from order l-1
+	for (int l = 2; l <= order; l++)
+	{
+		const int size = 2 * l + 1;
+		for (int m = -l; m <= l; m++)
+		{
+			for (int n = -l; n <= l; n++)
+			{
+				const int d = (m == 0) ? 1 : 0;
+				const float denom = (std::abs(n) == l) ? (float)(2 * l * (2 * l - 1)) : (float)((l + n) * (l - n));
+				const float u = std::sqrt((l + m) * (l - m) / denom);
+				const float v = 0.5f * std::sqrt((1 + d) * (l + std::abs(m) - 1) * (l + std::abs(m)) / denom) * (1 - 2 * d);
+				const float w = -0.5f * std::sqrt((l - std::abs(m) - 1) * (l - std::abs(m)) / denom) * (1 - d);
+
+				float value = 0.f;
+				if (u != 0.f) { value += u * getP(bands, 0, m, n, l); }
+				if (v != 0.f)
+				{
+					if (m == 0) { value += v * (getP(bands, 1, 1, n, l) + getP(bands, -1, -1, n, l)); }
+					else if (m > 0) { value += v * (getP(bands, 1, m - 1, n, l) * std::sqrt(1.f + (m == 1)) - getP(bands, -1, -m + 1, n, l) * (m != 1)); }
+					else { value += v * (getP(bands, 1, m + 1, n, l) * (m != -1) + getP(bands, -1, -m - 1, n, l) * std::sqrt(1.f + (m == -1))); }
+				}
+				if (w != 0.f)
+				{
+					if (m > 0) { value += w * (getP(bands, 1, m + 1, n, l) + getP(bands, -1, -m - 1, n, l)); }
+					else { value += w * (getP(bands, 1, m - 1, n, l) - getP(bands, -1, -m + 1, n, l)); }
+				}
+				bands[l][(m + l) * size + (n + l)] = value;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+float AmbisonicRotation::getCentered(const std::vector<float>& band, const int l, const int m, const int n)
+// Element (m, n) of order l block, m and n in [-l, l]
+{
+	return band[(m + l) * (2 * l + 1) + (n + l)];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+float AmbisonicRotation::getP(const std::vector<std::vector<float>>& bands, const int i, const int a, const int b, const int l)
+// Recurrence helper function P (see computeBandMatrices)
+{
+	if (b == l)
+	{
+		return getCentered(bands[1], 1, i, 1) * getCentered(bands[l - 1], l - 1, a, l - 1) - getCentered(bands[1], 1, i, -1) * getCentered(bands[l - 1], l - 1, a, -l + 1);
+	}
+	else if (b == -l)
+	{
+		return getCentered(bands[1], 1, i, 1) * getCentered(bands[l - 1], l - 1, a, -l + 1) + getCentered(bands[1], 1, i, -1) * getCentered(bands[l - 1], l - 1, a, l - 1);
+	}
+	return getCentered(bands[1], 1, i, 0) * getCentered(bands[l - 1], l - 1, a, b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
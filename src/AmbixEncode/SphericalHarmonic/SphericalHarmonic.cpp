@@ -17,6 +17,9 @@
  ==============================================================================
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "SphericalHarmonic.h"
 
 SphericalHarmonic::SphericalHarmonic() : _order(-1),
@@ -49,8 +52,18 @@ void SphericalHarmonic::Init(int order, bool n3d, bool elevation_conv)
         Chebyshev.Calc(order, 0.f);
       
 		Ymn = Eigen::VectorXd::Zero((order+1)*(order+1));
+        
+        // batch scratch
+        _normFloat.resize((order+1)*(order+1));
+        for (int acn = 0; acn < (order+1)*(order+1); acn++)
+            _normFloat[acn] = (float)Norm.Nmn(acn);
+        _legendreBatch.assign((order+1)*(order+1)*BATCH_LANES, 0.f);
+        _cosBatch.assign((std::max(order, 1)+1)*BATCH_LANES, 0.f);
+        _sinBatch.assign((std::max(order, 1)+1)*BATCH_LANES, 0.f);
+        
         _elevation_conv = elevation_conv;
         _order = order;
+        _phi = _theta = 1111.f; // invalidate last Calc() (Ymn reset)
         _init = true;
     }
 }
@@ -58,7 +71,7 @@ void SphericalHarmonic::Init(int order, bool n3d, bool elevation_conv)
 
 void SphericalHarmonic::Calc(double phi, double theta)
 {
-    if (_phi != phi && _theta != theta)
+    if (_phi != phi || _theta != theta)
     {
         Eigen::VectorXd Nmn, Chb, Pmn;
         
@@ -77,11 +90,98 @@ void SphericalHarmonic::Calc(double phi, double theta)
         Chebyshev.Get(Chb);
         
         Ymn = Nmn.cwiseProduct(Pmn).cwiseProduct(Chb);
+        
+        _phi = phi;
+        _theta = theta;
     }
     
 }
 
 
+void SphericalHarmonic::CalcBatch(const float* phi, const float* theta, int numDirections, float* output, int outputStride)
+{
+    const int L = BATCH_LANES;
+    const int N = _order;
+    float* P = _legendreBatch.data();
+    float* C = _cosBatch.data();
+    float* S = _sinBatch.data();
+    
+    for (int start = 0; start < numDirections; start += L)
+    {
+        const int numLanes = std::min(L, numDirections - start);
+        
+        // per lane arguments (unused lanes repeat last direction)
+        float arg[L], arg_2[L], cosPhi[L];
+        for (int l = 0; l < L; l++)
+        {
+            const int d = start + std::min(l, numLanes - 1);
+            const float sinTheta = sinf(theta[d]);
+            const float cosTheta = cosf(theta[d]);
+            arg[l] = _elevation_conv ? cosTheta : sinTheta;
+            arg_2[l] = _elevation_conv ? sinTheta : cosTheta;
+            cosPhi[l] = cosf(phi[d]);
+            C[l] = 1.f;
+            S[l] = 0.f;
+            C[L + l] = cosPhi[l];
+            S[L + l] = -sinf(phi[d]);
+            P[l] = 1.f;
+        }
+        
+        // chebyshev recursion for multiples of argument
+        for (int m = 2; m <= N; m++)
+        {
+            for (int l = 0; l < L; l++)
+            {
+                C[m*L + l] = 2.f * cosPhi[l] * C[(m-1)*L + l] - C[(m-2)*L + l];
+                S[m*L + l] = 2.f * cosPhi[l] * S[(m-1)*L + l] - S[(m-2)*L + l];
+            }
+        }
+        
+        // legendre P_n^m for m = n and m = n-1 (see ShLegendre)
+        for (int n = 1; n <= N; n++)
+        {
+            const float a = (float)(2*n - 1);
+            for (int l = 0; l < L; l++)
+            {
+                P[((n+1)*(n+1)-1)*L + l] = -a * P[(n*n-1)*L + l] * arg_2[l];
+                P[((n+1)*(n+1)-2)*L + l] = a * arg[l] * P[(n*n-1)*L + l];
+            }
+        }
+        
+        // rest P_n^m with 0 <= m <= n-2
+        for (int n = 2; n <= N; n++)
+        {
+            for (int m = 0; m <= n-2; m++)
+            {
+                const float a = (float)(2*n - 1) / (float)(n - m);
+                const float b = (float)(n + m - 1) / (float)(n - m);
+                for (int l = 0; l < L; l++)
+                {
+                    P[(n*(n+1)+m)*L + l] = a * arg[l] * P[(n*(n-1)+m)*L + l] - b * P[((n-2)*(n-1)+m)*L + l];
+                }
+            }
+        }
+        
+        // Ymn = Nmn * Pmn * Chebyshev, ACN (contiguous writes per direction)
+        for (int l = 0; l < numLanes; l++)
+        {
+            float* Y = output + (start + l)*outputStride;
+            for (int n = 0; n <= N; n++)
+            {
+                const int n0 = n*(n+1);
+                Y[n0] = _normFloat[n0] * P[n0*L + l];
+                for (int m = 1; m <= n; m++)
+                {
+                    const float NP = _normFloat[n0+m] * P[(n0+m)*L + l];
+                    Y[n0+m] = NP * C[m*L + l];
+                    Y[n0-m] = NP * S[m*L + l];
+                }
+            }
+        }
+    }
+}
+
+
 void SphericalHarmonic::Get(Eigen::VectorXd &GetYmn)
 {
     GetYmn = Ymn;
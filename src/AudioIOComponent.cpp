@@ -76,7 +76,7 @@ bool AudioIOComponent::loadAudioFile(const File& file)
 	if (reader != nullptr)
 	{
 		ScopedPointer<AudioFormatReaderSource> newSource = new AudioFormatReaderSource(reader, true);
-		transportSource.setSource(newSource, 0, nullptr, reader->sampleRate);
+		transportSource.setSource(newSource, 0, nullptr, reader->sampleRate, jmax(2, (int)reader->numChannels)); // all channels kept (one per source)
 		readerSource = newSource.release();
 		fileOpenedSucess = true;
 	}
@@ -113,8 +113,9 @@ void AudioIOComponent::prepareToPlay(int samplesPerBlockExpected, double sampleR
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void AudioIOComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
-// fill in bufferToFill with data from audio file or adc
+void AudioIOComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill, const int numSources)
+// fill in bufferToFill with data from audio file or adc: mono downmix in first channel for a
+// single source, otherwise channel s of audio file and adc feeds source s
 {
 	// clear buffer
 	bufferToFill.clearActiveBufferRegion();
@@ -126,8 +127,11 @@ void AudioIOComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToF
 		transportSource.getNextAudioBlock(bufferToFill);
 
 		// stereo downmix to mono
-		bufferToFill.buffer->applyGain(0.5f);
-		bufferToFill.buffer->addFrom(0, 0, bufferToFill.buffer->getWritePointer(1), bufferToFill.buffer->getNumSamples());
+		if (numSources <= 1)
+		{
+			bufferToFill.buffer->applyGain(0.5f);
+			bufferToFill.buffer->addFrom(0, 0, bufferToFill.buffer->getWritePointer(1), bufferToFill.buffer->getNumSamples());
+		}
 
 		// apply gain
 		bufferToFill.buffer->applyGain(sliderAudioGain.getValue());
@@ -139,7 +143,11 @@ void AudioIOComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToF
 		// apply gain
 		adcBuffer.applyGain(sliderMicGain.getValue());
 		// add to output
-		bufferToFill.buffer->addFrom(0, 0, adcBuffer, 0, 0, bufferToFill.buffer->getNumSamples());
+		const int numAdcChannels = numSources <= 1 ? 1 : jmin(numSources, adcBuffer.getNumChannels(), bufferToFill.buffer->getNumChannels());
+		for (int k = 0; k < numAdcChannels; k++)
+		{
+			bufferToFill.buffer->addFrom(k, 0, adcBuffer, k, 0, bufferToFill.buffer->getNumSamples());
+		}
 	}
 
 	return;
@@ -89,9 +89,13 @@ void AudioRecorder::recordBuffer(const float** inputChannelData, int numInputCha
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void AudioRecorder::prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate) {
+void AudioRecorder::prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate, const unsigned int numChannels) {
+
+	// ongoing recording has the previous number of channels
+	if (numChannels != localNumChannel) { stopRecording(); }
 
 	localSampleRate = sampleRate;
+	localNumChannel = numChannels;
 
 	delayLine.prepareToPlay(samplesPerBlockExpected, sampleRate);
 	delayLine.setSize(localNumChannel, 10 * sampleRate);
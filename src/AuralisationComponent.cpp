@@ -29,6 +29,22 @@ AuralisationComponent::AuralisationComponent()
 	labelCrossfadeFactor.setText("Crossfade factor", dontSendNotification);
 	labelCrossfadeFactor.setJustificationType(Justification::right);
 	
+	addAndMakeVisible(&labelNumBinauralImages);
+	labelNumBinauralImages.setText("Binaural paths", dontSendNotification);
+	labelNumBinauralImages.setJustificationType(Justification::right);
+
+	addAndMakeVisible(&labelAmbisonicOrder);
+	labelAmbisonicOrder.setText("Ambisonic order", dontSendNotification);
+	labelAmbisonicOrder.setJustificationType(Justification::right);
+
+	addAndMakeVisible(&labelMaxSceneUpdateRate);
+	labelMaxSceneUpdateRate.setText("Max updates / s", dontSendNotification);
+	labelMaxSceneUpdateRate.setJustificationType(Justification::right);
+
+	addAndMakeVisible(&labelSpreadFactor);
+	labelSpreadFactor.setText("Reflections spread", dontSendNotification);
+	labelSpreadFactor.setJustificationType(Justification::right);
+
 	addAndMakeVisible(&labelNumFrequencyBands);
 	labelNumFrequencyBands.setText("Frequency bands", dontSendNotification);
 
@@ -53,10 +69,16 @@ AuralisationComponent::AuralisationComponent()
 	
 	addAndMakeVisible(&buttonDirectToBinaural);
 	buttonDirectToBinaural.addListener(this);
-	buttonDirectToBinaural.setButtonText("Direct to binaural");
+	buttonDirectToBinaural.setButtonText("Early to binaural");
 	buttonDirectToBinaural.setEnabled(true);
 	buttonDirectToBinaural.setToggleState(false, dontSendNotification);
 
+	addAndMakeVisible(&buttonSoundFieldRotation);
+	buttonSoundFieldRotation.addListener(this);
+	buttonSoundFieldRotation.setButtonText("Rotate sound field (head tracking)");
+	buttonSoundFieldRotation.setEnabled(true);
+	buttonSoundFieldRotation.setToggleState(false, dontSendNotification);
+
 	addAndMakeVisible(&comboNumFrequencyBands);
 	comboNumFrequencyBands.addListener(this);
 	comboNumFrequencyBands.setEditableText(false);
@@ -71,6 +93,20 @@ AuralisationComponent::AuralisationComponent()
 	comboSourceDirectivity.addItemList({ "omni", "directional" }, 1);
 	comboSourceDirectivity.setSelectedId(1);
 
+	addAndMakeVisible(&comboAmbisonicOrder);
+	comboAmbisonicOrder.addListener(this);
+	comboAmbisonicOrder.setEditableText(false);
+	comboAmbisonicOrder.setJustificationType(Justification::right);
+	for (int order = 1; order <= AMBI_ORDER; order++) { comboAmbisonicOrder.addItem(String(order), order); }
+	comboAmbisonicOrder.setSelectedId(AMBI_ORDER, dontSendNotification);
+
+	addAndMakeVisible(&comboMaxSceneUpdateRate);
+	comboMaxSceneUpdateRate.addListener(this);
+	comboMaxSceneUpdateRate.setEditableText(false);
+	comboMaxSceneUpdateRate.setJustificationType(Justification::right);
+	for (int rate : { 5, 10, 20, 30, 60 }) { comboMaxSceneUpdateRate.addItem(String(rate), rate); }
+	comboMaxSceneUpdateRate.setSelectedId(30, dontSendNotification);
+
 	addAndMakeVisible(&sliderDirectPathGain);
 	sliderDirectPathGain.addListener(this);
 	sliderDirectPathGain.setRange(0.0, 2.0);
@@ -99,6 +135,20 @@ AuralisationComponent::AuralisationComponent()
 	sliderCrossfadeFactor.setSliderStyle(Slider::LinearHorizontal);
 	sliderCrossfadeFactor.setTextBoxStyle(Slider::TextBoxRight, true, 70, 20);
 	sliderCrossfadeFactor.setSkewFactor(0.7);
+
+	addAndMakeVisible(&sliderNumBinauralImages);
+	sliderNumBinauralImages.addListener(this);
+	sliderNumBinauralImages.setRange(1, SourceImagesHandler::maxNumBinauralImages, 1);
+	sliderNumBinauralImages.setValue(1);
+	sliderNumBinauralImages.setSliderStyle(Slider::LinearHorizontal);
+	sliderNumBinauralImages.setTextBoxStyle(Slider::TextBoxRight, true, 70, 20);
+
+	addAndMakeVisible(&sliderSpreadFactor);
+	sliderSpreadFactor.addListener(this);
+	sliderSpreadFactor.setRange(0.0, 1.0);
+	sliderSpreadFactor.setValue(0.0);
+	sliderSpreadFactor.setSliderStyle(Slider::LinearHorizontal);
+	sliderSpreadFactor.setTextBoxStyle(Slider::TextBoxRight, true, 70, 20);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -127,6 +177,10 @@ void AuralisationComponent::buttonClicked(Button* button)
 		bool enable =button->getToggleState();
 		parent->enableDirectToBinaural(enable);
 	}
+	else if (button == &buttonSoundFieldRotation)
+	{
+		parent->enableSoundFieldRotation(button->getToggleState());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -145,6 +199,14 @@ void AuralisationComponent::comboBoxChanged(ComboBox* comboBox)
 		String value = comboBox->getText();
 		parent->updateSourceDirectivity(value);
 	}
+	else if (comboBox == &comboAmbisonicOrder)
+	{
+		parent->updateAmbisonicOrder(comboBox->getSelectedId());
+	}
+	else if (comboBox == &comboMaxSceneUpdateRate)
+	{
+		parent->updateMaxSceneUpdateRate(comboBox->getSelectedId());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -169,6 +231,14 @@ void AuralisationComponent::sliderValueChanged(Slider* slider)
 	{
 		parent->updateCrossfadeFactor(slider->getValue());
 	}
+	else if (slider == &sliderNumBinauralImages)
+	{
+		parent->updateNumBinauralImages((int)slider->getValue());
+	}
+	else if (slider == &sliderSpreadFactor)
+	{
+		parent->updateSpreadFactor(slider->getValue());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -184,7 +254,7 @@ void AuralisationComponent::paint(Graphics& g)
 
 void AuralisationComponent::resized()
 {
-	int h = (getHeight() - 40) / 5;
+	int h = (getHeight() - 40) / 7;
 	int w = (getWidth() - 40) / 20;
 
 	Font labelFont = labelAuralisation.getFont();
@@ -194,18 +264,27 @@ void AuralisationComponent::resized()
 	labelEarlyReflectionsGain.setBounds(20, 20 + h, 4 * w, h);
 	labelReverbTail.setBounds(20, 20 + 2 * h, 4 * w, h);
 	labelCrossfadeFactor.setBounds(20, 20 + 3 * h, 4 * w, h);
-	buttonReverbTail.setBounds(20, 20 + 4 * h, 4 * w, h);
+	labelNumBinauralImages.setBounds(20, 20 + 4 * h, 4 * w, h);
+	buttonReverbTail.setBounds(20, 20 + 5 * h, 4 * w, h);
 	sliderDirectPathGain.setBounds(20 + 4 * w, 20, 16 * w, h);
 	sliderEarlyReflectionsGain.setBounds(20 + 4 * w, 20 + h, 16 * w, h);
 	sliderReverbTailGain.setBounds(20 + 4 * w, 20 + 2 * h, 16 * w, h);
-	sliderCrossfadeFactor.setBounds(20 + 4 * w, 20 + 3 * h, 16 * w, h);
-	buttonDirectToBinaural.setBounds(20 + 4 * w, 20 + 4 * h, 4 * w, h);
-	labelNumFrequencyBands.setBounds(20 + 8 * w, 20 + 4 * h, 4 * w, h / 2);
-	labelSourceDirectivity.setBounds(20 + 8 * w, 20 + 4.5 * h, 4 * w, h / 2);
-	comboNumFrequencyBands.setBounds(20 + 12 * w, 20 + 4 * h, 2 * w, h / 2);
-	comboSourceDirectivity.setBounds(20 + 12 * w, 20 + 4.5 * h, 2 * w, h / 2);
-	buttonSaveRIR.setBounds(pad(20 + 14 * w, 20 + 4 * h, 3 * w, h));
-	buttonClearSourceImage.setBounds(pad(20 + 17 * w, 20 + 4 * h, 3 * w, h));
+	sliderCrossfadeFactor.setBounds(20 + 4 * w, 20 + 3 * h, 10 * w, h);
+	labelMaxSceneUpdateRate.setBounds(20 + 14 * w, 20 + 3 * h, 4 * w, h);
+	comboMaxSceneUpdateRate.setBounds(20 + 18 * w, 20 + 3.25 * h, 2 * w, h / 2);
+	sliderNumBinauralImages.setBounds(20 + 4 * w, 20 + 4 * h, 10 * w, h);
+	labelAmbisonicOrder.setBounds(20 + 14 * w, 20 + 4 * h, 4 * w, h);
+	comboAmbisonicOrder.setBounds(20 + 18 * w, 20 + 4.25 * h, 2 * w, h / 2);
+	buttonDirectToBinaural.setBounds(20 + 4 * w, 20 + 5 * h, 4 * w, h);
+	labelNumFrequencyBands.setBounds(20 + 8 * w, 20 + 5 * h, 4 * w, h / 2);
+	labelSourceDirectivity.setBounds(20 + 8 * w, 20 + 5.5 * h, 4 * w, h / 2);
+	comboNumFrequencyBands.setBounds(20 + 12 * w, 20 + 5 * h, 2 * w, h / 2);
+	comboSourceDirectivity.setBounds(20 + 12 * w, 20 + 5.5 * h, 2 * w, h / 2);
+	buttonSaveRIR.setBounds(pad(20 + 14 * w, 20 + 5 * h, 3 * w, h));
+	buttonClearSourceImage.setBounds(pad(20 + 17 * w, 20 + 5 * h, 3 * w, h));
+	buttonSoundFieldRotation.setBounds(20, 20 + 6 * h, 8 * w, h);
+	labelSpreadFactor.setBounds(20 + 8 * w, 20 + 6 * h, 4 * w, h);
+	sliderSpreadFactor.setBounds(20 + 12 * w, 20 + 6 * h, 8 * w, h);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1,4 +1,5 @@
 #include <array>
+#include <algorithm>
 #include <math.h>
 
 #include "BinauralEncoder.h"
@@ -6,27 +7,42 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-BinauralEncoder::BinauralEncoder()
-{
-	// load HRIR filters
-	File hrirFile = getFileFromString("irs/ClubFritz1_hrir.bin");
-	loadHrir(hrirFile);
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
 void BinauralEncoder::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 // local equivalent of prepareToPlay
 {
+	// HRIR set resampled to the engine sample rate if they differ (see setTargetPosition)
+	hrirRateRatio = sampleRate / hrirStore->getSampleRate();
+	hrirLength = hrirRateRatio == 1.0 ? hrirStore->getHrirLength() : (int)ceil(hrirStore->getHrirLength() * hrirRateRatio);
+
 	// resize FIR
+	hrirFir.init(samplesPerBlockExpected, hrirLength, 1, 2);
+	chunkBuffer.setSize(3, samplesPerBlockExpected);
+	for (int i = 0; i < 2; i++)
+	{
+		hrir[i].resize(hrirStore->getHrirLength());
+		hrirResampled[i].resize(hrirLength);
+	}
+
+	// resize delay lines (max ITD + linear interpolation neighbour)
+	int delayBufferSize = nextPowerOf2(samplesPerBlockExpected + (int)ceil(hrirStore->getMaxDelay() * hrirRateRatio) + 2);
 	for (int i = 0; i < 2; i++)
 	{
-		hrirFirFuture[i].init(samplesPerBlockExpected, HRIR_LENGTH);
-		hrirFir[i].init(samplesPerBlockExpected, HRIR_LENGTH);
+		delayBuffers[i].assign(delayBufferSize, 0.f);
+		delayPast[i] = delayFuture[i] = delayCurrent[i] = 0.f;
 	}
+	delayWriteIndex = 0;
 
-	// resize buffers
-	workingBuffer.setSize(1, samplesPerBlockExpected);
+	// resize HRTF buffers
+	for (int i = 0; i < 2; i++)
+	{
+		hrtfPast[i].assign(hrirFir.getNumBins(), 0.f);
+		hrtfFuture[i].assign(hrirFir.getNumBins(), 0.f);
+		hrtfTarget[i].assign(hrirFir.getNumBins(), 0.f);
+		hrtfScratch[i].assign(hrirFir.getNumBins(), 0.f);
+	}
+	hrtfInterp.assign(hrirFir.getNumBins(), 0.f);
+	targetChanged = false;
+	targetReassigned = false;
 
 	// keep local copies
 	localSampleRate = sampleRate;
@@ -36,36 +52,86 @@ void BinauralEncoder::prepareToPlay(int samplesPerBlockExpected, double sampleRa
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void BinauralEncoder::encodeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination)
-// binaural encoding of source 1st channel (mono) to destination (stereo)
+// binaural encoding of source 1st channel (mono) to destination (stereo), in chunks of at most
+// samplesPerBlockExpected samples. A shorter chunk (buffers not a multiple of the block size) is
+// filtered zero padded, its filter tail then overlapping the next one: exact at the end of a stream.
 {
-	// update crossfade
+	// start crossfade towards latest target, if any, and update crossfade
+	fetchTarget();
 	updateCrossfade();
 
-	for (int i = 0; i < 2; i++)
+	// crossfade in the frequency domain: a single convolution whatever the crossfade state
+	if (!crossfadeOver)
 	{
-		// copy 1st channel of mono source to ith channel of destination
-		destination.copyFrom(i, 0, source, 0, 0, localSamplesPerBlockExpected);
+		for (int i = 0; i < 2; i++)
+		{
+			for (size_t k = 0; k < hrtfInterp.size(); k++)
+			{
+				hrtfInterp[k] = (1.0f - crossfadeGain) * hrtfPast[i][k] + crossfadeGain * hrtfFuture[i][k];
+			}
+			hrirFir.setTransferFunction(0, i, hrtfInterp.data());
+		}
+	}
+
+	const int numSamples = jmin(source.getNumSamples(), destination.getNumSamples());
+	for (int startSample = 0; startSample < numSamples; startSample += localSamplesPerBlockExpected)
+	{
+		const int chunkSize = jmin(localSamplesPerBlockExpected, numSamples - startSample);
+		const bool isPartialChunk = chunkSize < localSamplesPerBlockExpected;
 
-		if (crossfadeOver)
+		// apply FIR
+		const float* input = source.getReadPointer(0, startSample);
+		float* outputs[2] = { destination.getWritePointer(0, startSample), destination.getWritePointer(1, startSample) };
+		if (isPartialChunk)
 		{
-			// simply apply FIR
-			hrirFir[i].process(destination.getWritePointer(i));
+			chunkBuffer.clear();
+			chunkBuffer.copyFrom(0, 0, input, chunkSize);
+			input = chunkBuffer.getReadPointer(0);
+			outputs[0] = chunkBuffer.getWritePointer(1);
+			outputs[1] = chunkBuffer.getWritePointer(2);
 		}
-		else
+		hrirFir.process(&input, outputs);
+		if (isPartialChunk)
 		{
-			// duplicate input buffer
-			workingBuffer.copyFrom(0, 0, destination, i, 0, localSamplesPerBlockExpected);
+			destination.copyFrom(0, startSample, chunkBuffer, 1, 0, chunkSize);
+			destination.copyFrom(1, startSample, chunkBuffer, 2, 0, chunkSize);
+		}
 
-			// apply past and future FIRs
-			hrirFir[i].process(destination.getWritePointer(i));
-			hrirFirFuture[i].process(workingBuffer.getWritePointer(0));
+		// apply ITD
+		applyDelays(destination, startSample, chunkSize);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-			// crossfade mix
-			destination.applyGain(i, 0, localSamplesPerBlockExpected, 1.0f - crossfadeGain);
-			workingBuffer.applyGain(crossfadeGain);
-			destination.addFrom(i, 0, workingBuffer, 0, 0, localSamplesPerBlockExpected);
+void BinauralEncoder::applyDelays(AudioBuffer<float>& destination, const int startSample, const int numSamples)
+// delay each ear (fractional, linear interpolation), delay ramped from last chunk value to target.
+// numSamples at most samplesPerBlockExpected (delay buffers size).
+{
+	const int mask = (int)delayBuffers[0].size() - 1;
+	for (int earId = 0; earId < 2; earId++)
+	{
+		float* samples = destination.getWritePointer(earId, startSample);
+		float* buffer = delayBuffers[earId].data();
+
+		// write block
+		for (int n = 0; n < numSamples; n++) { buffer[(delayWriteIndex + n) & mask] = samples[n]; }
+
+		// read with ramped delay
+		const float delayTarget = crossfadeOver ? delayPast[earId] : (1.0f - crossfadeGain) * delayPast[earId] + crossfadeGain * delayFuture[earId];
+		const float delayStep = (delayTarget - delayCurrent[earId]) / numSamples;
+		float delay = delayCurrent[earId];
+		for (int n = 0; n < numSamples; n++)
+		{
+			delay += delayStep;
+			const int delayInt = (int)delay;
+			const float frac = delay - delayInt;
+			const int readIndex = delayWriteIndex + n - delayInt;
+			samples[n] = (1.0f - frac) * buffer[readIndex & mask] + frac * buffer[(readIndex - 1) & mask];
 		}
+		delayCurrent[earId] = delayTarget;
 	}
+	delayWriteIndex = (delayWriteIndex + numSamples) & mask;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -76,7 +142,7 @@ void BinauralEncoder::updateCrossfade()
 	// either update crossfade
 	if (crossfadeGain < 1.0)
 	{
-		crossfadeGain = fmin(crossfadeGain + 0.1, 1.0);
+		crossfadeGain = fmin(crossfadeGain + crossfadeStep, 1.0);
 	}
 	// or stop crossfade mechanism if not already stopped
 	else if (!crossfadeOver)
@@ -84,7 +150,9 @@ void BinauralEncoder::updateCrossfade()
 		// set past = future
 		for (int earId = 0; earId < 2; earId++)
 		{
-			hrirFir[earId] = hrirFirFuture[earId];
+			hrirFir.setTransferFunction(0, earId, hrtfFuture[earId].data());
+			hrtfPast[earId] = hrtfFuture[earId];
+			delayPast[earId] = delayFuture[earId];
 		}
 
 		// reset crossfade internals
@@ -95,95 +163,128 @@ void BinauralEncoder::updateCrossfade()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BinauralEncoder::setPosition(double azim, double elev)
-// set current HRIR filters
+void BinauralEncoder::setTargetPosition(double azim, double elev, bool reassigned)
+// Scene thread: HRIR filters of a direction, crossfaded to from next encodeBuffer on (reassigned:
+// encoder newly assigned to a source image, filter tail cleared and filters switched directly).
+// Only the copy of the result is locked, never the HRIR interpolation / transfer functions.
 {
-	// get azim / elev indices in hrir array along with associated gains for panning across HRIR
-	// (panning across 4 nearest neighbors (in azim/elev) of current position
-
 	// TODO: fix temporary workaround
 	if (azim < -M_PI || azim > M_PI || elev < -M_PI / 2 || elev > M_PI / 2) return;
 
-	// make sure values are in expected range
-	jassert(azim >= -M_PI && azim <= M_PI);
-  jassert(elev >= -M_PI / 2 && elev <= M_PI / 2);
-
-	// rad 2 deg
-	azim *= (180 / M_PI);
-	elev *= (180 / M_PI);
-
-	// mapping to hrir coordinates
-	elev += 90.f;
-	azim *= -1.f;
-	if (azim < 0) { azim += 360.f; }
+	// min-phase HRIR and ITD (interpolated across nearest HRIR set positions), and HRTF (resampled
+	// to engine sample rate if need be, transfer function computed with its own FFT scratch)
+	hrirStore->getInterpolatedHrir(azim, elev, hrir[0].data(), hrir[1].data(), delayScratch.data());
+	for (int earId = 0; earId < 2; earId++)
+	{
+		const float* ir = hrir[earId].data();
+		if (hrirRateRatio != 1.0)
+		{
+			resampleHrir(ir, hrirResampled[earId].data());
+			ir = hrirResampled[earId].data();
+			delayScratch[earId] *= (float)hrirRateRatio;
+		}
+		hrirFir.computeTransferFunction(ir, hrtfScratch[earId].data());
+	}
 
-	// get azim / elev neighboring indices
-	azimId[0] = fmod(std::floor(azim / AZIM_STEP), N_AZIM_VALUES);
-	azimId[1] = azimId[0] + 1;
-	elevId[0] = fmod(std::floor(elev / ELEV_STEP), N_ELEV_VALUES);
-	elevId[1] = elevId[0] + 1;
+	const SpinLock::ScopedLockType lock(targetLock);
+	for (int earId = 0; earId < 2; earId++)
+	{
+		std::copy(hrtfScratch[earId].begin(), hrtfScratch[earId].end(), hrtfTarget[earId].begin());
+	}
+	delayTarget = delayScratch;
+	targetChanged = true;
+	targetReassigned = targetReassigned || reassigned;
+}
 
-	// deal with extrema
-	if (elevId[0] == (N_ELEV_VALUES - 1)) { elevId[1] = elevId[0] - 1; }
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	// get associated gains
-	double azimGainHigh = fmod((azim / AZIM_STEP), N_AZIM_VALUES) - azimId[0];
-	double elevGainHigh = fmod((elev / ELEV_STEP), N_ELEV_VALUES) - elevId[0];
+void BinauralEncoder::fetchTarget()
+// Render thread: start crossfade towards latest target (see setTargetPosition), skipped if being
+// written (picked up next block)
+{
+	if (!targetLock.tryEnter()) { return; }
+	if (!targetChanged)
+	{
+		targetLock.exit();
+		return;
+	}
 
-	// fill hrir array
-	for (int earId = 0; earId < 2; earId++)
+	// if called mid-crossfade, start the new crossfade from where the current one stands
+	if (!crossfadeOver)
 	{
-		for (int i = 0; i < hrir[0].size(); ++i)
+		for (int earId = 0; earId < 2; earId++)
 		{
-			hrir[earId][i] =
-				(1.0f - azimGainHigh) * (1.0f - elevGainHigh) * hrirDict[azimId[0]][elevId[0]][earId][i] // low low
-				+ (1.0f - azimGainHigh) * elevGainHigh * hrirDict[azimId[0]][elevId[1]][earId][i] // low high
-				+ azimGainHigh * (1.0f - elevGainHigh) * hrirDict[azimId[1]][elevId[0]][earId][i] // high low
-				+ azimGainHigh * elevGainHigh * hrirDict[azimId[1]][elevId[1]][earId][i]; // high high
+			for (size_t k = 0; k < hrtfPast[earId].size(); k++)
+			{
+				hrtfPast[earId][k] = (1.0f - crossfadeGain) * hrtfPast[earId][k] + crossfadeGain * hrtfFuture[earId][k];
+			}
+			delayPast[earId] = (1.0f - crossfadeGain) * delayPast[earId] + crossfadeGain * delayFuture[earId];
 		}
+	}
 
-		// update FIR content
-		hrirFirFuture[earId].setImpulseResponse(hrir[earId].data());
+	for (int earId = 0; earId < 2; earId++)
+	{
+		std::copy(hrtfTarget[earId].begin(), hrtfTarget[earId].end(), hrtfFuture[earId].begin());
+	}
+	delayFuture = delayTarget;
+	const bool reassigned = targetReassigned;
+	targetChanged = false;
+	targetReassigned = false;
+	targetLock.exit();
+
+	// either switch filters directly (encoder newly assigned to a source image) ..
+	if (reassigned)
+	{
+		reset();
+		delayCurrent = delayFuture;
+		crossfadeGain = 1.0f;
+		crossfadeOver = false;
+		updateCrossfade();
+		return;
 	}
 
-	// trigger crossfade mechanism
+	// .. or trigger crossfade mechanism
 	crossfadeGain = 0.0f;
 	crossfadeOver = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void BinauralEncoder::loadHrir(const File& hrirFile)
-// load a given HRIR set
+void BinauralEncoder::resampleHrir(const float* input, float* output) const
+// Resample HRIR from HRIR set to engine sample rate: Blackman windowed sinc interpolation, low
+// passed below the lowest of both Nyquist frequencies, scaled to keep the filter gain unchanged
 {
-	// open file
-	FileInputStream istream_hrir(hrirFile);
-	if (istream_hrir.openedOk())
-	{
-		// if hrirDict_ has already been filled with an HRIR, skip insert step below
-		bool rewriteHrirDict = false;
-		if (hrirDict.size() > 0) { rewriteHrirDict = true; }
+	const int inputLength = hrirStore->getHrirLength();
+	const double cutoff = jmin(1.0, hrirRateRatio); // relative to HRIR set Nyquist
+	const double halfWidth = 8.0 / cutoff; // in HRIR set samples
+	const double gain = cutoff / hrirRateRatio;
 
-		// loop over array first dimension (azim values)
-		for (int j = 0; j < N_AZIM_VALUES; ++j) // loop azim
+	for (int n = 0; n < hrirLength; n++)
+	{
+		const double centre = n / hrirRateRatio; // in HRIR set samples
+		const int first = jmax(0, (int)ceil(centre - halfWidth));
+		const int last = jmin(inputLength - 1, (int)floor(centre + halfWidth));
+		double sum = 0.0;
+		for (int k = first; k <= last; k++)
 		{
-			// resize
-			if (!rewriteHrirDict)
-			{
-				hrirDict.insert(std::make_pair(j, std::array<HrirBuffer, N_ELEV_VALUES>()));
-			}
-
-			// loop over elev values
-			for (int i = 0; i < N_ELEV_VALUES; ++i) // loop elev
-			{
-				istream_hrir.read(hrirDict[j][i][0].data(), HRIR_LENGTH * sizeof(float));
-				istream_hrir.read(hrirDict[j][i][1].data(), HRIR_LENGTH * sizeof(float));
-			}
+			const double x = k - centre;
+			const double sinc = x == 0.0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+			const double phase = M_PI * (x / halfWidth + 1.0); // 0 .. 2 pi over the window
+			const double window = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2.0 * phase);
+			sum += input[k] * sinc * window;
 		}
+		output[n] = (float)(gain * sum);
 	}
-	// if file failed to open
-	else { throw std::ios_base::failure("Failed to open HRIR file"); }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+
+void BinauralEncoder::reset()
+// clear filter tail (render thread, before encoder renders another source image)
+{
+	hrirFir.reset();
+	for (int i = 0; i < 2; i++) { std::fill(delayBuffers[i].begin(), delayBuffers[i].end(), 0.f); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -16,7 +16,8 @@ DirectivityHandler::~DirectivityHandler()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void DirectivityHandler::loadFile(const String& filenameStr)
+bool DirectivityHandler::loadFile(const String& filenameStr)
+// Load sofa directivity file, false if it failed (directivity then left omni), reported by caller
 {
 	// get file path
 	File hrirFile = getFileFromString(filenameStr);
@@ -31,7 +32,10 @@ void DirectivityHandler::loadFile(const String& filenameStr)
 	//	return;
 	//}
 
-		// load
+	// release previously loaded file
+	if (isLoaded) { mysofa_close(sofaEasyStruct); }
+
+	// load
 	int err;
 	filter_length = 0;
 	sofaEasyStruct = mysofa_open_no_norm(filename, sampleRate, &filter_length, &err);
@@ -42,45 +46,249 @@ void DirectivityHandler::loadFile(const String& filenameStr)
 	// check if expected size matches actual
 	jassert(filter_length == FILTER_LENGTH);
 
-	// resize locals
-	dirGains.resize(2 * filter_length);
-
 	// warn if error
 	if (sofaEasyStruct == NULL)
 	{
 		isLoaded = false;
-		AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "failed to load file", filenameStr, "OK");
+		DBG(String("failed to load file: ") + filenameStr);
 	}
 	else { isLoaded = true; }
 
+	// precompute gains on dense grid, and their SH expansion
+	computeLookupTables();
+	fitSphericalHarmonics();
+
 	// print info
 	// printGains( 8, 15 );
+
+	return isLoaded;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DirectivityHandler::computeLookupTables()
+// query libmysofa once per grid point, for both 10 and 3 bands layouts
+{
+	if (!isLoaded || filter_length != FILTER_LENGTH)
+	{
+		grid10 = nullptr;
+		grid3 = nullptr;
+		return;
+	}
+
+	// allocate with margin to align grid pointers
+	const int numPoints = GRID_N_AZIM * GRID_N_ELEV;
+	gridStorage10.assign(numPoints * GRID_STRIDE_10 + 16, 0.f);
+	gridStorage3.assign(numPoints * GRID_STRIDE_3 + 16, 0.f);
+	float* table10 = gridStorage10.data() + (16 - ((uintptr_t)gridStorage10.data() / sizeof(float)) % 16) % 16;
+	float* table3 = gridStorage3.data() + (16 - ((uintptr_t)gridStorage3.data() / sizeof(float)) % 16) % 16;
+	FloatVectorOperations::fill(maxGains10, 0.f, FILTER_LENGTH);
+	FloatVectorOperations::fill(maxGains3, 0.f, 3);
+
+	for (int elevId = 0; elevId < GRID_N_ELEV; elevId++)
+	{
+		for (int azimId = 0; azimId < GRID_N_AZIM; azimId++)
+		{
+			float azim = (float)(azimId * GRID_STEP_DEG * M_PI / 180.0);
+			float elev = (float)((elevId * GRID_STEP_DEG - 90) * M_PI / 180.0);
+
+			// sph to cart
+			float x = cosf(elev) * cosf(azim);
+			float y = cosf(elev) * sinf(azim);
+			float z = sinf(elev);
+
+			// get interpolated gain value (only real part is used)
+			mysofa_getfilter_float(sofaEasyStruct, x, y, z, leftIR, rightIR, &leftDelay, &rightDelay);
+
+			int pointId = elevId * GRID_N_AZIM + azimId;
+			float* gains10 = table10 + pointId * GRID_STRIDE_10;
+			for (int i = 0; i < FILTER_LENGTH; i++)
+			{
+				gains10[i] = leftIR[i];
+				maxGains10[i] = fmax(maxGains10[i], leftIR[i]);
+			}
+
+			std::vector<float> gains3 = from10to3bands(std::vector<float>(gains10, gains10 + FILTER_LENGTH));
+			for (int i = 0; i < 3; i++)
+			{
+				table3[pointId * GRID_STRIDE_3 + i] = gains3[i];
+				maxGains3[i] = fmax(maxGains3[i], gains3[i]);
+			}
+		}
+	}
+
+	grid10 = table10;
+	grid3 = table3;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DirectivityHandler::fitSphericalHarmonics()
+// weighted (grid point area) least-squares fit of each band pattern to SH_ORDER expansion
+{
+	if (grid10 == nullptr)
+	{
+		shCoefs10.resize(0, 0);
+		shCoefs3.resize(0, 0);
+		return;
+	}
+
+	// fit on grid points (skip duplicated 360deg column)
+	const int numAzim = GRID_N_AZIM - 1;
+	const int numPoints = numAzim * GRID_N_ELEV;
+	Eigen::MatrixXd basis(numPoints, SH_NUM_COEFS);
+	Eigen::MatrixXd values(numPoints, FILTER_LENGTH);
+	Eigen::VectorXd weights(numPoints);
+	for (int elevId = 0; elevId < GRID_N_ELEV; elevId++)
+	{
+		for (int azimId = 0; azimId < numAzim; azimId++)
+		{
+			double azim = azimId * GRID_STEP_DEG * M_PI / 180.0;
+			double elev = (elevId * GRID_STEP_DEG - 90) * M_PI / 180.0;
+			int row = elevId * numAzim + azimId;
+
+			sphericalHarmonic.Calc(azim, elev);
+			basis.row(row) = sphericalHarmonic.Ymn.transpose();
+			for (int k = 0; k < FILTER_LENGTH; k++) { values(row, k) = grid10[(elevId * GRID_N_AZIM + azimId) * GRID_STRIDE_10 + k]; }
+			weights(row) = fmax(cos(elev), 1e-3);
+		}
+	}
+
+	// normal equations, slightly regularized
+	Eigen::MatrixXd normalMatrix = basis.transpose() * weights.asDiagonal() * basis;
+	normalMatrix.diagonal().array() += 1e-6 * normalMatrix.trace() / SH_NUM_COEFS;
+	Eigen::MatrixXd coefs = normalMatrix.ldlt().solve(basis.transpose() * weights.asDiagonal() * values);
+
+	// 10 bands, and 3 bands (linear combination, see from10to3bands)
+	shCoefs10 = coefs.cast<float>();
+	shCoefs3.resize(SH_NUM_COEFS, 3);
+	shCoefs3.col(0) = shCoefs10.leftCols(5).rowwise().mean();
+	shCoefs3.col(1) = shCoefs10.middleCols(5, 4).rowwise().mean();
+	shCoefs3.col(2) = shCoefs10.col(9);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-Array<float> DirectivityHandler::getGains(const double azim, const double elev)
+void DirectivityHandler::setOrientation(const Eigen::Matrix3f& rotationMatrix)
+// rotate directivity pattern: gain of direction d read from the pattern at rotationMatrix^T * d (e.g.
+// source orientation, directions then given in world frame), no need to re-query or re-fit the pattern
 {
-	// make sure values are in expected range
-	jassert(azim >= -M_PI - 0.0001 && azim <= M_PI + 0.0001);
-	jassert(elev >= -M_PI / 2 - 0.0001 && elev <= M_PI / 2 + 0.0001);
+	orientation = rotationMatrix;
+	hasOrientation = !rotationMatrix.isIdentity();
+}
 
-	// sph to cart
-	float x = cosf(elev) * cosf(azim);
-	float y = cosf(elev) * sinf(azim);
-	float z = sinf(elev);
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DirectivityHandler::getGains(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride)
+// band gains (numBands = 10 or 3) for numDirections directions, output gains
+// [direction * gainsStride + band]. No libmysofa query.
+{
+	jassert(numBands <= FILTER_LENGTH);
+	jassert(gainsStride >= numBands);
+
+	// directions rotated to pattern frame if need be (omni: no need)
+	if (hasOrientation && grid10 != nullptr) { rotateDirections(azims, elevs, numDirections); }
+
+	if (useSphericalHarmonics && shCoefs10.size() > 0)
+	{
+		getGainsFromSphericalHarmonics(azims, elevs, numDirections, numBands, gains, gainsStride);
+	}
+	else
+	{
+		getGainsFromTable(azims, elevs, numDirections, numBands, gains, gainsStride);
+	}
+}
 
-	// get interpolated gain value
-	mysofa_getfilter_float(sofaEasyStruct, x, y, z, leftIR, rightIR, &leftDelay, &rightDelay);
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	// fill output
-	for (int i = 0; i < FILTER_LENGTH; i++)
+void DirectivityHandler::rotateDirections(const float*& azims, const float*& elevs, const int numDirections)
+// directions from source frame to pattern frame, azims / elevs then pointing to rotated ones
+{
+	if (rotatedAzims.size() < numDirections) { rotatedAzims.resize(numDirections); rotatedElevs.resize(numDirections); }
+	for (int j = 0; j < numDirections; j++)
 	{
-		dirGains.set(i, (float)(leftIR[i]));
-		dirGains.set(FILTER_LENGTH + i, (float)(rightIR[i]));
+		// SPAT convention, see cartesianToSpherical
+		Eigen::Vector3f direction(cosf(elevs[j]) * sinf(azims[j]), cosf(elevs[j]) * cosf(azims[j]), sinf(elevs[j]));
+		direction = orientation.transpose() * direction;
+		rotatedAzims[j] = atan2f(direction(0), direction(1));
+		rotatedElevs[j] = asinf(jlimit(-1.f, 1.f, direction(2)));
 	}
+	azims = rotatedAzims.data();
+	elevs = rotatedElevs.data();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	return dirGains;
+void DirectivityHandler::getGainsFromSphericalHarmonics(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride)
+// gains = SH basis of all directions (numDirections x SH_NUM_COEFS) * SH coefficients, clamped to
+// [0, max measured gain] of each band (truncated expansion rings / goes negative near nulls)
+{
+	typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrix;
+
+	// SH basis of each direction
+	if (shBasis.size() < numDirections * SH_NUM_COEFS) { shBasis.resize(numDirections * SH_NUM_COEFS); }
+	sphericalHarmonic.CalcBatch(azims, elevs, numDirections, shBasis.data(), SH_NUM_COEFS);
+
+	// single matrix product for all directions and bands
+	Eigen::Map<const RowMajorMatrix> basis(shBasis.data(), numDirections, SH_NUM_COEFS);
+	Eigen::Map<RowMajorMatrix, 0, Eigen::OuterStride<>> output(gains, numDirections, numBands, Eigen::OuterStride<>(gainsStride));
+	if (numBands == 3) { output.noalias() = basis * shCoefs3; }
+	else { output.noalias() = basis * shCoefs10.leftCols(numBands); }
+
+	const float* maxGains = numBands == 3 ? maxGains3 : maxGains10;
+	for (int j = 0; j < numDirections; j++)
+	{
+		float* out = gains + j * gainsStride;
+		for (int k = 0; k < numBands; k++) { out[k] = jlimit(0.f, maxGains[k], out[k]); }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DirectivityHandler::getGainsFromTable(const float* azims, const float* elevs, const int numDirections, const int numBands, float* gains, const int gainsStride) const
+// bilinear read of band gains in lookup tables. No allocation.
+{
+	// no directivity loaded: omni
+	const float* grid = numBands == 3 ? grid3 : grid10;
+	if (grid == nullptr)
+	{
+		for (int j = 0; j < numDirections; j++) { FloatVectorOperations::fill(gains + j * gainsStride, 1.0f, numBands); }
+		return;
+	}
+	const int stride = numBands == 3 ? GRID_STRIDE_3 : GRID_STRIDE_10;
+	const float invStep = (float)(180.0 / (M_PI * GRID_STEP_DEG));
+
+	for (int j = 0; j < numDirections; j++)
+	{
+		// make sure values are in expected range
+		jassert(azims[j] >= -M_PI - 0.0001 && azims[j] <= M_PI + 0.0001);
+		jassert(elevs[j] >= -M_PI / 2 - 0.0001 && elevs[j] <= M_PI / 2 + 0.0001);
+
+		// grid coordinates
+		float u = (azims[j] < 0.f ? azims[j] + 2.f * (float)M_PI : azims[j]) * invStep;
+		float v = (elevs[j] + 0.5f * (float)M_PI) * invStep;
+		u = jlimit(0.f, (float)(GRID_N_AZIM - 1), u);
+		v = jlimit(0.f, (float)(GRID_N_ELEV - 1), v);
+		const int azimId = jmin((int)u, GRID_N_AZIM - 2);
+		const int elevId = jmin((int)v, GRID_N_ELEV - 2);
+		const float fu = u - azimId;
+		const float fv = v - elevId;
+
+		// bilinear interpolation
+		const float* g00 = grid + (elevId * GRID_N_AZIM + azimId) * stride;
+		const float* g01 = g00 + stride;
+		const float* g10 = g00 + GRID_N_AZIM * stride;
+		const float* g11 = g10 + stride;
+		const float w00 = (1.f - fu) * (1.f - fv);
+		const float w01 = fu * (1.f - fv);
+		const float w10 = (1.f - fu) * fv;
+		const float w11 = fu * fv;
+		float* out = gains + j * gainsStride;
+		for (int k = 0; k < numBands; k++)
+		{
+			out[k] = w00 * g00[k] + w01 * g01[k] + w10 * g10[k] + w11 * g11[k];
+		}
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,437 @@
+#include "EvertimsEngine.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+EvertimsEngine::EvertimsEngine(const Mode engineMode) :
+	mode(engineMode),
+	scene(engineMode == realtime)
+{
+	// One delay line per source
+	for (int s = 0; s < SourceImagesHandler::maxNumSources; s++) { delayLines.add(new DelayLine<float>()); }
+	sourceInputChannels.resize(SourceImagesHandler::maxNumSources, nullptr);
+
+	// Source images update (scene thread, or host thread in commitScene)
+	scene.setSceneListener(this);
+	sourceImagesHandler.setProfiler(&profiler);
+	sourceImagesHandler.setFilterBankSize(numFreqBands);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+EvertimsEngine::~EvertimsEngine()
+{
+	// Stop scene thread callbacks before members are destroyed
+	scene.setSceneListener(nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::prepare(const double sampleRate, const int blockSize, const int numInputs, const int numOutputs)
+// Allocate everything for blocks of blockSize samples, numInputs source inputs and numOutputs
+// output channels (see getNumChannelsPerListener). Not to be called concurrently with process.
+{
+	localSampleRate = sampleRate;
+	localBlockSize = blockSize;
+	numInputChannels = jmin(numInputs, (int)SourceImagesHandler::maxNumSources);
+	numOutputChannels = numOutputs;
+	numSamplesProcessed = 0;
+
+	// Ambisonic order and output format only change here
+	format = nextOutputFormat;
+	const int numAmbiChannels = getNumAmbiChannels(nextAmbisonicOrder);
+	numChannelsPerListener = getNumChannelsPerListener();
+	numOutputListeners = jlimit(1, (int)SourceImagesHandler::maxNumListeners, (numOutputs + numChannelsPerListener - 1) / numChannelsPerListener);
+
+	// Buffers: listeners without output channels are not rendered (see SourceImagesHandler::getNextAudioBlock)
+	silentInput.setSize(1, blockSize);
+	silentInput.clear();
+	ambisonicBuffer.setSize(numOutputListeners * (2 + numAmbiChannels), blockSize);
+	binauralBuffer.setSize(2, blockSize);
+
+	// Initialise the DelayLines to be able to hold 1 second of samples.
+	for (auto* delayLine : delayLines)
+	{
+		delayLine->prepareToPlay(blockSize, sampleRate);
+		delayLine->setSize(1, sampleRate);
+	}
+	numDelayLinesUsed = 0;
+
+	sourceImagesHandler.setAmbisonicOrder(nextAmbisonicOrder);
+	sourceImagesHandler.prepareToPlay(blockSize, sampleRate);
+	scene.requestUpdate(); // Reverb tail FDN gains depend on the sample rate.
+	updateSceneCommitInterval();
+
+	// Initialise ambi 2 bin decoding (binaural outputs only)
+	ambi2binFilters.clear();
+	if (format == ambisonicOutput) { return; }
+	ambi2binContainer.setAmbisonicOrder(nextAmbisonicOrder);
+	for (int l = 0; l < numOutputListeners; l++)
+	{
+		auto* ambi2binFilter = ambi2binFilters.add(new MultichannelFIRFilter());
+		ambi2binFilter->init(blockSize, AMBI2BIN_IR_LENGTH, numAmbiChannels, 2);
+		for (int i = 0; i < numAmbiChannels; i++)
+		{
+			ambi2binFilter->setImpulseResponse(i, 0, ambi2binContainer.ambi2binIrDict[i][0].data()); // [ch x ear x sampID]
+			ambi2binFilter->setImpulseResponse(i, 1, ambi2binContainer.ambi2binIrDict[i][1].data()); // [ch x ear x sampID]
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::process(const float* const* inputs, float** outputs, const int numSamples)
+// Render one block: inputs holds numInputs channels, outputs numOutputs channels (see prepare),
+// of numSamples = blockSize samples. Inputs and outputs may alias.
+{
+	jassert(numSamples == localBlockSize);
+	ignoreUnused(numSamples);
+
+	// Start crossfade towards latest source images state published by the scene thread
+	if (sourceImagesHandler.acquireUpdate()) { requireDelayLineSizeUpdate = true; }
+
+	// One input per source, silence for sources the host has no input for
+	for (int s = 0; s < SourceImagesHandler::maxNumSources; s++)
+	{
+		sourceInputChannels[s] = s < numInputChannels ? const_cast<float*>(inputs[s]) : silentInput.getWritePointer(0);
+	}
+	const AudioBuffer<float> sourceInputs(sourceInputChannels.data(), SourceImagesHandler::maxNumSources, localBlockSize);
+
+	renderSourceImages(sourceInputs);
+	writeOutputs(sourceInputChannels[0], outputs);
+
+	numSamplesProcessed += localBlockSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::renderSourceImages(const AudioBuffer<float>& sourceInputs)
+// Feed delay lines (one per source), then render source images into ambisonicBuffer
+{
+	// sources added since last block start from silent delay lines (sized at next update)
+	const int numInputs = jmin(sourceImagesHandler.getNumSources(), sourceInputs.getNumChannels(), delayLines.size());
+	for (int s = numDelayLinesUsed; s < numInputs; s++)
+	{
+		delayLines[s]->clear();
+		requireDelayLineSizeUpdate = true;
+	}
+	numDelayLinesUsed = numInputs;
+
+	if (sourceImagesHandler.numSourceImages == 0) { return; }
+
+	// update delay line size if need be
+	if (requireDelayLineSizeUpdate)
+	{
+		// longest delay creates noisy sound if delay line is exactly 1* its duration
+		int updatedDelayLineLength = (int)(1.5 * sourceImagesHandler.getMaxDelayFuture() * localSampleRate);
+		for (int s = 0; s < numDelayLinesUsed; s++) { delayLines[s]->setSize(1, updatedDelayLineLength); }
+		requireDelayLineSizeUpdate = false;
+	}
+
+	// add current audio buffer of each source to its delay line
+	for (int s = 0; s < numDelayLinesUsed; s++) { delayLines[s]->copyFrom(0, sourceInputs, s, 0, localBlockSize); }
+
+	// loop over sources images, apply delay + room coloration + spatialization
+	sourceImagesHandler.getNextAudioBlock(delayLines, ambisonicBuffer);
+
+	for (int s = 0; s < numDelayLinesUsed; s++) { delayLines[s]->incrementWriteIndex(localBlockSize); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::writeOutputs(const float* passthroughInput, float** outputs)
+// Copy / decode ambisonicBuffer to output channels, one group per listener. Without source
+// images, passthroughInput is written to the first channels (W and the next one, as a stereo
+// pair, for Ambisonic outputs, both ears for binaural ones).
+{
+	const int numAmbiChannels = getNumAmbiChannels(sourceImagesHandler.getAmbisonicOrder());
+	const bool hasAmbisonic = format != binauralOutput;
+	const bool hasBinaural = format != ambisonicOutput;
+	const int firstBinauralChannel = hasAmbisonic ? numAmbiChannels : 0;
+
+	// read input before outputs (which may alias inputs) are written
+	if (sourceImagesHandler.numSourceImages == 0)
+	{
+		binauralBuffer.copyFrom(0, 0, passthroughInput, localBlockSize);
+		for (int k = 0; k < numOutputChannels; k++) { FloatVectorOperations::clear(outputs[k], localBlockSize); }
+
+		const bool hasBoth = hasAmbisonic && hasBinaural;
+		const int passthroughChannels[3] = { 0, hasBoth ? firstBinauralChannel : 1, firstBinauralChannel + 1 };
+		for (int i = 0; i < (hasBoth ? 3 : 2); i++)
+		{
+			if (passthroughChannels[i] >= numOutputChannels) { continue; }
+			FloatVectorOperations::copy(outputs[passthroughChannels[i]], binauralBuffer.getReadPointer(0), localBlockSize);
+		}
+		return;
+	}
+
+	const int numRenderedListeners = jmin(numOutputListeners, sourceImagesHandler.getNumListeners());
+	const bool isProfiling = hasBinaural && profiler.isEnabled();
+	int64 decodingTicks = 0;
+	for (int l = 0; l < numOutputListeners; l++)
+	{
+		const int firstOutputChannel = l * numChannelsPerListener;
+		const int numListenerOutputs = jmin(numChannelsPerListener, numOutputChannels - firstOutputChannel);
+		float** listenerOutputs = outputs + firstOutputChannel;
+
+		// listener absent from scene: silence
+		if (l >= numRenderedListeners)
+		{
+			for (int k = 0; k < numListenerOutputs; k++) { FloatVectorOperations::clear(listenerOutputs[k], localBlockSize); }
+			continue;
+		}
+
+		const int firstChannel = sourceImagesHandler.getListenerFirstChannel(l);
+		for (int k = 0; hasAmbisonic && k < jmin(numAmbiChannels, numListenerOutputs); k++)
+		{
+			FloatVectorOperations::copy(listenerOutputs[k], ambisonicBuffer.getReadPointer(firstChannel + 2 + k), localBlockSize);
+		}
+
+		if (!hasBinaural || firstBinauralChannel >= numListenerOutputs) { continue; }
+
+		// binaural decoding: all Ambisonic channels filtered and collapsed to both ears in one call,
+		// plus direct to binaural source images
+		const int64 ticks = isProfiling ? StageProfiler::getTicks() : 0;
+		ambi2binFilters[l]->process(ambisonicBuffer.getArrayOfReadPointers() + firstChannel + 2, binauralBuffer.getArrayOfWritePointers());
+		if (isProfiling) { decodingTicks += StageProfiler::getTicks() - ticks; }
+		binauralBuffer.addFrom(0, 0, ambisonicBuffer, firstChannel, 0, localBlockSize);
+		binauralBuffer.addFrom(1, 0, ambisonicBuffer, firstChannel + 1, 0, localBlockSize);
+		for (int k = 0; k < jmin(2, numListenerOutputs - firstBinauralChannel); k++)
+		{
+			FloatVectorOperations::copy(listenerOutputs[firstBinauralChannel + k], binauralBuffer.getReadPointer(k), localBlockSize);
+		}
+	}
+
+	// channels past the last listener group
+	for (int k = numOutputListeners * numChannelsPerListener; k < numOutputChannels; k++)
+	{
+		FloatVectorOperations::clear(outputs[k], localBlockSize);
+	}
+
+	if (decodingTicks > 0) { profiler.addStageTime(StageProfiler::binauralDecoding, decodingTicks); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::reset()
+// Clear all "delay line" like buffers (e.g. audio device stopped, or before an impulse response)
+{
+	for (auto* delayLine : delayLines) { delayLine->clear(); }
+	sourceImagesHandler.reverbTail.clear();
+	for (auto* ambi2binFilter : ambi2binFilters) { ambi2binFilter->reset(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::commitScene()
+// Host driven: apply the scene changes fed by the host (OSC messages, see OSCHandler::receiveMessage,
+// loaded state) or replayed from a capture up to the current audio time, on the calling thread
+// (between two process calls), picked up at next process. Realtime: have the scene re-read in
+// full by the scene thread.
+{
+	if (mode == realtime)
+	{
+		scene.requestUpdate();
+		return;
+	}
+
+	if (localSampleRate > 0) { scene.updateScene((uint32)(1000.0 * numSamplesProcessed / localSampleRate)); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool EvertimsEngine::oscSceneUpdated(OSCHandler& handler)
+// Method called (scene thread) when new OSC messages have been applied, returns false if
+// sourceImagesHandler can't take the update yet (in the midst of a crossfade)
+{
+	// head rotation only: sound field rotated as a whole, no source images update
+	if (!handler.hasSceneChanged())
+	{
+		if (sourceImagesHandler.updateListenerOrientation(handler)) { return true; }
+	}
+
+	// wait for audio thread to be done with previous update
+	if (!sourceImagesHandler.isReadyForUpdate()) { return false; }
+
+	// update source images attributes based on latest received OSC info (delay line resized
+	// by audio thread when it acquires them)
+	sourceImagesHandler.updateFromOscHandler(handler);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::setParameter(const Parameter parameter, const double value)
+// Parameters changing what the scene thread computes are set while holding the scene lock, then
+// trigger a full source images update
+{
+	switch (parameter)
+	{
+		case ambisonicOrder:
+			nextAmbisonicOrder = jlimit(1, AMBI_ORDER, (int)value);
+			break;
+
+		case outputFormat:
+			nextOutputFormat = (OutputFormat)jlimit((int)ambisonicOutput, (int)ambisonicAndBinauralOutput, (int)value);
+			break;
+
+		case numFrequencyBands:
+		{
+			const ScopedLock lock(scene.getSceneLock());
+			numFreqBands = (int)value;
+			sourceImagesHandler.setFilterBankSize(numFreqBands);
+			scene.requestUpdate(); // Re-dimension absorption coefficients, picked up by audio thread with the new state.
+			break;
+		}
+
+		case directPathGain:
+			sourceImagesHandler.directPathGain = (float)value;
+			break;
+
+		case earlyReflectionsGain:
+			sourceImagesHandler.earlyGain = (float)value;
+			break;
+
+		case reverbTailGain:
+			sourceImagesHandler.reverbTailGain = (float)value;
+			break;
+
+		case enableReverbTail:
+			sourceImagesHandler.enableReverbTail = value != 0.0; // FDN gains kept up to date even if disabled
+			break;
+
+		case enableDirectToBinaural:
+			sourceImagesHandler.enableDirectToBinaural = value != 0.0;
+			break;
+
+		case enableSoundFieldRotation:
+		{
+			const ScopedLock lock(scene.getSceneLock());
+			sourceImagesHandler.enableSoundFieldRotation = value != 0.0;
+			scene.requestUpdate(); // Re-encode source images in world / listener frame.
+			break;
+		}
+
+		case numBinauralImages:
+		{
+			const ScopedLock lock(scene.getSceneLock());
+			sourceImagesHandler.numBinauralImages = jlimit(1, (int)SourceImagesHandler::maxNumBinauralImages, (int)value);
+			scene.requestUpdate(); // Re-assign binaural encoders to source images.
+			break;
+		}
+
+		case spreadFactor:
+		{
+			const ScopedLock lock(scene.getSceneLock());
+			sourceImagesHandler.spreadFactor = (float)value;
+			scene.requestUpdate(); // Re-compute Ambisonic gains.
+			break;
+		}
+
+		case sphericalHarmonicDirectivity:
+		{
+			const ScopedLock lock(scene.getSceneLock());
+			sourceImagesHandler.useSphericalHarmonicDirectivity = value != 0.0;
+			scene.requestUpdate(); // Re-compute directivity gains.
+			break;
+		}
+
+		case crossfadeFactor:
+			sourceImagesHandler.crossfadeStep = (float)value;
+			sourceImagesHandler.setBinauralCrossfadeStep((float)value);
+			updateSceneCommitInterval();
+			break;
+
+		case maxSceneUpdateRate:
+			sceneUpdateRate = (int)value;
+			updateSceneCommitInterval();
+			break;
+
+		case numRenderThreads:
+			sourceImagesHandler.setNumRenderThreads((int)value);
+			break;
+
+		default:
+			jassertfalse;
+			break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+double EvertimsEngine::getParameter(const Parameter parameter) const
+// Current value (requested value for those applied at next prepare)
+{
+	switch (parameter)
+	{
+		case ambisonicOrder: return nextAmbisonicOrder;
+		case outputFormat: return nextOutputFormat;
+		case numFrequencyBands: return numFreqBands;
+		case directPathGain: return sourceImagesHandler.directPathGain;
+		case earlyReflectionsGain: return sourceImagesHandler.earlyGain;
+		case reverbTailGain: return sourceImagesHandler.reverbTailGain;
+		case enableReverbTail: return sourceImagesHandler.enableReverbTail ? 1.0 : 0.0;
+		case enableDirectToBinaural: return sourceImagesHandler.enableDirectToBinaural ? 1.0 : 0.0;
+		case enableSoundFieldRotation: return sourceImagesHandler.enableSoundFieldRotation ? 1.0 : 0.0;
+		case numBinauralImages: return sourceImagesHandler.numBinauralImages;
+		case spreadFactor: return sourceImagesHandler.spreadFactor;
+		case sphericalHarmonicDirectivity: return sourceImagesHandler.useSphericalHarmonicDirectivity ? 1.0 : 0.0;
+		case crossfadeFactor: return sourceImagesHandler.crossfadeStep;
+		case maxSceneUpdateRate: return sceneUpdateRate;
+		case numRenderThreads: return sourceImagesHandler.getNumRenderThreads();
+		default: jassertfalse; return 0.0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool EvertimsEngine::setSourceDirectivity(const String& pattern, const int sourceIndex)
+// Directivity pattern (directivity/<pattern>.sofa) of source sourceIndex (in sources sorted by
+// name), or default one if -1. False if the file failed to load (directivity then omni).
+{
+	String filename;
+	filename << "directivity/" << pattern << ".sofa";
+
+	bool loaded;
+	{
+		const ScopedLock lock(scene.getSceneLock());
+		if (sourceIndex < 0) { loaded = sourceImagesHandler.directivityHandler.loadFile(filename); }
+		else { loaded = sourceImagesHandler.setSourceDirectivity(sourceIndex, filename); }
+	}
+	scene.requestUpdate();
+	return loaded;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int EvertimsEngine::getNumChannelsPerListener() const
+// Output channels per listener, for the output format of next prepare
+{
+	const int numAmbiChannels = getNumAmbiChannels(nextAmbisonicOrder);
+	switch (nextOutputFormat)
+	{
+		case binauralOutput: return 2;
+		case ambisonicAndBinauralOutput: return numAmbiChannels + 2;
+		default: return numAmbiChannels;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvertimsEngine::updateSceneCommitInterval()
+// Scene updates no more frequent than max update rate, nor than a crossfade lasts (updates in
+// between would wait for crossfade end anyway: coalesce them in OSC handler instead)
+{
+	int rateInterval = (int)ceil(1000.0 / jmax(sceneUpdateRate, 1));
+	int crossfadeInterval = 0;
+	if (localSampleRate > 0)
+	{
+		// crossfade gain reaches 1 after ceil(1/step) blocks, past = future one block later
+		int numCrossfadeBlocks = (int)ceil(1.0 / sourceImagesHandler.crossfadeStep) + 1;
+		crossfadeInterval = (int)ceil(1000.0 * numCrossfadeBlocks * localBlockSize / localSampleRate);
+	}
+	scene.setMinCommitInterval(jmax(rateInterval, crossfadeInterval));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
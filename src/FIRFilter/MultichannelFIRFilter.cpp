@@ -0,0 +1,106 @@
+#include "MultichannelFIRFilter.h"
+
+
+MultichannelFIRFilter::MultichannelFIRFilter()
+	:
+	irSize_(0),
+	bufferSize_(0),
+	nfft_(0),
+	numInputs_(0),
+	numOutputs_(0),
+	initialized_(false)
+{
+}
+
+MultichannelFIRFilter::~MultichannelFIRFilter()
+{
+}
+
+void MultichannelFIRFilter::init(size_t bufferSize, size_t irSize, size_t numInputs, size_t numOutputs)
+{
+	irSize_ = irSize;
+	bufferSize_ = bufferSize;
+	numInputs_ = numInputs;
+	numOutputs_ = numOutputs;
+	initialized_ = true;
+
+	nfft_ = (size_t)nextPowerOf2((int)(irSize + bufferSize - 1));
+	oouraFFT.init(nfft_);
+	transferFunctionFFT.init(nfft_);
+	ir_.assign(nfft_, 0.f);
+	inputBuffer_.assign(nfft_, 0.f);
+	timeBuffer_.resize(nfft_);
+	freqBuffer_.resize(nfft_ / 2 + 1);
+
+	H_.assign(numInputs * numOutputs, ComplexVector<float>(nfft_ / 2 + 1, 0.f));
+	accumulators_.assign(numOutputs, ComplexVector<float>(nfft_ / 2 + 1, 0.f));
+	overlaps_.assign(numOutputs, std::vector<float>(nfft_ - bufferSize, 0.f));
+}
+
+void MultichannelFIRFilter::setImpulseResponse(size_t inputId, size_t outputId, const float* ir)
+{
+	assert(initialized_);
+	assert(inputId < numInputs_ && outputId < numOutputs_);
+	if (nfft_ == 0)
+		return;
+
+	computeTransferFunction(ir, H_[inputId * numOutputs_ + outputId].data());
+}
+
+void MultichannelFIRFilter::computeTransferFunction(const float* ir, std::complex<float>* H)
+{
+	assert(initialized_);
+	if (nfft_ == 0)
+		return;
+
+	// zero-padded impulse response
+	memcpy(ir_.data(), ir, irSize_ * sizeof(float));
+
+	// compute transfer function, with ifft normalization folded in
+	transferFunctionFFT.fft(ir_.data(), H);
+	FloatVectorOperations::multiply(reinterpret_cast<float*>(H), 2.f / nfft_, (int)(2 * freqBuffer_.size()));
+}
+
+void MultichannelFIRFilter::setTransferFunction(size_t inputId, size_t outputId, const std::complex<float>* H)
+{
+	assert(initialized_);
+	assert(inputId < numInputs_ && outputId < numOutputs_);
+
+	ComplexVector<float>& dest = H_[inputId * numOutputs_ + outputId];
+	std::copy(H, H + dest.size(), dest.begin());
+}
+
+void MultichannelFIRFilter::process(const float* const* inputs, float* const* outputs)
+{
+	assert(initialized_);
+	if (nfft_ == 0 || bufferSize_ == 0 || irSize_ == 0)
+		return;
+
+	const size_t numBins = freqBuffer_.size();
+
+	// accumulate input spectra times transfer functions, per output
+	for (size_t i = 0; i < numInputs_; ++i)
+	{
+		memcpy(inputBuffer_.data(), inputs[i], bufferSize_ * sizeof(float));
+		oouraFFT.fft(inputBuffer_.data(), freqBuffer_.data());
+
+		for (size_t o = 0; o < numOutputs_; ++o)
+		{
+			if (i == 0) { complexMultiply(accumulators_[o].data(), freqBuffer_.data(), H_[o].data(), numBins); }
+			else { complexMultiplyAdd(accumulators_[o].data(), freqBuffer_.data(), H_[i * numOutputs_ + o].data(), numBins); }
+		}
+	}
+
+	// one ifft + overlap-add per output
+	for (size_t o = 0; o < numOutputs_; ++o)
+	{
+		oouraFFT.ifft(accumulators_[o].data(), timeBuffer_.data());
+		overlapAdd(outputs[o], timeBuffer_.data(), overlaps_[o].data(), bufferSize_, overlaps_[o].size());
+	}
+}
+
+void MultichannelFIRFilter::reset()
+{
+	for (auto& overlap : overlaps_)
+		std::fill(overlap.begin(), overlap.end(), 0.f);
+}
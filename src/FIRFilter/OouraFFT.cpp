@@ -22,12 +22,13 @@ void OouraFFT::fft(float* in, std::complex<float>* out)
 	rdft((int)nfft, +1, buffer_.data(), ip_.data(), sineTable_.data());
 
 	// copy to output from the ooura format
-	for (size_t i = 0; i < nfft / 2; ++i)
+	for (size_t i = 1; i < nfft / 2; ++i)
 	{
 		out[i].real((float)buffer_[i * 2]); //real part
 		out[i].imag((float)buffer_[i * 2 + 1]); // imag part
 	}
-	out[nfft / 2].real((float)buffer_[1]); // a[1] = R[n/2]
+	out[0] = std::complex<float>((float)buffer_[0], 0.f); // a[0] = R[0] (a[1] is not its imag part)
+	out[nfft / 2] = std::complex<float>((float)buffer_[1], 0.f); // a[1] = R[n/2]
 }
 
 void OouraFFT::ifft(std::complex<float>* in, float* out)
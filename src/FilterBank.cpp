@@ -4,111 +4,97 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void FilterBank::prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate)
-// local equivalent of prepareToPlay
+// local equivalent of prepareToPlay: compute coefficients of both band layouts (applied to each
+// filter bank at its next decomposeBuffer)
+// NOTE: a filter is stateful, and needs to be given a continuous stream of audio. Hence, each source
+// image needs its own separate filter bank (see e.g. https://forum.juce.com/t/iirfilter-help/1733/7 ).
 {
 	localSampleRate = sampleRate;
 	localSamplesPerBlockExpected = samplesPerBlockExpected;
-	bufferFiltered.setSize(1, samplesPerBlockExpected);
-	bufferRemains = bufferFiltered;
-}
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
+	// 10-filter-bank
+	double fc = 31.5; // cutoff frequency
+	double fcMid;
+	for (int i = 0; i < NUM_OCTAVE_BANDS - 1; i++)
+	{
+		// get lowpass cut-off freq (in between "would be Fc" for bandpass, arbitrary choice)
+		if (i < NUM_OCTAVE_BANDS - 2) { fcMid = fc + (2 * fc - fc) / 2; }
+		// last fcMid is not "mid between next and current" but "between max and current"
+		else { fcMid = fc + (20000 - fc) / 2; }
 
-void FilterBank::setNumFilters(const unsigned int numBands, const unsigned int numSourceImages)
-{
-	// skip if nothing has changed
-	if (numOctaveBands == numBands && numIndptStream == numSourceImages) { return; }
+		coefficients10[i] = IIRCoefficients::makeLowPass(localSampleRate, fcMid);
+		fc *= 2;
+	}
 
-	// update future values
-	numOctaveBands = numBands;
-	numIndptStream = numSourceImages;
+	// 3-filter-bank
+	coefficients3[0] = IIRCoefficients::makeLowPass(localSampleRate, 480);
+	coefficients3[1] = IIRCoefficients::makeLowPass(localSampleRate, 8200);
 
-	// flag update required
-	updateRequired = true;
+	// existing filter banks set to new coefficients at next use
+	const int numBanks = getNumFilterBanks();
+	for (int j = 0; j < numBanks; j++) { chunks[j / chunkSize][j % chunkSize].numBands = 0; }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FilterBank::_setNumFilters(const unsigned int numBands, const unsigned int numSourceImages)
-// Define number of frequency bands in filter-bank (only choice is betwen 3 or 10)
-// NOTE: a filter is stateful, and needs to be given a continuous stream of audio. Hence, each source
-// image needs its own separate filter bank (see e.g. https://forum.juce.com/t/iirfilter-help/1733/7 ).
+void FilterBank::reserve(const int numSourceImages)
+// Allocate filter banks of source images up to numSourceImages (scene thread, before publishing a
+// render state holding them). Allocated ones are kept, along with their filters state.
 {
-	// resize band buffer
-	_numOctaveBands = numBands;
-	_numIndptStream = numSourceImages;
-	octaveFilterBanks.resize(numSourceImages);
+	const int numRequired = jmin(numSourceImages, (int)maxNumSourceImages);
+	jassert(numRequired == numSourceImages);
 
-	// loop over bands of each filterbank
-	double fc; // cutoff frequency
-	double fcMid;
-	for (int j = 0; j < numSourceImages; j++)
+	int numBanks = numFilterBanks.load(std::memory_order_relaxed);
+	if (numBanks >= numRequired) { return; }
+
+	while (numBanks < numRequired)
 	{
-		if (numBands == 10) // 10-filter-bank
-		{
-			fc = 31.5;
-			for (int i = 0; i < _numOctaveBands - 1; i++)
-			{
-				// get lowpass cut-off freq (in between "would be Fc" for bandpass, arbitrary choice)
-				if (i < _numOctaveBands - 2) { fcMid = fc + (2 * fc - fc) / 2; }
-				// last fcMid is not "mid between next and current" but "between max and current"
-				else { fcMid = fc + (20000 - fc) / 2; }
-
-				octaveFilterBanks[j][i].setCoefficients(IIRCoefficients::makeLowPass(localSampleRate, fcMid));
-				// octaveFilterBanks[j][i].reset();
-				fc *= 2;
-			}
-		}
-
-		else // 3-filter-bank
-		{
-			fc = 480;
-			octaveFilterBanks[j][0].setCoefficients(IIRCoefficients::makeLowPass(localSampleRate, fc));
-			// octaveFilterBanks[j][0].reset(); // removed all resets to avoid zipper noise when changing existing filters, may need to re-add them
-
-			fc = 8200;
-			octaveFilterBanks[j][1].setCoefficients(IIRCoefficients::makeLowPass(localSampleRate, fc));
-			// octaveFilterBanks[j][1].reset();
-		}
+		chunks[numBanks / chunkSize].reset(new SourceImageFilters[chunkSize]);
+		numBanks += chunkSize;
 	}
+	numFilterBanks.store(numBanks, std::memory_order_release);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void FilterBank::decomposeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination, const unsigned int sourceImageId)
-// Decompose source buffer into bands, return multi-channel buffer with one band per channel
+void FilterBank::decomposeBuffer(const AudioBuffer<float>& source, AudioBuffer<float>& destination, const int sourceImageId, const int numBands)
+// Decompose source buffer into numBands bands (3 or 10), return multi-channel buffer with one band
+// per channel. Filters of distinct source images may be run concurrently (no shared scratch buffer).
 {
-	if (updateRequired) {
-		// update filters
-		_setNumFilters(numOctaveBands, numIndptStream);
-		// flag update no longer required
-		updateRequired = false;
+	jassert(numBands == 3 || numBands == NUM_OCTAVE_BANDS);
+
+	// remaining spectrum kept in last band
+	const int lastBand = numBands - 1;
+	destination.copyFrom(lastBand, 0, source, 0, 0, localSamplesPerBlockExpected);
+
+	// no filter bank (not reserved): left undecomposed
+	if (sourceImageId < 0 || sourceImageId >= getNumFilterBanks())
+	{
+		jassertfalse;
+		for (int i = 0; i < lastBand; i++) { destination.clear(i, 0, localSamplesPerBlockExpected); }
+		return;
 	}
 
-	// prepare buffers
-	bufferRemains = source;
+	// switch filters to band layout (coefficients only, filters state kept to avoid zipper noise)
+	SourceImageFilters& sourceImageFilters = chunks[sourceImageId / chunkSize][sourceImageId % chunkSize];
+	if (sourceImageFilters.numBands != numBands)
+	{
+		const IIRCoefficients* coefficients = numBands == 3 ? coefficients3.data() : coefficients10.data();
+		for (int i = 0; i < lastBand; i++) { sourceImageFilters.filters[i].setCoefficients(coefficients[i]); }
+		sourceImageFilters.numBands = numBands;
+	}
 
 	// recursive filtering for all but last band
-	for (int i = 0; i < _numOctaveBands - 1; i++)
+	for (int i = 0; i < lastBand; i++)
 	{
 		// filter the remaining spectrum
-		bufferFiltered = bufferRemains;
-		//DBG("sourceImageId = "<< (int) sourceImageId << " while octaveFilterBanks.size() = " << (int) octaveFilterBanks.size());
-		jassert((int) sourceImageId < octaveFilterBanks.size());
-		octaveFilterBanks[sourceImageId][i].processSamples(bufferFiltered.getWritePointer(0), localSamplesPerBlockExpected);
+		destination.copyFrom(i, 0, destination, lastBand, 0, localSamplesPerBlockExpected);
+		sourceImageFilters.filters[i].processSamples(destination.getWritePointer(i), localSamplesPerBlockExpected);
 
 		// substract just processed band from remaining spectrum
-		bufferFiltered.applyGain(-1.f);
-		bufferRemains.addFrom(0, 0, bufferFiltered, 0, 0, localSamplesPerBlockExpected);
-		bufferFiltered.applyGain(-1.f);
-
-		// add filtered band to output
-		destination.copyFrom(i, 0, bufferFiltered, 0, 0, localSamplesPerBlockExpected);
+		destination.addFrom(lastBand, 0, destination, i, 0, localSamplesPerBlockExpected, -1.f);
 	}
-
-	// last band
-	destination.copyFrom(_numOctaveBands - 1, 0, bufferRemains, 0, 0, localSamplesPerBlockExpected);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,503 @@
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+#include <mysofa.h>
+
+#include "HrirStore.h"
+#include "FIRFilter/OouraFFT.h"
+
+// Legacy HRIR format (raw float, 5deg azim / elev grid, clockwise azimuth)
+#define LEGACY_HRIR_LENGTH 200 // Length of loaded HRIR (in time samples)
+#define LEGACY_AZIM_STEP 5 // HRIR spatial grid step (deg)
+#define LEGACY_ELEV_STEP 5 // HRIR spatial grid step (deg)
+#define LEGACY_N_AZIM_VALUES (360 / LEGACY_AZIM_STEP) // total number of azimuth values in HRIR
+#define LEGACY_N_ELEV_VALUES (180 / LEGACY_ELEV_STEP + 1) // total number of elevation values in HRIR
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+HrirStore::HrirStore()
+{
+	// load HRIR filters
+	File hrirFile = getFileFromString("irs/ClubFritz1_hrir.bin");
+	if (!loadFile(hrirFile)) { throw std::ios_base::failure("Failed to open HRIR file"); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HrirStore::loadFile(const File& hrirFile)
+// load a given HRIR set (.sofa or legacy .bin), through its binary cache if up to date.
+// Not real-time safe: only call when no encoder is processing.
+{
+	// use cache if up to date
+	File cacheFile = hrirFile.withFileExtension("hrircache");
+	if (mapCache(cacheFile, hrirFile)) { return true; }
+
+	// otherwise load from source file
+	std::vector<float> pos, data;
+	int length = 0;
+	float rate = 48000.f;
+	bool loaded = hrirFile.hasFileExtension("sofa") ?
+		loadSofa(hrirFile, pos, data, length, rate) :
+		loadLegacyGrid(hrirFile, pos, data, length, rate);
+	if (!loaded) { return false; }
+
+	// split HRIR into min-phase filters and onset delays
+	std::vector<float> dels;
+	decomposeMinPhase(data, dels, length);
+
+	// write cache and map it, or keep data in memory if cache is not writable
+	if (writeCache(cacheFile, hrirFile, pos, dels, data, length, rate) && mapCache(cacheFile, hrirFile)) { return true; }
+	useInMemory(pos, dels, data, length, rate);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HrirStore::loadSofa(const File& sofaFile, std::vector<float>& pos, std::vector<float>& data, int& length, float& rate)
+// read SOFA file, output positions as unit vectors and HRIR as [position][ear][sample]
+{
+	// convert to fit libmysofa expected input format
+	String path = sofaFile.getFullPathName();
+
+	int err;
+	struct MYSOFA_HRTF* hrtf = mysofa_load(path.toRawUTF8(), &err);
+	if (hrtf == NULL) { return false; }
+	if (mysofa_check(hrtf) != MYSOFA_OK || hrtf->R != 2 || hrtf->M == 0)
+	{
+		mysofa_free(hrtf);
+		return false;
+	}
+	mysofa_tocartesian(hrtf);
+
+	// broadband delays (if any) are applied back to the HRIR: get max delay to size output
+	const unsigned int numDelays = hrtf->DataDelay.elements;
+	const bool hasDelays = (numDelays == hrtf->M * hrtf->R) || (numDelays == hrtf->R);
+	float maxDelay = 0.f;
+	if (hasDelays)
+	{
+		for (unsigned int i = 0; i < numDelays; i++) { maxDelay = fmax(maxDelay, hrtf->DataDelay.values[i]); }
+	}
+
+	const int numSamples = (int)hrtf->N;
+	length = numSamples + (int)ceil(maxDelay);
+	rate = hrtf->DataSamplingRate.elements > 0 ? hrtf->DataSamplingRate.values[0] : 48000.f;
+	pos.resize(3 * hrtf->M);
+	data.assign(hrtf->M * 2 * length, 0.f);
+
+	for (unsigned int m = 0; m < hrtf->M; m++)
+	{
+		// position, normalized
+		const float* xyz = hrtf->SourcePosition.values + 3 * m;
+		float norm = sqrtf(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+		if (norm <= 0.f) { norm = 1.f; }
+		for (int c = 0; c < 3; c++) { pos[3 * m + c] = xyz[c] / norm; }
+
+		// HRIR, delayed
+		for (int earId = 0; earId < 2; earId++)
+		{
+			int delay = 0;
+			if (hasDelays) { delay = (int)roundf(hrtf->DataDelay.values[numDelays == hrtf->R ? earId : m * hrtf->R + earId]); }
+			FloatVectorOperations::copy(data.data() + (m * 2 + earId) * length + delay, hrtf->DataIR.values + (m * hrtf->R + earId) * numSamples, numSamples);
+		}
+	}
+
+	mysofa_free(hrtf);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HrirStore::loadLegacyGrid(const File& binFile, std::vector<float>& pos, std::vector<float>& data, int& length, float& rate)
+// read legacy HRIR file, layout [azim][elev][ear][sample] on fixed 5deg grid
+{
+	// open file
+	FileInputStream istream_hrir(binFile);
+	if (!istream_hrir.openedOk()) { return false; }
+
+	const int numPositions = LEGACY_N_AZIM_VALUES * LEGACY_N_ELEV_VALUES;
+	length = LEGACY_HRIR_LENGTH;
+	rate = 48000.f;
+
+	// file layout matches output layout, positions are implicit
+	data.resize(numPositions * 2 * length);
+	if (istream_hrir.read(data.data(), (int)(data.size() * sizeof(float))) != (int)(data.size() * sizeof(float))) { return false; }
+
+	// grid azimuth is clockwise, SOFA is counter-clockwise
+	pos.resize(3 * numPositions);
+	for (int azimId = 0; azimId < LEGACY_N_AZIM_VALUES; azimId++)
+	{
+		for (int elevId = 0; elevId < LEGACY_N_ELEV_VALUES; elevId++)
+		{
+			float azim = -(float)(azimId * LEGACY_AZIM_STEP * M_PI / 180.0);
+			float elev = (float)((elevId * LEGACY_ELEV_STEP - 90) * M_PI / 180.0);
+			float* xyz = pos.data() + 3 * (azimId * LEGACY_N_ELEV_VALUES + elevId);
+			xyz[0] = cosf(elev) * cosf(azim);
+			xyz[1] = cosf(elev) * sinf(azim);
+			xyz[2] = sinf(elev);
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::decomposeMinPhase(std::vector<float>& data, std::vector<float>& dels, int& length)
+// replace HRIR [filter][sample] by their minimum-phase version (shortened) and output their onset
+// delays (in samples, relative to the earliest onset of the set)
+{
+	const int numFilters = (int)data.size() / length;
+	const int nfft = jmax(1024, nextPowerOf2(8 * length)); // zero-padding limits cepstral aliasing
+	const float ifftScale = 2.f / nfft;
+
+	OouraFFT oouraFFT;
+	oouraFFT.init(nfft);
+	std::vector<float> timeBuffer(nfft);
+	ComplexVector<float> freqBuffer(nfft / 2 + 1);
+	std::vector<float> minPhaseData(data.size());
+	dels.resize(numFilters);
+
+	int minPhaseLength = 1;
+	for (int i = 0; i < numFilters; i++)
+	{
+		const float* hrir = data.data() + i * length;
+
+		// onset: first crossing of -20dB re peak, linearly interpolated between samples
+		const float peak = jmax(fabs(FloatVectorOperations::findMinimum(hrir, length)), FloatVectorOperations::findMaximum(hrir, length));
+		const float onsetThreshold = 0.1f * peak;
+		int n = 0;
+		while (n < length - 1 && fabs(hrir[n]) < onsetThreshold) { n++; }
+		dels[i] = (float)n;
+		if (n > 0 && fabs(hrir[n]) > fabs(hrir[n - 1])) { dels[i] -= (fabs(hrir[n]) - onsetThreshold) / (fabs(hrir[n]) - fabs(hrir[n - 1])); }
+
+		// real cepstrum of log magnitude spectrum
+		FloatVectorOperations::clear(timeBuffer.data(), nfft);
+		FloatVectorOperations::copy(timeBuffer.data(), hrir, length);
+		oouraFFT.fft(timeBuffer.data(), freqBuffer.data());
+		for (size_t k = 0; k < freqBuffer.size(); k++) { freqBuffer[k] = std::log(jmax(std::abs(freqBuffer[k]), 1e-8f)); }
+		oouraFFT.ifft(freqBuffer.data(), timeBuffer.data());
+
+		// fold cepstrum to causal part (homomorphic min-phase), back to spectrum, exp, to time
+		timeBuffer[0] *= ifftScale;
+		timeBuffer[nfft / 2] *= ifftScale;
+		FloatVectorOperations::multiply(timeBuffer.data() + 1, 2.f * ifftScale, nfft / 2 - 1);
+		FloatVectorOperations::clear(timeBuffer.data() + nfft / 2 + 1, nfft / 2 - 1);
+		oouraFFT.fft(timeBuffer.data(), freqBuffer.data());
+		for (size_t k = 0; k < freqBuffer.size(); k++) { freqBuffer[k] = std::exp(freqBuffer[k]); }
+		oouraFFT.ifft(freqBuffer.data(), timeBuffer.data());
+		FloatVectorOperations::copyWithMultiply(minPhaseData.data() + i * length, timeBuffer.data(), ifftScale, length);
+
+		// min-phase filter length: 99.99% of energy
+		const float* minPhase = minPhaseData.data() + i * length;
+		float energy = 0.f, totalEnergy = 0.f;
+		for (int j = 0; j < length; j++) { totalEnergy += minPhase[j] * minPhase[j]; }
+		int j = 0;
+		while (j < length && energy < 0.9999f * totalEnergy) { energy += minPhase[j] * minPhase[j]; j++; }
+		minPhaseLength = jmax(minPhaseLength, j);
+	}
+
+	// delays relative to earliest onset (common propagation delay is dropped)
+	const float minDelay = *std::min_element(dels.begin(), dels.end());
+	for (float& d : dels) { d -= minDelay; }
+
+	// shorten filters
+	data.resize(numFilters * minPhaseLength);
+	for (int i = 0; i < numFilters; i++)
+	{
+		FloatVectorOperations::copy(data.data() + i * minPhaseLength, minPhaseData.data() + i * length, minPhaseLength);
+	}
+	length = minPhaseLength;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HrirStore::writeCache(const File& cacheFile, const File& sourceFile, const std::vector<float>& pos, const std::vector<float>& dels, const std::vector<float>& data, const int length, const float rate)
+// serialise HRIR set to flat binary cache
+{
+	const int numPos = (int)pos.size() / 3;
+	const int floatsPerAlignment = cacheAlignment / sizeof(float);
+	const int stride = (length + floatsPerAlignment - 1) / floatsPerAlignment * floatsPerAlignment;
+	const uint32 positionsSize = (uint32)(pos.size() * sizeof(float));
+	const uint32 delaysSize = (uint32)(dels.size() * sizeof(float));
+
+	CacheHeader header;
+	zerostruct(header);
+	memcpy(header.magic, "EVHRIR", 6);
+	header.version = cacheVersion;
+	header.numPositions = (uint32)numPos;
+	header.hrirLength = (uint32)length;
+	header.hrirStride = (uint32)stride;
+	header.sampleRate = rate;
+	header.positionsOffset = (uint32)((sizeof(CacheHeader) + cacheAlignment - 1) / cacheAlignment * cacheAlignment);
+	header.delaysOffset = (header.positionsOffset + positionsSize + cacheAlignment - 1) / cacheAlignment * cacheAlignment;
+	header.dataOffset = (header.delaysOffset + delaysSize + cacheAlignment - 1) / cacheAlignment * cacheAlignment;
+	header.sourceSize = sourceFile.getSize();
+	header.sourceModificationTime = sourceFile.getLastModificationTime().toMilliseconds();
+
+	// FileOutputStream appends to existing files
+	cacheFile.deleteFile();
+	FileOutputStream ostream(cacheFile);
+	if (!ostream.openedOk()) { return false; }
+
+	bool ok = ostream.write(&header, sizeof(CacheHeader));
+	ok &= ostream.writeRepeatedByte(0, header.positionsOffset - sizeof(CacheHeader));
+	ok &= ostream.write(pos.data(), positionsSize);
+	ok &= ostream.writeRepeatedByte(0, header.delaysOffset - header.positionsOffset - positionsSize);
+	ok &= ostream.write(dels.data(), delaysSize);
+	ok &= ostream.writeRepeatedByte(0, header.dataOffset - header.delaysOffset - delaysSize);
+	for (int i = 0; i < 2 * numPos; i++)
+	{
+		ok &= ostream.write(data.data() + i * length, length * sizeof(float));
+		ok &= ostream.writeRepeatedByte(0, (stride - length) * sizeof(float));
+	}
+	ostream.flush();
+
+	if (!ok) { cacheFile.deleteFile(); }
+	return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HrirStore::mapCache(const File& cacheFile, const File& sourceFile)
+// map binary cache, if it exists and matches source file
+{
+	if (!cacheFile.existsAsFile()) { return false; }
+
+	std::unique_ptr<MemoryMappedFile> mapped(new MemoryMappedFile(cacheFile, MemoryMappedFile::readOnly));
+	if (mapped->getData() == nullptr || mapped->getSize() < sizeof(CacheHeader)) { return false; }
+
+	// check header
+	const CacheHeader* header = static_cast<const CacheHeader*>(mapped->getData());
+	if (memcmp(header->magic, "EVHRIR", 6) != 0 || header->version != cacheVersion) { return false; }
+	if (header->sourceSize != sourceFile.getSize() || header->sourceModificationTime != sourceFile.getLastModificationTime().toMilliseconds()) { return false; }
+	if (mapped->getSize() < header->dataOffset + (size_t)header->numPositions * 2 * header->hrirStride * sizeof(float)) { return false; }
+
+	// point to mapped data
+	const char* base = static_cast<const char*>(mapped->getData());
+	positions = reinterpret_cast<const float*>(base + header->positionsOffset);
+	delays = reinterpret_cast<const float*>(base + header->delaysOffset);
+	hrirData = reinterpret_cast<const float*>(base + header->dataOffset);
+	numPositions = (int)header->numPositions;
+	hrirLength = (int)header->hrirLength;
+	hrirStride = (int)header->hrirStride;
+	sampleRate = header->sampleRate;
+	mappedCache = std::move(mapped);
+	positionsInMemory.clear();
+	delaysInMemory.clear();
+	hrirDataInMemory.clear();
+	updateMaxDelay();
+
+	// build lookup
+	tree.resize(numPositions);
+	for (int i = 0; i < numPositions; i++) { tree[i] = i; }
+	buildTree(0, numPositions, 0);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::useInMemory(std::vector<float>& pos, std::vector<float>& dels, std::vector<float>& data, const int length, const float rate)
+// fallback when cache could not be written: keep loaded data
+{
+	mappedCache.reset();
+	positionsInMemory.swap(pos);
+	delaysInMemory.swap(dels);
+	hrirDataInMemory.swap(data);
+	positions = positionsInMemory.data();
+	delays = delaysInMemory.data();
+	hrirData = hrirDataInMemory.data();
+	numPositions = (int)positionsInMemory.size() / 3;
+	hrirLength = length;
+	hrirStride = length;
+	sampleRate = rate;
+	updateMaxDelay();
+
+	// build lookup
+	tree.resize(numPositions);
+	for (int i = 0; i < numPositions; i++) { tree[i] = i; }
+	buildTree(0, numPositions, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::updateMaxDelay()
+{
+	maxDelay = 0.f;
+	for (int i = 0; i < 2 * numPositions; i++) { maxDelay = fmax(maxDelay, delays[i]); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::buildTree(const int begin, const int end, const int depth)
+// recursive median split of tree[begin, end) along x, y, z axes in turn
+{
+	if (end - begin <= 1) { return; }
+
+	const int axis = depth % 3;
+	const int mid = (begin + end) / 2;
+	const float* pos = positions;
+	std::nth_element(tree.begin() + begin, tree.begin() + mid, tree.begin() + end,
+		[pos, axis](int a, int b) { return pos[3 * a + axis] < pos[3 * b + axis]; });
+
+	buildTree(begin, mid, depth + 1);
+	buildTree(mid + 1, end, depth + 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::searchTree(const int begin, const int end, const int depth, const float* query, int* ids, float* dists, int& numFound) const
+// numCandidates nearest neighbours search, ids / dists (squared) sorted by increasing distance
+{
+	if (begin >= end) { return; }
+
+	// check node
+	const int mid = (begin + end) / 2;
+	const int id = tree[mid];
+	const float* p = getPosition(id);
+	const float dist = (p[0] - query[0]) * (p[0] - query[0]) + (p[1] - query[1]) * (p[1] - query[1]) + (p[2] - query[2]) * (p[2] - query[2]);
+	// (skip duplicates of already found positions, e.g. poles of regular grids)
+	bool isDuplicate = false;
+	for (int k = 0; k < numFound && !isDuplicate; k++)
+	{
+		const float* pk = getPosition(ids[k]);
+		isDuplicate = (pk[0] - p[0]) * (pk[0] - p[0]) + (pk[1] - p[1]) * (pk[1] - p[1]) + (pk[2] - p[2]) * (pk[2] - p[2]) < 1e-10f;
+	}
+	if (!isDuplicate && (numFound < numCandidates || dist < dists[numFound - 1]))
+	{
+		int k = numFound < numCandidates ? numFound++ : numCandidates - 1;
+		while (k > 0 && dists[k - 1] > dist)
+		{
+			ids[k] = ids[k - 1];
+			dists[k] = dists[k - 1];
+			k--;
+		}
+		ids[k] = id;
+		dists[k] = dist;
+	}
+
+	// search near side first, far side only if splitting plane is closer than current worst
+	const int axis = depth % 3;
+	const float diff = query[axis] - p[axis];
+	if (diff < 0)
+	{
+		searchTree(begin, mid, depth + 1, query, ids, dists, numFound);
+		if (numFound < numCandidates || diff * diff < dists[numFound - 1]) { searchTree(mid + 1, end, depth + 1, query, ids, dists, numFound); }
+	}
+	else
+	{
+		searchTree(mid + 1, end, depth + 1, query, ids, dists, numFound);
+		if (numFound < numCandidates || diff * diff < dists[numFound - 1]) { searchTree(begin, mid, depth + 1, query, ids, dists, numFound); }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int HrirStore::getNeighbours(double azim, double elev, int* ids, float* weights) const
+// get ids of (up to maxNumNeighbours) positions surrounding direction and associated interpolation
+// weights: barycentric in the nearest enclosing triangle, inverse distance if none found.
+{
+	// sph to cart
+	const float q[3] = {
+		(float)(cos(elev) * cos(azim)),
+		(float)(cos(elev) * sin(azim)),
+		(float)sin(elev) };
+
+	int candidateIds[numCandidates];
+	float dists[numCandidates];
+	int numFound = 0;
+	searchTree(0, numPositions, 0, q, candidateIds, dists, numFound);
+	if (numFound == 0) { return 0; }
+
+	// exact match
+	if (dists[0] < 1e-10f || numFound < 3)
+	{
+		ids[0] = candidateIds[0];
+		weights[0] = 1.f;
+		return 1;
+	}
+
+	// barycentric coordinates: q = w0.p0 + w1.p1 + w2.p2 (Cramer's rule), triangles tested from
+	// nearest candidates on (non-uniform grids: 3 nearest do not always enclose direction)
+	auto det3 = [](const float* a, const float* b, const float* c)
+	{
+		return a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0]) + a[2] * (b[0] * c[1] - b[1] * c[0]);
+	};
+	for (int k = 2; k < numFound; k++)
+	{
+		for (int j = 1; j < k; j++)
+		{
+			for (int i = 0; i < j; i++)
+			{
+				const float* p0 = getPosition(candidateIds[i]);
+				const float* p1 = getPosition(candidateIds[j]);
+				const float* p2 = getPosition(candidateIds[k]);
+				const float det = det3(p0, p1, p2);
+				if (fabs(det) < 1e-9f) { continue; }
+
+				float w[3] = { det3(q, p1, p2) / det, det3(p0, q, p2) / det, det3(p0, p1, q) / det };
+				if (w[0] < -1e-4f || w[1] < -1e-4f || w[2] < -1e-4f) { continue; }
+
+				const int triangle[3] = { i, j, k };
+				float sum = 0.f;
+				for (int n = 0; n < 3; n++) { w[n] = fmax(w[n], 0.f); sum += w[n]; }
+				for (int n = 0; n < 3; n++)
+				{
+					ids[n] = candidateIds[triangle[n]];
+					weights[n] = w[n] / sum;
+				}
+				return 3;
+			}
+		}
+	}
+
+	// inverse distance weighting
+	float sum = 0.f;
+	for (int n = 0; n < 3; n++)
+	{
+		ids[n] = candidateIds[n];
+		weights[n] = 1.f / sqrtf(dists[n]);
+		sum += weights[n];
+	}
+	for (int n = 0; n < 3; n++) { weights[n] /= sum; }
+	return 3;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const float* HrirStore::getHrir(const int positionId, const int earId) const
+{
+	return hrirData + (positionId * 2 + earId) * hrirStride;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HrirStore::getInterpolatedHrir(double azim, double elev, float* left, float* right, float* earDelays) const
+// get min-phase HRIR and per ear delays for a given position, panning across nearest neighbours
+// of the measurement grid
+{
+	// make sure values are in expected range
+	jassert(azim >= -M_PI && azim <= M_PI);
+	jassert(elev >= -M_PI / 2 && elev <= M_PI / 2);
+
+	int ids[maxNumNeighbours];
+	float weights[maxNumNeighbours];
+	int numNeighbours = getNeighbours(azim, elev, ids, weights);
+
+	// fill output
+	float* out[2] = { left, right };
+	for (int earId = 0; earId < 2; earId++)
+	{
+		earDelays[earId] = 0.f;
+		for (int i = 0; i < numNeighbours; i++) { earDelays[earId] += weights[i] * getDelays(ids[i])[earId]; }
+
+		FloatVectorOperations::clear(out[earId], hrirLength);
+		for (int i = 0; i < numNeighbours; i++)
+		{
+			FloatVectorOperations::addWithMultiply(out[earId], getHrir(ids[i], earId), weights[i], hrirLength);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
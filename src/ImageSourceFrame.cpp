@@ -0,0 +1,99 @@
+#include "ImageSourceFrame.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+ImageSourceFrame::ImageSourceFrame()
+{
+	// typical frame size, grown on reception of larger ones
+	const int initialCapacity = 1024;
+	ids.reserve(initialCapacity);
+	reflectionOrders.reserve(initialCapacity);
+	positionsFirst.reserve(3 * initialCapacity);
+	positionsLast.reserve(3 * initialCapacity);
+	pathDistances.reserve(initialCapacity);
+	absorptions.reserve(NUM_OCTAVE_BANDS * initialCapacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ImageSourceFrame::decodeBlob(const void* data, const size_t size)
+// Receiver thread: decode one blob of frame (see header for format)
+{
+	const uint8* bytes = static_cast<const uint8*>(data);
+	if (size < (size_t)headerSize || memcmp(bytes, "EVIS", 4) != 0) { return false; }
+
+	const uint16 version = ByteOrder::littleEndianShort(bytes + 4);
+	const uint16 stride = ByteOrder::littleEndianShort(bytes + 6);
+	const uint32 blobFrameId = ByteOrder::littleEndianInt(bytes + 8);
+	const uint32 blobNumImages = ByteOrder::littleEndianInt(bytes + 12);
+	const uint32 firstImage = ByteOrder::littleEndianInt(bytes + 16);
+	const uint32 numRecords = ByteOrder::littleEndianInt(bytes + 20);
+
+	if (version < 1 || stride < recordSize || blobNumImages > (uint32)maxNumImages) { return false; }
+	if (firstImage > blobNumImages || numRecords > blobNumImages - firstImage) { return false; }
+	if (size < (size_t)headerSize + (size_t)numRecords * stride) { return false; }
+
+	// first blob of frame (blobs of an incomplete previous frame are dropped)
+	if (firstImage == 0)
+	{
+		frameId = blobFrameId;
+		setNumImages((int)blobNumImages);
+		numReceived = 0;
+	}
+	// blob out of sequence (previous one lost): wait for next frame
+	else if (blobFrameId != frameId || (int)firstImage != numReceived || (int)blobNumImages != numImages)
+	{
+		numReceived = -1;
+		return false;
+	}
+
+	const uint8* record = bytes + headerSize;
+	for (int i = (int)firstImage; i < (int)(firstImage + numRecords); i++)
+	{
+		ids[i] = (int)ByteOrder::littleEndianInt(record);
+		reflectionOrders[i] = (int)ByteOrder::littleEndianInt(record + 4);
+		for (int k = 0; k < 3; k++)
+		{
+			positionsFirst[3 * i + k] = readFloat(record + 8 + 4 * k);
+			positionsLast[3 * i + k] = readFloat(record + 20 + 4 * k);
+		}
+		pathDistances[i] = readFloat(record + 32);
+		for (int k = 0; k < NUM_OCTAVE_BANDS; k++)
+		{
+			absorptions[NUM_OCTAVE_BANDS * i + k] = readFloat(record + 36 + 4 * k);
+		}
+		record += stride;
+	}
+	numReceived += (int)numRecords;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ImageSourceFrame::setNumImages(const int newNumImages)
+// Allocates only if frame is larger than all previous ones
+{
+	numImages = newNumImages;
+	ids.resize(numImages);
+	reflectionOrders.resize(numImages);
+	positionsFirst.resize(3 * numImages);
+	positionsLast.resize(3 * numImages);
+	pathDistances.resize(numImages);
+	absorptions.resize(NUM_OCTAVE_BANDS * numImages);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+float ImageSourceFrame::readFloat(const uint8* data)
+// Little endian IEEE 754 float, any alignment
+{
+	const uint32 bits = ByteOrder::littleEndianInt(data);
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,11 +30,25 @@ LoggingComponent::LoggingComponent()
 	buttonRecordAmbisonicToDisk.setEnabled(true); // Is this required?
 	buttonRecordAmbisonicToDisk.setToggleState(false, sendNotification);
 
+	addAndMakeVisible(&buttonCaptureOsc);
+	buttonCaptureOsc.addListener(this);
+	buttonCaptureOsc.setButtonText("Capture OSC to disk");
+	buttonCaptureOsc.setToggleState(false, dontSendNotification);
+
+	addAndMakeVisible(&buttonEnableProfiling);
+	buttonEnableProfiling.addListener(this);
+	buttonEnableProfiling.setButtonText("Profiling");
+	buttonEnableProfiling.setToggleState(false, dontSendNotification);
+
 	addAndMakeVisible(&buttonSaveOscState);
 	buttonSaveOscState.addListener(this);
 	buttonSaveOscState.setButtonText("Save OSC state");
 	buttonSaveOscState.setEnabled(true); // Is this required?
 
+	addAndMakeVisible(&buttonLoadOscState);
+	buttonLoadOscState.addListener(this);
+	buttonLoadOscState.setButtonText("Load OSC state");
+
 	addAndMakeVisible(textLogging);
 	textLogging.setMultiLine(true);
 	textLogging.setReturnKeyStartsNewLine(true);
@@ -42,6 +56,15 @@ LoggingComponent::LoggingComponent()
 	textLogging.setScrollbarsShown(true);
 	textLogging.setCaretVisible(false);
 	textLogging.setPopupMenuEnabled(true);
+
+	addAndMakeVisible(textProfiling);
+	textProfiling.setMultiLine(true);
+	textProfiling.setReadOnly(true);
+	textProfiling.setScrollbarsShown(true);
+	textProfiling.setCaretVisible(false);
+	textProfiling.setPopupMenuEnabled(true);
+	textProfiling.setFont(Font(Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+	setProfilingState(false);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -58,10 +81,25 @@ void LoggingComponent::buttonClicked(Button* button)
 	{
 		parent->enableRecordAmbisonicToDisk(button->getToggleState());
 	}
+	else if (button == &buttonCaptureOsc)
+	{
+		if (!parent->enableOscCapture(button->getToggleState()))
+		{
+			button->setToggleState(false, dontSendNotification);
+		}
+	}
+	else if (button == &buttonEnableProfiling)
+	{
+		parent->enableProfiling(button->getToggleState());
+	}
 	else if (button == &buttonSaveOscState)
 	{
 		parent->saveOscState();
 	}
+	else if (button == &buttonLoadOscState)
+	{
+		parent->loadOscState();
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -73,6 +111,22 @@ void LoggingComponent::updateLoggingText(const String& text)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LoggingComponent::updateProfilingText(const String& text)
+{
+	textProfiling.setText(text);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LoggingComponent::setProfilingState(bool enable)
+// Reflect profiling state (e.g. enabled from command line), statistics shown once published
+{
+	buttonEnableProfiling.setToggleState(enable, dontSendNotification);
+	textProfiling.setText(enable ? "Profiling: waiting for statistics..." : "Profiling disabled");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 void LoggingComponent::paint(Graphics& g)
 {
 	g.setColour(Colours::white);
@@ -85,7 +139,7 @@ void LoggingComponent::paint(Graphics& g)
 void LoggingComponent::resized()
 {
 	int h = (getHeight() - 40) / 5;
-	int w = (getWidth() - 40) / 4;
+	int w = (getWidth() - 40) / 7;
 
 	Font labelFont = labelLogging.getFont();
 	labelLogging.setBounds(30, 5, 1.2 * labelFont.getStringWidth(labelLogging.getText()), labelFont.getHeight());
@@ -94,8 +148,12 @@ void LoggingComponent::resized()
 	labelClipping.setBounds(20 + h, 20, w - h, h);
 	buttonEnableLogs.setBounds(20 + w, 20, w, h);
 	buttonRecordAmbisonicToDisk.setBounds(20 + 2 * w, 20, w, h);
-	buttonSaveOscState.setBounds(pad(20 + 3 * w, 20, w, h, 10, 10));
-	textLogging.setBounds(pad(20, 20 + h, 4 * w, 4 * h));
+	buttonCaptureOsc.setBounds(20 + 3 * w, 20, w, h);
+	buttonEnableProfiling.setBounds(20 + 4 * w, 20, w, h);
+	buttonSaveOscState.setBounds(pad(20 + 5 * w, 20, w, h, 10, 10));
+	buttonLoadOscState.setBounds(pad(20 + 6 * w, 20, w, h, 10, 10));
+	textLogging.setBounds(pad(20, 20 + h, 7 * w, 2 * h));
+	textProfiling.setBounds(pad(20, 20 + 3 * h, 7 * w, 2 * h));
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +29,99 @@ public:
         // This method is where you should put your application's initialisation code..
 
         mainWindow = new MainWindow (getApplicationName());
+        handleOscTestOptions (commandLine);
+        handleRenderOptions (commandLine);
+    }
+
+    void handleOscTestOptions (const String & commandLine)
+    // OSC state, capture / replay and synthetic scene options (load testing without raytracer):
+    //   --osc-state <file>          load saved scene state (see MainComponent::saveOscState)
+    //   --osc-capture <file>        capture incoming OSC traffic to file
+    //   --osc-replay <file>         replay capture in place of the OSC receiver
+    //   --osc-replay-speed <x>      replay speed factor, 0 for max speed (default 1)
+    //   --osc-replay-udp            replay as UDP packets sent to the OSC receiver
+    //   --generate-scene <n>        synthetic shoebox scene of n source images (10 .. 5000)
+    //   --generate-rate <x>         synthetic scene update rate, in frames per second (default 20)
+    //   --generate-order <n>        synthetic scene max reflection order (default 20)
+    //   --generate-udp              send synthetic scene as UDP packets to the OSC receiver
+    {
+        auto mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent());
+        if (mainComponent == nullptr) { return; }
+
+        StringArray args = StringArray::fromTokens (commandLine, true);
+        auto getOption = [&args] (const String & name) -> String
+        {
+            int index = args.indexOf (name);
+            if (index < 0 || index + 1 >= args.size()) { return String(); }
+            return args[index + 1].unquoted();
+        };
+
+        String stateFile = getOption ("--osc-state");
+        if (stateFile.isNotEmpty())
+        {
+            mainComponent->loadOscState (File::getCurrentWorkingDirectory().getChildFile (stateFile));
+        }
+
+        String captureFile = getOption ("--osc-capture");
+        if (captureFile.isNotEmpty())
+        {
+            mainComponent->startOscCapture (File::getCurrentWorkingDirectory().getChildFile (captureFile));
+        }
+
+        String replayFile = getOption ("--osc-replay");
+        if (replayFile.isNotEmpty())
+        {
+            String speed = getOption ("--osc-replay-speed");
+            mainComponent->startOscReplay (File::getCurrentWorkingDirectory().getChildFile (replayFile),
+                                           speed.isNotEmpty() ? speed.getDoubleValue() : 1.0,
+                                           !args.contains ("--osc-replay-udp"));
+        }
+
+        String numImages = getOption ("--generate-scene");
+        if (numImages.isNotEmpty())
+        {
+            SceneGenerator::Settings settings;
+            settings.numImages = numImages.getIntValue();
+            String rate = getOption ("--generate-rate");
+            if (rate.isNotEmpty()) { settings.updateRate = rate.getFloatValue(); }
+            String order = getOption ("--generate-order");
+            if (order.isNotEmpty()) { settings.maxReflectionOrder = order.getIntValue(); }
+            mainComponent->startSceneGenerator (settings, !args.contains ("--generate-udp"));
+        }
+    }
+
+    void handleRenderOptions (const String & commandLine)
+    // Rendering options:
+    //   --render-threads <n>                threads source images are rendered on (default: one per core, minus one)
+    //   --source-directivity <i>:<pattern>  directivity of source i (sorted by name), repeatable
+    //   --sh-directivity                    directivity gains from SH expansion of the patterns
+    //   --profile                           time audio callback stages, shown in logging panel
+    //   --stats <host>:<port>               profiling statistics sent as OSC /stats messages (implies --profile)
+    {
+        auto mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent());
+        if (mainComponent == nullptr) { return; }
+
+        StringArray args = StringArray::fromTokens (commandLine, true);
+        if (args.contains ("--profile") || args.contains ("--stats")) { mainComponent->enableProfiling (true); }
+        if (args.contains ("--sh-directivity")) { mainComponent->enableSphericalHarmonicDirectivity (true); }
+        for (int i = 0; i + 1 < args.size(); i++)
+        {
+            String value = args[i + 1].unquoted();
+            if (args[i] == "--render-threads")
+            {
+                mainComponent->setNumRenderThreads (value.getIntValue());
+            }
+            else if (args[i] == "--source-directivity" && value.containsChar (':'))
+            {
+                mainComponent->updateSourceDirectivity (value.fromFirstOccurrenceOf (":", false, false),
+                                                        value.upToFirstOccurrenceOf (":", false, false).getIntValue());
+            }
+            else if (args[i] == "--stats" && value.containsChar (':'))
+            {
+                mainComponent->sendProfilingStats (value.upToLastOccurrenceOf (":", false, false),
+                                                   value.fromLastOccurrenceOf (":", false, false).getIntValue());
+            }
+        }
     }
 
     void shutdown() override
@@ -6,19 +6,21 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 MainComponent::MainComponent() :
-	oscHandler(),
+	engine(EvertimsEngine::realtime),
 	audioIOComponent(),
 	auralisationComponent(),
 	loggingComponent(),
 	levelMeterComponent(ff::LevelMeter::Compact),
 	audioRecorder(),
-	delayLine(),
-	sourceImagesHandler(),
-	ambi2binContainer(),
 	audioSetupComponent(deviceManager, 0, 256, 0, 256, false, false, false, false)
 {
 		setLookAndFeel(&customLookAndFeel);
 
+    // Render threads spread over available cores, Ambisonic output (see fillNextAudioBlock).
+    engine.setParameter(EvertimsEngine::numRenderThreads, RenderThreadPool::getDefaultNumThreads());
+    engine.setParameter(EvertimsEngine::ambisonicOrder, ambisonicOrder);
+    engine.setParameter(EvertimsEngine::outputFormat, EvertimsEngine::ambisonicOutput);
+
 		levelMeterComponent.setMeterSource(&levelMeterSource);
 		addAndMakeVisible(&levelMeterComponent);
 
@@ -26,10 +28,11 @@ MainComponent::MainComponent() :
 		setSize(650, 700);
 
     // Specify the required number of input and output channels.
-    setAudioChannels (0, N_AMBI_CH);
+    setAudioChannels (0, getNumAmbiChannels(ambisonicOrder));
     
-    // Add to change listeners.
-    oscHandler.addChangeListener(this);
+    // Add to change listeners (GUI log, OSC connection error, profiling statistics).
+    engine.getScene().addChangeListener(this);
+    engine.getProfiler().addChangeListener(this);
    
     // Add audioIOComponent as addAudioCallback for adc input.
     deviceManager.addAudioCallback(&audioIOComponent);
@@ -51,6 +54,9 @@ MainComponent::MainComponent() :
 
 MainComponent::~MainComponent()
 {
+    engine.getScene().removeChangeListener(this);
+    engine.getProfiler().removeChangeListener(this);
+    
     // Fix denied access at close when sound playing,
     // see https://forum.juce.com/t/tutorial-playing-sound-files-raises-an-exception-on-2nd-load/15738/2
     audioIOComponent.transportSource.setSource(nullptr);
@@ -69,166 +75,82 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
 // Called on the audio thread, not the GUI thread.
 {
     
+    // Ambisonic order (only changed while audio device is stopped, see updateAmbisonicOrder)
+    int numAmbiChannels = getNumAmbiChannels(ambisonicOrder);
+    
     // Audio file reader & adc input
     audioIOComponent.prepareToPlay (samplesPerBlockExpected, sampleRate);
     
     // Recorder
-    audioRecorder.prepareToPlay (samplesPerBlockExpected, sampleRate);
+    audioRecorder.prepareToPlay (samplesPerBlockExpected, sampleRate, numAmbiChannels);
     
-    // Working buffer
-    workingBuffer.setSize(1, samplesPerBlockExpected);
-    // Ambisonic buffer holds 2 stereo channels (first) + ambisonic channels
-    ambisonicBuffer.setSize(2 + N_AMBI_CH, samplesPerBlockExpected);
-    // Because of stupid design choice of ambisonicBuffer, require this additional ambisonicRecordBuffer. to clean..
-    ambisonicRecordBuffer.setSize(N_AMBI_CH, samplesPerBlockExpected);
+    // Input buffer (one channel per source, at least stereo for audio file downmix), output
+    // buffer holds the Ambisonic channels of each listener (as many as there are device outputs for)
+    inputBuffer.setSize(jmax(2, (int)SourceImagesHandler::maxNumSources), samplesPerBlockExpected);
+    outputBuffer.setSize(SourceImagesHandler::maxNumListeners * numAmbiChannels, samplesPerBlockExpected);
+    ambisonicRecordBuffer.setSize(numAmbiChannels, samplesPerBlockExpected);
     
     // Keep track of sample rate
     localSampleRate = sampleRate;
     localSamplesPerBlockExpected = samplesPerBlockExpected;
     
-    // Initialise the DelayLine to be able to hold 1 second of samples.
-    delayLine.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    delayLine.setSize(1, sampleRate);
-    
-    sourceImagesHandler.prepareToPlay (samplesPerBlockExpected, sampleRate);
-    
-    // Initialise ambi 2 bin decoding: fill in data in ABIR filtered and ABIR filter themselves
-    for( int i = 0; i < N_AMBI_CH; i++ )
-    {
-        ambi2binFilters[ 2*i ].init(samplesPerBlockExpected, AMBI2BIN_IR_LENGTH);
-        ambi2binFilters[ 2*i ].setImpulseResponse(ambi2binContainer.ambi2binIrDict[i][0].data()); // [ch x ear x sampID]
-        ambi2binFilters[2*i+1].init(samplesPerBlockExpected, AMBI2BIN_IR_LENGTH);
-        ambi2binFilters[2*i+1].setImpulseResponse(ambi2binContainer.ambi2binIrDict[i][1].data()); // [ch x ear x sampID]
-    }
+    // Delay lines, source images, ambi 2 bin decoding
+    engine.prepare(sampleRate, samplesPerBlockExpected, inputBuffer.getNumChannels(), outputBuffer.getNumChannels());
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
-// Audio Processing (split in "processAmbisonicBuffer" and "fillNextAudioBlock" to enable
-// IR recording: using the same methods as the main thread)
-{
-  // Check if update required
-  if( updateNumFreqBandrequired ){
-      sourceImagesHandler.setFilterBankSize(numFreqBands);
-      updateNumFreqBandrequired = false;
-      // Trigger general update: must re-dimension abs.coeffs and trigger update future->current, see in function
-      sourceImagesHandler.updateFromOscHandler(oscHandler);
-  }
-    
-  // Fill buffer with audiofile data
-  audioIOComponent.getNextAudioBlock(bufferToFill);
-    
-  // Execute main audio processing
+// Audio Processing (see EvertimsEngine::process), output written by "fillNextAudioBlock" to
+// enable IR recording: using the same methods as the main thread
+{
+  // Whole callback timed if profiling (see StageProfiler)
+  StageProfiler& profiler = engine.getProfiler();
+  const bool isProfiling = profiler.isEnabled();
+  const int64 callbackTicks = isProfiling ? StageProfiler::getTicks() : 0;
+
+  // Fill input buffer with audiofile data / adc input, one channel per source
+  const int numSources = engine.getNumSources();
+  AudioBuffer<float> sourceInputs(inputBuffer.getArrayOfWritePointers(), jmax(2, numSources), bufferToFill.numSamples);
+  audioIOComponent.getNextAudioBlock(AudioSourceChannelInfo(sourceInputs), numSources);
+  bufferToFill.clearActiveBufferRegion();
+    
+  // Execute main audio processing (output buffer simply left cleared while recording IR)
   if( !isRecordingIr )
   {
-      processAmbisonicBuffer( bufferToFill.buffer );
+      engine.process( inputBuffer.getArrayOfReadPointers(), outputBuffer.getArrayOfWritePointers(), bufferToFill.numSamples );
       if( audioRecorder.isRecording() ){ recordAmbisonicBuffer(); }
       fillNextAudioBlock( bufferToFill.buffer );
   }
-  // Simply clear output buffer
-  else
-  {
-      bufferToFill.clearActiveBufferRegion();
-  }
    
+  const int64 levelMeterTicks = isProfiling ? StageProfiler::getTicks() : 0;
 	levelMeterSource.measureBlock(*bufferToFill.buffer);
 
-  // Check if source images need update (i.e. update called by OSC handler
-  // while source images in the midst of a crossfade
-  if( sourceImageHandlerNeedsUpdate && sourceImagesHandler.crossfadeOver )
+  if (isProfiling)
   {
-      sourceImagesHandler.updateFromOscHandler(oscHandler);
-      requireDelayLineSizeUpdate = true;
-      sourceImageHandlerNeedsUpdate = false;
+      const int64 now = StageProfiler::getTicks();
+      profiler.addStageTime(StageProfiler::levelMeter, now - levelMeterTicks);
+      profiler.addCallbackTime(now - callbackTicks, bufferToFill.numSamples, localSampleRate);
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void MainComponent::processAmbisonicBuffer( AudioBuffer<float> *const audioBufferToFill )
-// Audio Processing: split from getNextAudioBlock to use it for recording IR
-{
-    workingBuffer.copyFrom(0, 0, audioBufferToFill->getWritePointer(0), workingBuffer.getNumSamples());
-    
-    //==========================================================================
-    // SOURCE IMAGE PROCESSING
-    
-    if ( sourceImagesHandler.numSourceImages > 0 )
-    {
-        
-        //==========================================================================
-        // DELAY LINE
-        
-        // update delay line size if need be (TODO: MOVE THIS .SIZE() OUTSIDE OF AUDIO PROCESSING LOOP
-        if ( requireDelayLineSizeUpdate )
-        {
-            // get maximum required delay line duration
-            float maxDelay = sourceImagesHandler.getMaxDelayFuture();
-            // get associated required delay line buffer length
-            int updatedDelayLineLength = (int)( 1.5 * maxDelay * localSampleRate); // longest delay creates noisy sound if delay line is exactly 1* its duration
-            
-            // update delay line size
-            delayLine.setSize(1, updatedDelayLineLength);
-            
-            // unflag update required
-            requireDelayLineSizeUpdate = false;
-        }
-        
-        // add current audio buffer to delay line
-        delayLine.copyFrom(0, workingBuffer, 0, 0, workingBuffer.getNumSamples());
-        
-        // loop over sources images, apply delay + room coloration + spatialization
-        sourceImagesHandler.getNextAudioBlock( & delayLine, ambisonicBuffer );
-
-        delayLine.incrementWriteIndex(workingBuffer.getNumSamples());
-    }
-    
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
 void MainComponent::fillNextAudioBlock( AudioBuffer<float> *const audioBufferToFill )
+// Copy engine output to device: Ambisonic channels of each listener, as many as there are
+// output channels for (first source input on the first two channels if no source image)
 {
-    
-    //==========================================================================
-    // SPATIALISATION: Ambisonic decoding + virtual speaker approach + binaural
-    
-    if ( sourceImagesHandler.numSourceImages > 0)
-    {
-        // duplicate channel before filtering for two ears
-        ambisonicBuffer2ndEar = ambisonicBuffer;
-
-        // loop over Ambisonic channels
-        for (int k = 0; k < N_AMBI_CH; k++)
-        {
-            //ambi2binFilters[ 2*k ].process(ambisonicBuffer.getWritePointer(k+2)); // left
-            //ambi2binFilters[2*k+1].process(ambisonicBuffer2ndEar.getWritePointer(k+2)); // right
-
-            // collapse left channel, collapse right channel
-            //ambisonicBuffer.addFrom(0, 0, ambisonicBuffer.getWritePointer(2+k), workingBuffer.getNumSamples());
-            //ambisonicBuffer2ndEar.addFrom(1, 0, ambisonicBuffer2ndEar.getWritePointer(2+k), workingBuffer.getNumSamples());
-					  audioBufferToFill->copyFrom(k, 0, ambisonicBuffer, k + 2, 0, workingBuffer.getNumSamples());
-				}
-
-        // final rewrite to output buffer
-        //audioBufferToFill->copyFrom(0, 0, ambisonicBuffer, 0, 0, workingBuffer.getNumSamples());
-        //audioBufferToFill->copyFrom(1, 0, ambisonicBuffer2ndEar, 1, 0, workingBuffer.getNumSamples());
-    }
-    
-    //==========================================================================
-    // if no source image, simply rewrite to output buffer (TODO: remove stupid double copy)
-    else
+    const int numChannels = jmin(outputBuffer.getNumChannels(), audioBufferToFill->getNumChannels());
+    for (int k = 0; k < numChannels; k++)
     {
-        audioBufferToFill->copyFrom(0, 0, workingBuffer, 0, 0, workingBuffer.getNumSamples());
-        audioBufferToFill->copyFrom(1, 0, workingBuffer, 0, 0, workingBuffer.getNumSamples());
+        audioBufferToFill->copyFrom(k, 0, outputBuffer, k, 0, outputBuffer.getNumSamples());
     }
     
     //==========================================================================
     // CLIP OUTPUT (DEBUG PRECAUTION)
     auto outL = audioBufferToFill->getWritePointer(0);
     auto outR = audioBufferToFill->getWritePointer(1);
-    for (int i = 0; i < workingBuffer.getNumSamples(); i++)
+    for (int i = 0; i < outputBuffer.getNumSamples(); i++)
     {
         outL[i] = clipOutput(outL[i]);
         outR[i] = clipOutput(outR[i]);
@@ -238,21 +160,14 @@ void MainComponent::fillNextAudioBlock( AudioBuffer<float> *const audioBufferToF
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::recordAmbisonicBuffer()
-// Record Ambisonic buffer to disk
+// Record Ambisonic buffer (first listener) to disk
 {
-    if ( sourceImagesHandler.numSourceImages > 0 )
+    for (int k = 0; k < ambisonicRecordBuffer.getNumChannels(); k++)
     {
-        // loop over Ambisonic channels to extract only ambisonic channels. I know, stupid. Needs cleaning
-        for (int k = 0; k < N_AMBI_CH; k++)
-        {
-            ambisonicRecordBuffer.copyFrom(k, 0, ambisonicBuffer, k+2, 0, ambisonicBuffer.getNumSamples());
-        }
-    }
-    // if no source image, data in ambisonicBuffer is meaningless: copy content of workingbuffer (raw input) rather
-    else{
-        ambisonicRecordBuffer.clear();
-        ambisonicRecordBuffer.copyFrom(0, 0, workingBuffer, 0, 0, ambisonicBuffer.getNumSamples());
+        ambisonicRecordBuffer.copyFrom(k, 0, outputBuffer, k, 0, ambisonicRecordBuffer.getNumSamples());
     }
+    // if no source image, output holds raw input on its first two channels: keep it on W only
+    if ( engine.getNumSourceImages() == 0 ){ ambisonicRecordBuffer.clear(1, 0, ambisonicRecordBuffer.getNumSamples()); }
     
     // write to disk
     audioRecorder.recordBuffer((const float **) ambisonicRecordBuffer.getArrayOfWritePointers(), ambisonicRecordBuffer.getNumChannels(), ambisonicRecordBuffer.getNumSamples());
@@ -263,6 +178,10 @@ void MainComponent::recordAmbisonicBuffer()
 void MainComponent::recordIr()
 // Record current Room Impulse Response to disk
 {
+    // freeze scene (OSC updates applied once recording is over)
+    OSCHandler& oscHandler = engine.getScene();
+    const ScopedLock lock(oscHandler.getSceneLock());
+    
     // estimate output buffer size (based on max delay time)
     auto maxDelaySourceImages = getMaxValue( oscHandler.getSourceImageDelays() );
     auto rt60 = oscHandler.getRT60Values();
@@ -275,20 +194,21 @@ void MainComponent::recordIr()
     // get min delay
     int minDelayInSamp = ceil( localSampleRate * getMinValue( oscHandler.getSourceImageDelays() ) );
     
-    // init
-    recordingBufferInput.setSize(2, localSamplesPerBlockExpected);
+    // init (one input channel per engine input, at least stereo for output)
+    const int numSources = engine.getNumSources();
+    recordingBufferInput.setSize(inputBuffer.getNumChannels(), localSamplesPerBlockExpected);
     recordingBufferInput.clear();
     recordingBufferOutput.setSize(2, 2*maxDelayInSamp);
     recordingBufferOutput.clear();
-    recordingBufferAmbisonicOutput.setSize(N_AMBI_CH, 2*maxDelayInSamp);
+    int numAmbiChannels = getNumAmbiChannels(engine.getAmbisonicOrder()); // first listener
+    recordingBufferAmbisonicOutput.setSize(numAmbiChannels, 2*maxDelayInSamp);
     recordingBufferAmbisonicOutput.clear();
     
-    // prepare impulse response buffer
-    recordingBufferInput.getWritePointer(0)[0] = 1.0f;
+    // prepare impulse response buffer (impulse fed to all sources)
+    for (int s = 0; s < numSources; s++) { recordingBufferInput.getWritePointer(s)[0] = 1.0f; }
     
     // clear delay lines / fdn buffers of main thread
-    delayLine.clear();
-    sourceImagesHandler.reverbTail.clear();
+    engine.reset();
     
     // pass impulse input into processing loop until IR faded below threshold
     float rms = 1.0f;
@@ -297,16 +217,16 @@ void MainComponent::recordIr()
     // source-listener distances, where RMS is zero for the first few buffers until LOS image source reaches listener.
     while( ( rms >= 0.00001f || bufferId*localSamplesPerBlockExpected < minDelayInSamp ) && bufferId*localSamplesPerBlockExpected < maxDelayInSamp )
     {
-        // clear impulse after first round
+        // clear impulse after first round (output channels written by fillNextAudioBlock as well)
         if( bufferId >= 1 ){ recordingBufferInput.clear(); }
         
-        // execute main audio processing: fill ambisonic buffer
-        processAmbisonicBuffer( &recordingBufferInput );
+        // execute main audio processing: fill output buffer
+        engine.process( recordingBufferInput.getArrayOfReadPointers(), outputBuffer.getArrayOfWritePointers(), localSamplesPerBlockExpected );
         
         // add to output ambisonic buffer
-        for( int k = 0; k < N_AMBI_CH; k++ )
+        for( int k = 0; k < numAmbiChannels; k++ )
         {
-            recordingBufferAmbisonicOutput.addFrom(k, bufferId*localSamplesPerBlockExpected, ambisonicBuffer, k+2, 0, localSamplesPerBlockExpected);
+            recordingBufferAmbisonicOutput.addFrom(k, bufferId*localSamplesPerBlockExpected, outputBuffer, k, 0, localSamplesPerBlockExpected);
         }
         
         // ambisonic to stereo
@@ -326,10 +246,10 @@ void MainComponent::recordIr()
     
     // resize output IR buffers to max meaningful sample length
     recordingBufferOutput.setSize(2, bufferId*localSamplesPerBlockExpected, true);
-    recordingBufferAmbisonicOutput.setSize(N_AMBI_CH, bufferId*localSamplesPerBlockExpected, true);
+    recordingBufferAmbisonicOutput.setSize(numAmbiChannels, bufferId*localSamplesPerBlockExpected, true);
     
     // save output
-    audioIOComponent.saveIR(recordingBufferAmbisonicOutput, localSampleRate, String("Evertims_IR_Recording_ambi_") + String(AMBI_ORDER) + String("_order"));
+    audioIOComponent.saveIR(recordingBufferAmbisonicOutput, localSampleRate, String("Evertims_IR_Recording_ambi_") + String(engine.getAmbisonicOrder()) + String("_order"));
     audioIOComponent.saveIR(recordingBufferOutput, localSampleRate, "Evertims_IR_Recording_binaural");
     
     // unlock main audio thread
@@ -346,8 +266,7 @@ void MainComponent::releaseResources()
     audioIOComponent.transportSource.releaseResources();
     
     // clear all "delay line" like buffers
-    delayLine.clear();
-    sourceImagesHandler.reverbTail.clear();
+    engine.reset();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -367,23 +286,9 @@ float MainComponent::clipOutput(float input)
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateOnOscReceive()
-// Method called when new OSC messages are available
+// Request a full source images update (e.g. after a rendering parameter change)
 {
-    // update OSC handler internals (has to happend here, to ensure that they won't be updated while
-    // running the sourceImagesHandler.updateFromOscHandler method that reads them OSC internals.
-    oscHandler.updateInternals();
-    
-    // if sourceImagesHandler not in the midst of an update
-    if( sourceImagesHandler.crossfadeOver && !sourceImageHandlerNeedsUpdate )
-    {
-        // update source images attributes based on latest received OSC info
-        sourceImagesHandler.updateFromOscHandler(oscHandler);
-        
-        // now that everything is ready: set update flag, to resize delay line at next audio loop
-        requireDelayLineSizeUpdate = true;
-    }
-    // otherwise, flag that an update is required
-    else{ sourceImageHandlerNeedsUpdate = true; }
+    engine.commitScene();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -424,10 +329,21 @@ void MainComponent::resized()
 
 void MainComponent::changeListenerCallback (ChangeBroadcaster* broadcaster)
 {
-    if (broadcaster == &oscHandler)
+    if (broadcaster == &engine.getScene())
     {
-				loggingComponent.updateLoggingText(oscHandler.getMapContentForGUI());
-        updateOnOscReceive();
+        // OSC receiver failed to connect (no GUI from the engine)
+        const String connectionError = engine.getScene().getConnectionError();
+        if (connectionError.isNotEmpty())
+        {
+            engine.getScene().clearConnectionError();
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Connection error", connectionError, "OK");
+        }
+				loggingComponent.updateLoggingText(engine.getScene().getMapContentForGUI());
+    }
+    else if (broadcaster == &engine.getProfiler())
+    {
+        // statistics published by the profiler thread (stale once disabled)
+        if (engine.getProfiler().isEnabled()) { loggingComponent.updateProfilingText(engine.getProfiler().getSummary()); }
     }
 }
 
@@ -442,22 +358,35 @@ Component* createMainContentComponent()
 
 void MainComponent::enableReverbTail(bool enable)
 {
-	sourceImagesHandler.enableReverbTail = enable;
-	updateOnOscReceive(); // Enabling reverb requires an update of the delay line size.
+	engine.setParameter(EvertimsEngine::enableReverbTail, enable);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::enableDirectToBinaural(bool enable)
 {
-	sourceImagesHandler.enableDirectToBinaural = enable;
+	engine.setParameter(EvertimsEngine::enableDirectToBinaural, enable);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::enableSoundFieldRotation(bool enable)
+{
+	engine.setParameter(EvertimsEngine::enableSoundFieldRotation, enable);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::updateNumBinauralImages(int value)
+{
+	engine.setParameter(EvertimsEngine::numBinauralImages, value);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::saveRIR()
 {
-	if (sourceImagesHandler.numSourceImages > 0)
+	if (engine.getNumSourceImages() > 0)
 	{
 		isRecordingIr = true;
 		recordIr();
@@ -473,64 +402,122 @@ void MainComponent::saveRIR()
 
 void MainComponent::clearSourceImage()
 {
-	oscHandler.clear(false);
-	changeListenerCallback(&oscHandler);
+	engine.getScene().clear(false); // applied by scene thread, GUI log updated after
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateNumFrequencyBands(int value)
 {
-	numFreqBands = value;
-	updateNumFreqBandrequired = true; // Update flag for multi-threaded update.
+	engine.setParameter(EvertimsEngine::numFrequencyBands, value); // Applied by audio thread.
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::updateAmbisonicOrder(int value)
+{
+	if (value == ambisonicOrder) { return; }
+
+	// Scene thread uses Ambisonic encoder: hold it off while order changes
+	const ScopedLock lock(engine.getScene().getSceneLock());
+
+	// Restart audio device with as many outputs as Ambisonic channels: buffers, encoder and
+	// decoder are re-allocated in prepareToPlay, while no audio callback is running.
+	AudioDeviceManager::AudioDeviceSetup setup;
+	deviceManager.getAudioDeviceSetup(setup);
+	deviceManager.closeAudioDevice();
+
+	ambisonicOrder = value;
+	engine.setParameter(EvertimsEngine::ambisonicOrder, value);
+
+	setup.useDefaultOutputChannels = false;
+	setup.outputChannels.clear();
+	setup.outputChannels.setRange(0, getNumAmbiChannels(value), true);
+	String error = deviceManager.setAudioDeviceSetup(setup, true);
+	if (error.isNotEmpty())
+	{
+		AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Audio device error", error, "OK");
+	}
+
+	updateOnOscReceive(); // Compute Ambisonic gains for the new order.
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::updateSourceDirectivity(String value, int sourceIndex)
+// Directivity of source sourceIndex (in sources sorted by name), or default one if -1
+{
+	if (engine.setSourceDirectivity(value, sourceIndex)) { return; }
+
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "failed to load file", "directivity/" + value + ".sofa", "OK");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::enableSphericalHarmonicDirectivity(bool enable)
+// Directivity gains from SH expansion of the patterns rather than lookup tables (see DirectivityHandler)
+{
+	engine.setParameter(EvertimsEngine::sphericalHarmonicDirectivity, enable ? 1.0 : 0.0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void MainComponent::updateSourceDirectivity(String value)
+void MainComponent::setNumRenderThreads(int value)
+// Number of threads source images are rendered on (audio thread included)
 {
-	String filename;
-	filename << "directivity/" << value << ".sofa";
-	
-	sourceImagesHandler.directivityHandler.loadFile(filename);
-	updateOnOscReceive();
+	// render threads only changed while no audio callback is running
+	const ScopedLock lock(deviceManager.getAudioCallbackLock());
+	engine.setParameter(EvertimsEngine::numRenderThreads, value);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateDirectPathGain(double value)
 {
-	sourceImagesHandler.directPathGain = value;
+	engine.setParameter(EvertimsEngine::directPathGain, value);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateEarlyReflectionsGain(double value)
 {
-	sourceImagesHandler.earlyGain = value;
+	engine.setParameter(EvertimsEngine::earlyReflectionsGain, value);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateReverbTailGain(double value)
 {
-	sourceImagesHandler.reverbTailGain = value;
+	engine.setParameter(EvertimsEngine::reverbTailGain, value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::updateSpreadFactor(double value)
+{
+	engine.setParameter(EvertimsEngine::spreadFactor, value);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void MainComponent::updateCrossfadeFactor(double value)
 {
-	sourceImagesHandler.crossfadeStep = value;
-	sourceImagesHandler.binauralEncoder.crossfadeStep = value;
+	engine.setParameter(EvertimsEngine::crossfadeFactor, value);
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::updateMaxSceneUpdateRate(int value)
+{
+	engine.setParameter(EvertimsEngine::maxSceneUpdateRate, value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
 String MainComponent::getLogs(bool enable)
 {
 	if (enable) return String("");
-	return oscHandler.getMapContentForGUI();
+	return engine.getScene().getMapContentForGUI();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -545,11 +532,99 @@ void MainComponent::enableRecordAmbisonicToDisk(bool enable)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MainComponent::enableProfiling(bool enable)
+// Per stage timing of the audio callback, statistics shown in logging panel (see StageProfiler)
+{
+	engine.getProfiler().setEnabled(enable);
+	loggingComponent.setProfilingState(enable);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::sendProfilingStats(const String& host, int port)
+// Profiling statistics also sent as OSC /stats messages to host:port
+{
+	if (engine.getProfiler().setOscTarget(host, port)) { return true; }
+
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Profiling", "Cannot send statistics to " + host + ":" + String(port), "OK");
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MainComponent::saveOscState()
 {
-	String output = oscHandler.getMapContentForLog();
+	String output = engine.getScene().getMapContentForLog();
 	saveStringToDesktop("EVERTims_state", output);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MainComponent::loadOscState()
+// Load state previously saved with saveOscState
+{
+	FileChooser chooser("Select an EVERTims state file to load...", File::getSpecialLocation(File::userDesktopDirectory), "*.txt");
+	if (chooser.browseForFileToOpen()) { loadOscState(chooser.getResult()); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::loadOscState(const File& stateFile)
+{
+	int errorLine = 0;
+	if (engine.getScene().loadState(stateFile, errorLine)) { return true; }
+
+	String message = "Cannot load " + stateFile.getFullPathName();
+	if (errorLine > 0) { message += " (invalid line " + String(errorLine) + ")"; }
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "OSC state", message, "OK");
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::enableOscCapture(bool enable)
+// Capture incoming OSC traffic to desktop (see OSCCapture), false if capture could not start
+{
+	if (!enable)
+	{
+		engine.getScene().stopCapture();
+		return true;
+	}
+	const File file(File::getSpecialLocation(File::userDesktopDirectory).getNonexistentChildFile("EVERTims_osc_capture", ".evcap"));
+	return startOscCapture(file);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::startOscCapture(const File& captureFile)
+{
+	if (engine.getScene().startCapture(captureFile)) { return true; }
+
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "OSC capture", "Cannot write " + captureFile.getFullPathName(), "OK");
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::startOscReplay(const File& captureFile, double speed, bool inProcess)
+// Replay OSC capture, speed 1 for original timing, 0 for max speed
+{
+	if (engine.getScene().startReplay(captureFile, speed, inProcess)) { return true; }
+
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "OSC replay", "Cannot replay " + captureFile.getFullPathName(), "OK");
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MainComponent::startSceneGenerator(const SceneGenerator::Settings& settings, bool inProcess)
+// Synthetic scene in place of the raytracer (see SceneGenerator)
+{
+	if (engine.getScene().startGenerator(settings, inProcess)) { return true; }
+
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Scene generator", "Cannot send synthetic scene to OSC port", "OK");
+	return false;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
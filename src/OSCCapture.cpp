@@ -0,0 +1,550 @@
+#include "OSCCapture.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OSCCaptureWriter::OSCCaptureWriter() :
+	Thread("OSC capture writer")
+{
+	ring.resize(ringSize);
+	record.reserve(1 << 16); // max UDP payload
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OSCCaptureWriter::~OSCCaptureWriter()
+{
+	stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCaptureWriter::start(const File& captureFile)
+// Start capture to captureFile (overwritten), false if it can't be written
+{
+	stop();
+
+	captureFile.deleteFile();
+	stream.reset(new FileOutputStream(captureFile));
+	if (stream->failedToOpen())
+	{
+		stream = nullptr;
+		return false;
+	}
+	stream->write(OSCCaptureFormat::magic(), 8);
+	stream->writeInt((int)OSCCaptureFormat::version);
+
+	ringFifo.reset();
+	numDroppedPackets = 0;
+	{
+		const SpinLock::ScopedLockType lock(writeLock);
+		startTime = Time::getMillisecondCounterHiRes();
+		capturing = true;
+	}
+	startThread();
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::stop()
+// Stop capture, packets received so far are written to disk
+{
+	{
+		const SpinLock::ScopedLockType lock(writeLock);
+		capturing = false;
+	}
+	stopThread(2000);
+
+	if (stream == nullptr) { return; }
+	drain();
+	stream->flush();
+	stream = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::write(const OSCMessage& message)
+// Receiver thread
+{
+	if (!capturing) { return; }
+	const SpinLock::ScopedLockType lock(writeLock);
+	if (!capturing) { return; }
+
+	record.clear();
+	appendUint32(0); // size, set in writeRecord
+	const double time = Time::getMillisecondCounterHiRes() - startTime;
+	uint64 timeBits;
+	memcpy(&timeBits, &time, sizeof(double));
+	appendUint64(timeBits);
+	record.push_back('m');
+	appendMessage(message);
+	writeRecord();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::write(const OSCBundle& bundle)
+// Receiver thread
+{
+	if (!capturing) { return; }
+	const SpinLock::ScopedLockType lock(writeLock);
+	if (!capturing) { return; }
+
+	record.clear();
+	appendUint32(0); // size, set in writeRecord
+	const double time = Time::getMillisecondCounterHiRes() - startTime;
+	uint64 timeBits;
+	memcpy(&timeBits, &time, sizeof(double));
+	appendUint64(timeBits);
+	record.push_back('#');
+	appendBundle(bundle);
+	writeRecord();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::run()
+// Disk thread
+{
+	while (!threadShouldExit())
+	{
+		drain();
+		wait(20);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::writeRecord()
+// Receiver thread: hand record over to disk thread, whole or not at all
+{
+	const uint32 size = (uint32)record.size() - 4;
+	for (int i = 0; i < 4; i++) { record[i] = (uint8)(size >> (8 * i)); }
+
+	int start1, size1, start2, size2;
+	ringFifo.prepareToWrite((int)record.size(), start1, size1, start2, size2);
+	if (size1 + size2 < (int)record.size())
+	{
+		numDroppedPackets++;
+		return;
+	}
+	memcpy(ring.data() + start1, record.data(), size1);
+	if (size2 > 0) { memcpy(ring.data() + start2, record.data() + size1, size2); }
+	ringFifo.finishedWrite(size1 + size2);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::drain()
+// Disk thread: write pending records to file
+{
+	int start1, size1, start2, size2;
+	ringFifo.prepareToRead(ringFifo.getNumReady(), start1, size1, start2, size2);
+	if (size1 > 0) { stream->write(ring.data() + start1, size1); }
+	if (size2 > 0) { stream->write(ring.data() + start2, size2); }
+	ringFifo.finishedRead(size1 + size2);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendMessage(const OSCMessage& message)
+{
+	appendString(message.getAddressPattern().toString());
+
+	const size_t numArgsPosition = record.size();
+	appendUint32(0);
+	uint32 numArgs = 0;
+	for (int i = 0; i < message.size(); i++)
+	{
+		const OSCArgument& arg = message[i];
+		if (arg.isInt32())
+		{
+			record.push_back('i');
+			appendUint32((uint32)arg.getInt32());
+		}
+		else if (arg.isFloat32())
+		{
+			record.push_back('f');
+			const float value = arg.getFloat32();
+			uint32 bits;
+			memcpy(&bits, &value, sizeof(float));
+			appendUint32(bits);
+		}
+		else if (arg.isString())
+		{
+			record.push_back('s');
+			appendString(arg.getString());
+		}
+		else if (arg.isBlob())
+		{
+			record.push_back('b');
+			const MemoryBlock& blob = arg.getBlob();
+			appendUint32((uint32)blob.getSize());
+			appendData(blob.getData(), blob.getSize());
+		}
+		else { continue; } // type not used by EVERTims, not captured
+		numArgs++;
+	}
+	for (int i = 0; i < 4; i++) { record[numArgsPosition + i] = (uint8)(numArgs >> (8 * i)); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendBundle(const OSCBundle& bundle)
+{
+	appendUint64(bundle.getTimeTag().getRawTimeTag());
+	appendUint32((uint32)bundle.size());
+	for (int i = 0; i < bundle.size(); i++)
+	{
+		if (bundle[i].isMessage())
+		{
+			record.push_back('m');
+			appendMessage(bundle[i].getMessage());
+		}
+		else
+		{
+			record.push_back('#');
+			appendBundle(bundle[i].getBundle());
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendString(const String& string)
+{
+	const char* utf8 = string.toRawUTF8();
+	const size_t size = strlen(utf8);
+	appendUint32((uint32)size);
+	appendData(utf8, size);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendData(const void* data, const size_t size)
+{
+	const uint8* bytes = static_cast<const uint8*>(data);
+	record.insert(record.end(), bytes, bytes + size);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendUint32(const uint32 value)
+{
+	for (int i = 0; i < 4; i++) { record.push_back((uint8)(value >> (8 * i))); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCaptureWriter::appendUint64(const uint64 value)
+{
+	for (int i = 0; i < 8; i++) { record.push_back((uint8)(value >> (8 * i))); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OSCCapturePlayer::OSCCapturePlayer() :
+	Thread("OSC capture player")
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OSCCapturePlayer::~OSCCapturePlayer()
+{
+	stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::start(const File& captureFile, const double playbackSpeed, Target* replayTarget)
+// Replay captureFile to replayTarget, false if not a valid capture
+{
+	if (!open(captureFile, playbackSpeed)) { return false; }
+
+	target = replayTarget;
+	startThread();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::start(const File& captureFile, const double playbackSpeed, const int udpPort)
+// Replay captureFile to localhost:udpPort, false if not a valid capture or port not reachable
+{
+	if (!open(captureFile, playbackSpeed)) { return false; }
+	if (!sender.connect("127.0.0.1", udpPort))
+	{
+		stream = nullptr;
+		return false;
+	}
+
+	target = nullptr;
+	startThread();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCapturePlayer::stop()
+{
+	stopThread(2000);
+	sender.disconnect();
+	stream = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::open(const File& captureFile, const double playbackSpeed)
+{
+	stop();
+
+	stream.reset(new FileInputStream(captureFile));
+	char magic[8];
+	if (stream->failedToOpen() || stream->read(magic, 8) != 8 || memcmp(magic, OSCCaptureFormat::magic(), 8) != 0
+		|| stream->readInt() != (int)OSCCaptureFormat::version)
+	{
+		stream = nullptr;
+		return false;
+	}
+
+	speed = jmax(0.0, playbackSpeed);
+	numPacketsPlayed = 0;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCCapturePlayer::run()
+// Player thread: read records one at a time, each sent at its (scaled) capture time
+{
+	const double startTime = Time::getMillisecondCounterHiRes();
+
+	while (!threadShouldExit())
+	{
+		if (!readRecord()) { break; }
+
+		if (speed > 0.0)
+		{
+			const double sendTime = startTime + recordTime / speed;
+			for (double now = Time::getMillisecondCounterHiRes(); now < sendTime && !threadShouldExit(); now = Time::getMillisecondCounterHiRes())
+			{
+				wait(jmax(1, (int)(sendTime - now)));
+			}
+		}
+		else if (target != nullptr)
+		{
+			while (!target->isReadyForReplay() && !threadShouldExit()) { wait(1); }
+		}
+		if (threadShouldExit()) { break; }
+
+		const uint8* data = static_cast<const uint8*>(record.getData());
+		if (!playRecord(data + 8, data + recordSize)) { DBG("OSC capture: invalid record"); }
+		numPacketsPlayed++;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::openOffline(const File& captureFile, Target* replayTarget)
+// Offline replay of captureFile to replayTarget, packets played by playNext. False if not a
+// valid capture.
+{
+	if (!open(captureFile, 0.0)) { return false; }
+
+	target = replayTarget;
+	recordPending = false;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::playNext(const double maxTime)
+// Offline replay: play next packet if captured no later than maxTime (ms since capture start).
+// False otherwise, or once the capture is over.
+{
+	if (stream == nullptr || isThreadRunning()) { return false; }
+
+	if (!recordPending)
+	{
+		if (!readRecord())
+		{
+			stream = nullptr;
+			return false;
+		}
+		recordPending = true;
+	}
+	if (recordTime > maxTime) { return false; }
+
+	recordPending = false;
+	const uint8* data = static_cast<const uint8*>(record.getData());
+	if (!playRecord(data + 8, data + recordSize)) { DBG("OSC capture: invalid record"); }
+	numPacketsPlayed++;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readRecord()
+// Read next record (time then element), false at end of (truncated) file
+{
+	if (stream->isExhausted()) { return false; }
+	recordSize = (uint32)stream->readInt();
+	record.ensureSize(recordSize);
+	if (recordSize < 9 || stream->read(record.getData(), (int)recordSize) != (int)recordSize) { return false; }
+
+	const uint8* data = static_cast<const uint8*>(record.getData());
+	uint64 timeBits;
+	readUint64(data, data + 8, timeBits);
+	memcpy(&recordTime, &timeBits, sizeof(double));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::playRecord(const uint8* data, const uint8* end)
+// Decode one packet and send it to target
+{
+	try
+	{
+		const uint8 kind = *data++;
+		if (kind == 'm')
+		{
+			OSCMessage message("/");
+			if (!readMessage(data, end, message)) { return false; }
+			if (target != nullptr) { target->replayMessage(message); }
+			else { sender.send(message); }
+		}
+		else if (kind == '#')
+		{
+			OSCBundle bundle;
+			if (!readBundle(data, end, bundle)) { return false; }
+			if (target != nullptr) { target->replayBundle(bundle); }
+			else { sender.send(bundle); }
+		}
+		else { return false; }
+	}
+	catch (const OSCFormatError&) { return false; } // invalid address pattern
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readMessage(const uint8*& data, const uint8* end, OSCMessage& message)
+{
+	String address;
+	uint32 numArgs;
+	if (!readString(data, end, address) || !readUint32(data, end, numArgs)) { return false; }
+	message.setAddressPattern(OSCAddressPattern(address));
+	message.clear();
+
+	for (uint32 i = 0; i < numArgs; i++)
+	{
+		if (data >= end) { return false; }
+		const uint8 type = *data++;
+		uint32 value;
+		if (type == 'i' || type == 'f')
+		{
+			if (!readUint32(data, end, value)) { return false; }
+			if (type == 'i') { message.addInt32((int32)value); }
+			else
+			{
+				float floatValue;
+				memcpy(&floatValue, &value, sizeof(float));
+				message.addFloat32(floatValue);
+			}
+		}
+		else if (type == 's')
+		{
+			String string;
+			if (!readString(data, end, string)) { return false; }
+			message.addString(string);
+		}
+		else if (type == 'b')
+		{
+			const uint8* bytes;
+			if (!readUint32(data, end, value) || !readBytes(data, end, bytes, value)) { return false; }
+			message.addBlob(MemoryBlock(bytes, value));
+		}
+		else { return false; }
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readBundle(const uint8*& data, const uint8* end, OSCBundle& bundle)
+{
+	uint64 timeTag;
+	uint32 numElements;
+	if (!readUint64(data, end, timeTag) || !readUint32(data, end, numElements)) { return false; }
+	bundle = OSCBundle(OSCTimeTag(timeTag));
+
+	for (uint32 i = 0; i < numElements; i++)
+	{
+		if (data >= end) { return false; }
+		const uint8 kind = *data++;
+		if (kind == 'm')
+		{
+			OSCMessage message("/");
+			if (!readMessage(data, end, message)) { return false; }
+			bundle.addElement(message);
+		}
+		else if (kind == '#')
+		{
+			OSCBundle nested;
+			if (!readBundle(data, end, nested)) { return false; }
+			bundle.addElement(nested);
+		}
+		else { return false; }
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readString(const uint8*& data, const uint8* end, String& string)
+{
+	uint32 size;
+	const uint8* bytes;
+	if (!readUint32(data, end, size) || !readBytes(data, end, bytes, size)) { return false; }
+	string = String::fromUTF8(reinterpret_cast<const char*>(bytes), (int)size);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readBytes(const uint8*& data, const uint8* end, const uint8*& bytes, const size_t size)
+{
+	if ((size_t)(end - data) < size) { return false; }
+	bytes = data;
+	data += size;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readUint32(const uint8*& data, const uint8* end, uint32& value)
+{
+	if (end - data < 4) { return false; }
+	value = ByteOrder::littleEndianInt(data);
+	data += 4;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCCapturePlayer::readUint64(const uint8*& data, const uint8* end, uint64& value)
+{
+	if (end - data < 8) { return false; }
+	value = ByteOrder::littleEndianInt64(data);
+	data += 8;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3,129 +3,387 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-OSCHandler::OSCHandler()
+OSCHandler::OSCHandler(const bool realtime) :
+	Thread("OSC scene update"),
+	isRealtime(realtime)
 {
-	// if failed to connect
-	if (!connect(port))
-	{
-		showConnectionErrorMessage("Error: (OSC) could not connect to localhost@" + String(port) + ".");
-	}
-
-	addListener(this);
 	current->valuesR60.resize(NUM_OCTAVE_BANDS, 0.f);
 	future->valuesR60.resize(NUM_OCTAVE_BANDS, 0.f);
+
+	// offline: neither receiver nor scene thread, scene advanced by owner (see updateScene)
+	if (!isRealtime) { return; }
+
+	connectReceiver();
+
+	addListener(this);
+	startThread();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<int> OSCHandler::getSourceImageIDs()
+OSCHandler::~OSCHandler()
 {
-	std::vector<int> IDs;
-	IDs.resize(current->sourceImageMap.size());
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		IDs[i] = ent1.first;
-		i++;
-	}
-	return IDs;
+	// stop producers (receiver thread, replay, generator) then consumer (scene thread) before queue is destroyed
+	capturePlayer.stop();
+	sceneGenerator.stop();
+	removeListener(this);
+	disconnect();
+	captureWriter.stop();
+	stopThread(1000);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> OSCHandler::getSourceImageDelays()
+bool OSCHandler::startReplay(const File& captureFile, const double speed, const bool inProcess)
+// Replay capture (see OSCCapturePlayer for speed), either in process (OSC receiver disconnected
+// until stopReplay) or as UDP packets sent to our own port. False if not a valid capture.
 {
-	std::vector<float> delays;
-	delays.resize(current->sourceImageMap.size());
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		delays[i] = ent1.second.totalPathDistance / SOUND_SPEED;
-		i++;
-	}
-	return delays;
+	stopReplay();
+	stopGenerator();
+	if (!inProcess) { return capturePlayer.start(captureFile, speed, port); }
+
+	// single producer of scene deltas: replay takes the place of the receiver thread
+	disconnect();
+	receiverReplaced = true;
+	if (capturePlayer.start(captureFile, speed, this)) { return true; }
+
+	stopReplay();
+	return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> OSCHandler::getSourceImagePathsLength()
+void OSCHandler::stopReplay()
 {
-	std::vector<float> pathLength;
-	pathLength.resize(current->sourceImageMap.size());
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		pathLength[i] = ent1.second.totalPathDistance;
-		i++;
-	}
-	return pathLength;
+	capturePlayer.stop();
+	restoreReceiver();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::startGenerator(const SceneGenerator::Settings& settings, const bool inProcess)
+// Synthetic scene (see SceneGenerator), either in process (OSC receiver disconnected until
+// stopGenerator) or as UDP packets sent to our own port
+{
+	stopReplay();
+	stopGenerator();
+	if (!inProcess) { return sceneGenerator.start(settings, port); }
+
+	// single producer of scene deltas: generator takes the place of the receiver thread
+	disconnect();
+	receiverReplaced = true;
+	return sceneGenerator.start(settings, this);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<Eigen::Vector3f> OSCHandler::getSourceImageDOAs()
+void OSCHandler::stopGenerator()
+{
+	sceneGenerator.stop();
+	restoreReceiver();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::restoreReceiver()
+// Reconnect OSC receiver once in process replay / generator stopped
+{
+	if (!receiverReplaced || !isRealtime) { return; }
+
+	receiverReplaced = false;
+	connectReceiver();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Span<SourceImageStore::Key> OSCHandler::getSourceImageKeys()
+{
+	return current->sourceImages.getKeys();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Span<float> OSCHandler::getSourceImageDelays()
+{
+	return current->sourceImages.getDelays();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Span<float> OSCHandler::getSourceImagePathsLength()
+{
+	return current->sourceImages.getPathLengths();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Span<int> OSCHandler::getSourceImageReflectionOrders()
+{
+	return current->sourceImages.getReflectionOrders();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int OSCHandler::getSourceImageReflectionOrder(const SourceImageStore::Key sourceID)
+{
+	const int slot = current->sourceImages.findSlot(sourceID);
+	if (slot < 0) { return 0; }
+	return current->sourceImages.getReflectionOrders()[slot];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::getSourceImageDOAs(std::vector<Eigen::Vector3f>& doas, const int listenerIndex)
 // Get Direction Of Arrivals (relative to listener orientation)
 {
-	std::vector<Eigen::Vector3f> doas;
-	doas.resize(current->sourceImageMap.size());
+	const SourceImageStore& sourceImages = current->sourceImages;
+	doas.assign(sourceImages.getNumImages(), Eigen::Vector3f::Zero());
 
 	// discard if empty listener map
-	if (current->listenerMap.size() == 0) { return doas; }
+	if (current->listeners.size() == 0) { return; }
+
+	Eigen::Matrix3f listenerRotationMatrix = getListener(listenerIndex).rotationMatrix;
+	for (int i = 0; i < sourceImages.getNumImages(); i++)
+	{
+		doas[i] = cartesianToSpherical(listenerRotationMatrix * getSourceImageRelativePosition(i, listenerIndex));
+	}
+}
 
-	Eigen::Vector3f listenerPos = current->listenerMap.begin()->second.position;
-	Eigen::Matrix3f listenerRotationMatrix = current->listenerMap.begin()->second.rotationMatrix;
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		Eigen::Vector3f posSph = cartesianToSpherical(listenerRotationMatrix * (ent1.second.positionRelectionLast - listenerPos));
-		doas[i] = posSph;
-		i++;
+void OSCHandler::getSourceImageWorldDOAs(std::vector<Eigen::Vector3f>& doas, const int listenerIndex)
+// Get Direction Of Arrivals (relative to listener position, world orientation)
+{
+	const SourceImageStore& sourceImages = current->sourceImages;
+	doas.assign(sourceImages.getNumImages(), Eigen::Vector3f::Zero());
+
+	// discard if empty listener map
+	if (current->listeners.size() == 0) { return; }
+
+	for (int i = 0; i < sourceImages.getNumImages(); i++)
+	{
+		doas[i] = cartesianToSpherical(getSourceImageRelativePosition(i, listenerIndex));
 	}
-	return doas;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<Eigen::Vector3f> OSCHandler::getSourceImageDODs()
-// Get Direction Of Departure (relative to source orientation
+Eigen::Vector3f OSCHandler::getSourceImageDOA(const SourceImageStore::Key sourceID, const bool worldFrame, const int listenerIndex)
+// Get Direction Of Arrival of a single source image (relative to listener orientation, or world
+// orientation if worldFrame)
 {
-	std::vector<Eigen::Vector3f> dods;
-	dods.resize(current->sourceImageMap.size());
+	const int slot = current->sourceImages.findSlot(sourceID);
+	if (current->listeners.size() == 0 || slot < 0) { return Eigen::Vector3f::Zero(); }
 
-	// discard if empty source map
-	if (current->sourceMap.size() == 0) { return dods; }
+	Eigen::Vector3f relativePos = getSourceImageRelativePosition(slot, listenerIndex);
+	if (worldFrame) { return cartesianToSpherical(relativePos); }
+	return cartesianToSpherical(getListener(listenerIndex).rotationMatrix * relativePos);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::getSourceImagePathLengths(std::vector<float>& pathLengths, const int listenerIndex)
+// Path lengths of all source images as seen by a listener (the traced ones for the first listener)
+{
+	Span<float> tracedPathLengths = current->sourceImages.getPathLengths();
+	pathLengths.assign(tracedPathLengths.begin(), tracedPathLengths.end());
+	if (listenerIndex <= 0 || listenerIndex >= current->listeners.size()) { return; }
 
-	Eigen::Vector3f sourcePos = current->sourceMap.begin()->second.position;
-	Eigen::Matrix3f sourceRotationMatrix = current->sourceMap.begin()->second.rotationMatrix;
+	for (int i = 0; i < (int)pathLengths.size(); i++)
+	{
+		pathLengths[i] = getSourceImageRelativePosition(i, listenerIndex).norm();
+	}
+}
 
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		Eigen::Vector3f posSph = cartesianToSpherical(sourceRotationMatrix * (ent1.second.positionRelectionFirst - sourcePos));
-		dods[i] = posSph;
-		i++;
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Eigen::Vector3f OSCHandler::getSourceImageRelativePosition(const int slot, const int listenerIndex)
+// Position source image at slot arrives from, relative to listener: last reflection point for the
+// first listener (the one images are traced for), image source position for the others. Scene
+// must hold at least one listener.
+{
+	const EL_Listener& firstListener = current->listeners[0];
+	Eigen::Map<const Eigen::Vector3f> positionLast(current->sourceImages.getPositionsLast().data() + 3 * slot);
+	Eigen::Vector3f lastSegment = positionLast - firstListener.position;
+	if (listenerIndex <= 0 || listenerIndex >= current->listeners.size()) { return lastSegment; }
+
+	// image source: along the last segment, at path length from first listener
+	Eigen::Vector3f imageSourcePosition = firstListener.position;
+	const float lastSegmentLength = lastSegment.norm();
+	if (lastSegmentLength > 1e-6f)
+	{
+		imageSourcePosition += lastSegment * (current->sourceImages.getPathLengths()[slot] / lastSegmentLength);
 	}
-	return dods;
+	return imageSourcePosition - current->listeners[listenerIndex].position;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const EL_Listener& OSCHandler::getListener(const int listenerIndex) const
+// Listener at index, first one if out of range. Scene must hold at least one listener.
+{
+	if (listenerIndex < 0 || listenerIndex >= current->listeners.size()) { return current->listeners[0]; }
+	return current->listeners[listenerIndex];
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-Array<float> OSCHandler::getSourceImageAbsorption(const unsigned int sourceID)
+Eigen::Vector3f OSCHandler::getSourceImageDOD(const SourceImageStore::Key sourceID, const bool worldFrame)
+// Get Direction Of Departure of a single source image (relative to source orientation, or in world
+// frame, source orientation then applied by the directivity, see getSourceRotationMatrix)
 {
-	return current->sourceImageMap.find(sourceID)->second.absorption;
+	const int slot = current->sourceImages.findSlot(sourceID);
+	const EL_Source* source = getSourceImageSource(slot);
+	if (source == nullptr) { return Eigen::Vector3f::Zero(); }
+
+	Eigen::Map<const Eigen::Vector3f> positionFirst(current->sourceImages.getPositionsFirst().data() + 3 * slot);
+	Eigen::Vector3f relativePos = positionFirst - source->position;
+	if (worldFrame) { return cartesianToSpherical(relativePos); }
+	return cartesianToSpherical(source->rotationMatrix * relativePos);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<float> OSCHandler::getRT60Values()
+int OSCHandler::getSourceImageSourceIndex(const SourceImageStore::Key sourceID)
+// Index (in sources sorted by name) of the source a source image originates from, first source
+// if unknown (image not found, or its source not received yet)
+{
+	const EL_Source* source = getSourceImageSource(current->sourceImages.findSlot(sourceID));
+	if (source == nullptr) { return 0; }
+	return (int)(source - current->sources.data());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const EL_Source* OSCHandler::getSourceImageSource(const int slot)
+// Source of image at slot in current scene, nullptr if no source at all
+{
+	if (current->sources.size() == 0 || slot < 0) { return nullptr; }
+
+	const int sourceKey = current->sourceImages.getSourceKeys()[slot];
+	if (sourceKey == 0) { return &current->sources[0]; }
+
+	const String& name = sourceKeyNames[sourceKey - 1];
+	auto source = findByName(current->sources, name);
+	if (source == current->sources.end() || source->name != name) { return &current->sources[0]; }
+	return &*source;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Eigen::Matrix3f OSCHandler::getListenerRotationMatrix(const int listenerIndex)
+{
+	if (current->listeners.size() == 0) { return Eigen::Matrix3f::Identity(); }
+	return getListener(listenerIndex).rotationMatrix;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Eigen::Matrix3f OSCHandler::getSourceRotationMatrix(const int sourceIndex)
+// Rotation of source sourceIndex (in sources sorted by name), world to source frame
+{
+	if (sourceIndex < 0 || sourceIndex >= current->sources.size()) { return Eigen::Matrix3f::Identity(); }
+	return current->sources[sourceIndex].rotationMatrix;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::hasSceneChanged()
+// True unless last update only changed listener orientation
+{
+	return current->sceneChanged;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::isSourceImageChanged(const SourceImageStore::Key sourceID)
+// True if source image added, updated or removed during last update
+{
+	return current->sourceImages.isChanged(sourceID);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::hasSourceChanged()
+{
+	return current->sourceChanged;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::hasListenerMoved()
+{
+	return current->listenerMoved;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::hasListenerRotated()
+{
+	return current->listenerRotated;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::hasRT60Changed()
+{
+	return current->rt60Changed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::isFullUpdateRequired()
+// True if last update was requested through requestUpdate (everything is to be recomputed)
+{
+	return current->fullUpdateRequired;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::getSourceImageDODs(std::vector<Eigen::Vector3f>& dods)
+// Get Direction Of Departure (relative to source orientation)
+{
+	const SourceImageStore& sourceImages = current->sourceImages;
+	dods.assign(sourceImages.getNumImages(), Eigen::Vector3f::Zero());
+
+	// discard if empty source map
+	if (current->sources.size() == 0) { return; }
+
+	// relative to the source each image originates from
+	const float* positionsFirst = sourceImages.getPositionsFirst().data();
+	for (int i = 0; i < sourceImages.getNumImages(); i++)
+	{
+		const EL_Source* source = getSourceImageSource(i);
+		Eigen::Map<const Eigen::Vector3f> positionFirst(positionsFirst + 3 * i);
+		dods[i] = cartesianToSpherical(source->rotationMatrix * (positionFirst - source->position));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Span<float> OSCHandler::getSourceImageAbsorption(const SourceImageStore::Key sourceID)
+// NUM_OCTAVE_BANDS absorption coefficients (empty if not found)
+{
+	const int slot = current->sourceImages.findSlot(sourceID);
+	if (slot < 0) { return Span<float>(); }
+	return Span<float>(current->sourceImages.getAbsorptions().data() + NUM_OCTAVE_BANDS * slot, NUM_OCTAVE_BANDS);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<float>& OSCHandler::getRT60Values()
 {
 	return current->valuesR60;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-int OSCHandler::getDirectPathId()
+SourceImageStore::Key OSCHandler::getDirectPathKey()
 {
-	for (auto const& ent1 : current->sourceImageMap) {
-		if (ent1.second.reflectionOrder == 0) {
-			return ent1.first;
-		}
+	Span<int> reflectionOrders = current->sourceImages.getReflectionOrders();
+	for (int i = 0; i < reflectionOrders.size(); i++)
+	{
+		if (reflectionOrders[i] == 0) { return current->sourceImages.getKeys()[i]; }
 	}
 	return -1;
 }
@@ -135,24 +393,23 @@ int OSCHandler::getDirectPathId()
 String OSCHandler::getMapContentForGUI()
 // Return string with full content of local attributes for GUI log window
 {
+	const ScopedLock lock(sceneLock);
 	String output = String("\n");
 	int nDecimals = 2;
 
-	for (auto const& ent1 : current->listenerMap) {
-		// ent1.first is the first key
-		output += String("Listener: \t") + String(ent1.first) + String(", pos: \t[ ") +
-			String(round2(ent1.second.position(0), nDecimals)) + String(", ") +
-			String(round2(ent1.second.position(1), nDecimals)) + String(", ") +
-			String(round2(ent1.second.position(2), nDecimals)) + String(" ]\n");
+	for (auto const& listener : current->listeners) {
+		output += String("Listener: \t") + listener.name + String(", pos: \t[ ") +
+			String(round2(listener.position(0), nDecimals)) + String(", ") +
+			String(round2(listener.position(1), nDecimals)) + String(", ") +
+			String(round2(listener.position(2), nDecimals)) + String(" ]\n");
 	}
 	output += String("\n");
 
-	for (auto const& ent1 : current->sourceMap) {
-		// ent1.first is the first key
-		output += String("Source:  \t") + String(ent1.first) + String(", pos: \t [ ") +
-			String(round2(ent1.second.position(0), nDecimals)) + String(", ") +
-			String(round2(ent1.second.position(1), nDecimals)) + String(", ") +
-			String(round2(ent1.second.position(2), nDecimals)) + String(" ]\n");
+	for (auto const& source : current->sources) {
+		output += String("Source:  \t") + source.name + String(", pos: \t [ ") +
+			String(round2(source.position(0), nDecimals)) + String(", ") +
+			String(round2(source.position(1), nDecimals)) + String(", ") +
+			String(round2(source.position(2), nDecimals)) + String(" ]\n");
 	}
 	output += String("\n");
 
@@ -165,22 +422,22 @@ String OSCHandler::getMapContentForGUI()
 	output += String("\n");
 
 	// discard if empty listener map
-	if (current->listenerMap.size() == 0) { return output; }
-	Eigen::Vector3f listenerPos = current->listenerMap.begin()->second.position;
-	std::vector<Eigen::Vector3f> posSph = getSourceImageDOAs();
-	int i = 0;
-	for (auto const& ent1 : current->sourceImageMap) {
-		output += String("Source Image: ") + String(ent1.first) + String(", \t posLast:  [ ") +
-			String(round2(ent1.second.positionRelectionLast(0), nDecimals)) + String(", ") +
-			String(round2(ent1.second.positionRelectionLast(1), nDecimals)) + String(", ") +
-			String(round2(ent1.second.positionRelectionLast(2), nDecimals)) + String(" ]");
+	if (current->listeners.size() == 0) { return output; }
+	std::vector<Eigen::Vector3f> posSph;
+	getSourceImageDOAs(posSph);
+	const SourceImageStore& sourceImages = current->sourceImages;
+	for (int i = 0; i < sourceImages.getNumImages(); i++) {
+		const float* positionLast = sourceImages.getPositionsLast().data() + 3 * i;
+		output += String("Source Image: ") + String(sourceImages.getIds()[i]) + String(", \t posLast:  [ ") +
+			String(round2(positionLast[0], nDecimals)) + String(", ") +
+			String(round2(positionLast[1], nDecimals)) + String(", ") +
+			String(round2(positionLast[2], nDecimals)) + String(" ]");
 
 		output += String(", \t DOA: [ ") +
 			String(round2(rad2deg(posSph[i](0)), nDecimals)) + String(", ") +
 			String(round2(rad2deg(posSph[i](1)), nDecimals)) + String(" ]");
-		i++;
 
-		output += String(", \t path length: ") + String(round(ent1.second.totalPathDistance * 100) / 100) + String("m\n");
+		output += String(", \t path length: ") + String(round(sourceImages.getPathLengths()[i] * 100) / 100) + String("m\n");
 	}
 
 	return output;
@@ -191,38 +448,37 @@ String OSCHandler::getMapContentForGUI()
 String OSCHandler::getMapContentForLog()
 // Return string with full content of local attributes for export to desktop
 {
+	const ScopedLock lock(sceneLock);
 	// init
 	String output = String("");
 
 	// listener(s)
-	for (auto const& ent1 : current->listenerMap) {
-		// ent1.first is the first key
-		output += String("listener: ") + String(ent1.first);
+	for (auto const& listener : current->listeners) {
+		output += String("listener: ") + listener.name;
 		output += String(" pos: ");
 		for (int i = 0; i < 3; i++) {
-			output += String(ent1.second.position(i)) + String(" ");
+			output += String(listener.position(i)) + String(" ");
 		}
 		output += String("rot: ");
 		for (int i = 0; i < 3; i++) {
 			for (int j = 0; j < 3; j++) {
-				output += String(ent1.second.rotationMatrix(i, j)) + String(" ");
+				output += String(listener.rotationMatrix(i, j)) + String(" ");
 			}
 		}
 		output += String("\n");
 	}
 
 	// source(s)
-	for (auto const& ent1 : current->sourceMap) {
-		// ent1.first is the first key
-		output += String("source: ") + String(ent1.first);
+	for (auto const& source : current->sources) {
+		output += String("source: ") + source.name;
 		output += String(" pos: ");
 		for (int i = 0; i < 3; i++) {
-			output += String(ent1.second.position(i)) + String(" ");
+			output += String(source.position(i)) + String(" ");
 		}
 		output += String("rot: ");
 		for (int i = 0; i < 3; i++) {
 			for (int j = 0; j < 3; j++) {
-				output += String(ent1.second.rotationMatrix(i, j)) + String(" ");
+				output += String(source.rotationMatrix(i, j)) + String(" ");
 			}
 		}
 		output += String("\n");
@@ -235,26 +491,32 @@ String OSCHandler::getMapContentForLog()
 	}
 	output += String("\n");
 
+	// lost scene updates (see pushDelta)
+	if (numDroppedDeltas > 0) { output += String("droppedDeltas: ") + String(numDroppedDeltas.load()) + String("\n"); }
+
 	// image source(s)
 	// discard if empty listener map
-	if (current->listenerMap.size() == 0) { return output; }
-	for (auto const& ent1 : current->sourceImageMap) {
-		output += String("imgSrc: ") + String(ent1.first);
-		output += String(" order: ") + String(ent1.second.reflectionOrder);
+	if (current->listeners.size() == 0) { return output; }
+	const SourceImageStore& sourceImages = current->sourceImages;
+	for (int k = 0; k < sourceImages.getNumImages(); k++) {
+		output += String("imgSrc: ") + String(sourceImages.getIds()[k]);
+		output += String(" order: ") + String(sourceImages.getReflectionOrders()[k]);
 		output += String(" posFirst: ");
 		for (int i = 0; i < 3; i++) {
-			output += String(ent1.second.positionRelectionFirst(i)) + String(" ");
+			output += String(sourceImages.getPositionsFirst()[3 * k + i]) + String(" ");
 		}
 		output += String("posLast: ");
 		for (int i = 0; i < 3; i++) {
-			output += String(ent1.second.positionRelectionLast(i)) + String(" ");
+			output += String(sourceImages.getPositionsLast()[3 * k + i]) + String(" ");
 		}
-		output += String("pathLength: ") + String(ent1.second.totalPathDistance);
+		output += String("pathLength: ") + String(sourceImages.getPathLengths()[k]);
 		output += String(" abs: ");
-		for (int i = 0; i < 10; i++)
+		for (int i = 0; i < NUM_OCTAVE_BANDS; i++)
 		{
-			output += String(ent1.second.absorption[i]) + String(" ");
+			output += String(sourceImages.getAbsorptions()[NUM_OCTAVE_BANDS * k + i]) + String(" ");
 		}
+		const int sourceKey = sourceImages.getSourceKeys()[k];
+		if (sourceKey > 0) { output += String("src: ") + sourceKeyNames[sourceKey - 1]; }
 		output += String("\n");
 	}
 
@@ -263,17 +525,51 @@ String OSCHandler::getMapContentForLog()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool OSCHandler::loadState(const File& stateFile, int& errorLine)
+// Message thread: parse saved state, then have the scene thread replace the whole scene with it
+// (single commit). False if file can't be read or is invalid (errorLine: first invalid line).
+{
+	OSCStateFile& state = stateFiles.getWriteBuffer();
+	if (!state.load(stateFile))
+	{
+		errorLine = state.getErrorLine();
+		return false;
+	}
+
+	stateFiles.publish();
+	stateLoadRequested = true;
+	notify();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 void OSCHandler::clear(const bool force)
-// Reset all internals
+// Reset all internals (applied by scene thread)
+{
+	if (force) { clearForced = true; }
+	clearRequested = true;
+	notify();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::applyClear(const bool force)
+// Scene thread: reset future scene
 {
-	future->sourceImageMap.clear();
+	future->sourceImages.clear();
 	future->valuesR60.clear();
 	future->valuesR60.resize(NUM_OCTAVE_BANDS, 0.f);
+	future->rt60Changed = true;
+	future->sceneChanged = true;
 
 	if (force)
 	{
-		future->sourceMap.clear();
-		future->listenerMap.clear();
+		future->sources.clear();
+		future->listeners.clear();
+		future->sourceChanged = true;
+		future->listenerMoved = true;
+		future->listenerRotated = true;
 	}
 }
 
@@ -283,149 +579,571 @@ void OSCHandler::updateInternals()
 // Swap future with current state
 {
 	std::swap(current, future);
-	// udpate new future (old current) to make sure next swap won't give me deprecated values
-	future->sourceImageMap = current->sourceImageMap;
-	future->sourceMap = current->sourceMap;
-	future->listenerMap = current->listenerMap;
-	future->valuesR60 = current->valuesR60;
+	current->sourceImages.buildIndex();
+
+	// udpate new future (old current) to make sure next swap won't give me deprecated values: only
+	// what changed during last update is copied
+	future->sourceImages.syncFrom(current->sourceImages);
+	if (current->sourceChanged) { future->sources = current->sources; }
+	if (current->listenerMoved || current->listenerRotated) { future->listeners = current->listeners; }
+	if (current->rt60Changed) { future->valuesR60 = current->valuesR60; }
+	future->sceneChanged = false;
+	future->sourceChanged = false;
+	future->listenerMoved = false;
+	future->listenerRotated = false;
+	future->rt60Changed = false;
+	future->fullUpdateRequired = false;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void OSCHandler::oscMessageReceived(const OSCMessage& msg)
+void OSCHandler::carryOverChanges()
+// Scene thread: update not consumed by listener, report its changes again at next attempt
 {
-	OSCAddressPattern pIn("/in");
-	OSCAddressPattern pUpd("/upd");
-	OSCAddressPattern pR60("/rt60");
+	future->sceneChanged = future->sceneChanged || current->sceneChanged;
+	for (SourceImageStore::Key key : current->sourceImages.getChangedKeys()) { future->sourceImages.markChanged(key); }
+	future->sourceChanged = future->sourceChanged || current->sourceChanged;
+	future->listenerMoved = future->listenerMoved || current->listenerMoved;
+	future->listenerRotated = future->listenerRotated || current->listenerRotated;
+	future->rt60Changed = future->rt60Changed || current->rt60Changed;
+	future->fullUpdateRequired = future->fullUpdateRequired || current->fullUpdateRequired;
+}
 
-	OSCAddress msgAdress(msg.getAddressPattern().toString());
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::setSceneListener(SceneListener* newListener)
+{
+	const ScopedLock lock(sceneLock);
+	sceneListener = newListener;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::requestUpdate(const bool wakeUp)
+// Have sceneListener re-read the full scene (e.g. rendering parameters changed). Set wakeUp to
+// false from the audio thread: the update is then picked up at the next scene thread poll.
+{
+	updateRequested = true;
+	if (wakeUp) { notify(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::run()
+// Scene thread: apply queued deltas to future scene, then hand it over to sceneListener (see
+// updateScene)
+{
+	while (!threadShouldExit())
+	{
+		// no wait if deltas left in queue (see frame end in processDeltas)
+		if (deltaQueue.getNumReady() == 0) { wait(updatePending ? coalesceInterval : idleInterval); }
+
+		processDeltas(Time::getMillisecondCounter());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::updateScene(const uint32 timeInMs)
+// Offline mode (no scene thread): replay capture packets up to timeInMs (capture time, see
+// startOfflineReplay), doing what the scene thread would meanwhile (polls every coalesceInterval,
+// so that frames end with bursts of messages as they would in real time). Called with non
+// decreasing times, e.g. once per audio block with audio time.
+{
+	do
+	{
+		offlineTime = jmin(offlineTime + (uint32)coalesceInterval, timeInMs);
+		while (capturePlayer.playNext((double)offlineTime))
+		{
+			// keep queue from overflowing on large frames (e.g. one message per source image)
+			if (!isReadyForReplay()) { processDeltas(offlineTime); }
+		}
+		processDeltas(offlineTime);
+	}
+	while (offlineTime < timeInMs);
+}
 
-	if ((pIn.matches(msgAdress) || pUpd.matches(msgAdress)) && msg.size() == 19) {
-		// format: [ /in pathID order r1x r1y r1z rNx rNy rNz dist abs1 .. abs9 ]
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-		EL_ImageSource source;
-		source.ID = msg[0].getInt32();
-		source.reflectionOrder = msg[1].getInt32();
+void OSCHandler::receiveMessage(const OSCMessage& msg)
+// Offline mode: message fed by owner in place of the receiver (e.g. host sequenced scene
+// updates), applied at next updateScene
+{
+	jassert(!isRealtime);
+	oscMessageReceived(msg);
+	if (!isReadyForReplay()) { processDeltas(offlineTime); }
+}
 
-		source.positionRelectionFirst(0) = msg[2].getFloat32();
-		source.positionRelectionFirst(1) = msg[3].getFloat32();
-		source.positionRelectionFirst(2) = msg[4].getFloat32();
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-		source.positionRelectionLast(0) = msg[5].getFloat32();
-		source.positionRelectionLast(1) = msg[6].getFloat32();
-		source.positionRelectionLast(2) = msg[7].getFloat32();
+void OSCHandler::receiveBundle(const OSCBundle& bundle)
+// Offline mode: bundle fed by owner in place of the receiver (see receiveMessage)
+{
+	jassert(!isRealtime);
+	oscBundleReceived(bundle);
+	if (!isReadyForReplay()) { processDeltas(offlineTime); }
+}
 
-		source.totalPathDistance = msg[8].getFloat32();
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-		for (int i = 0; i < 10; i++)
+void OSCHandler::processDeltas(const uint32 now)
+// Scene thread pass at time now (ms): apply queued deltas to future scene, then hand it over to
+// sceneListener (whole frames only, at most once per minCommitInterval)
+{
+	const ScopedLock lock(sceneLock);
+	const bool commitAllowed = (int)(now - lastCommitTime) >= minCommitInterval.load();
+
+	// apply queued deltas: stop at the end of the first frame if it can be committed right
+	// away, otherwise coalesce the following frames. Lone messages (e.g. raytracer) and bundles
+	// (e.g. head tracker) are two streams, each with its own frames.
+	SceneDelta delta;
+	bool received = false;
+	while (deltaQueue.pop(delta))
+	{
+		received = true;
+		if (delta.type == SceneDelta::frameEnd || delta.type == SceneDelta::imageFrame)
 		{
-			source.absorption.insert(i, msg[9 + i].getFloat32());
+			// binary frame: apply the latest one received (those published meanwhile are skipped)
+			if (delta.type == SceneDelta::imageFrame && imageFrames.acquire())
+			{
+				if (applyImageFrame(imageFrames.getReadBuffer())) { updatePending = true; }
+				resyncRequested = false; // whole image set replaced
+			}
+
+			if (delta.type == SceneDelta::imageFrame || delta.id != 0)
+			{
+				explicitFrames = true;
+				messageFrameOpen = false;
+			}
+			else { bundleFrameOpen = false; }
+
+			if (!messageFrameOpen && !bundleFrameOpen && commitAllowed) { break; }
+			continue;
 		}
 
-		// insert or update
-		future->sourceImageMap[source.ID] = source;
+		if (!messageFrameOpen && !bundleFrameOpen) { frameStartTime = now; }
+
+		// deltas dropped: images rebuilt from next raytracer frame on, full update downstream
+		if (!delta.inBundle && !messageFrameOpen && resyncRequested.exchange(false))
+		{
+			applyClear(false);
+			future->fullUpdateRequired = true;
+		}
+		if (delta.inBundle) { bundleFrameOpen = true; }
+		else { messageFrameOpen = true; }
+		applyDelta(delta);
+		updatePending = true;
 	}
 
-	else if (pR60.matches(msgAdress))
+	// end of burst taken as frame boundary (bundles split over several datagrams, or lone
+	// messages if client sends no end of frame message). Frame left open for too long (e.g.
+	// lost end of frame message) is committed anyway
+	if (!received)
+	{
+		bundleFrameOpen = false;
+		if (!explicitFrames) { messageFrameOpen = false; }
+	}
+	if ((int)(now - frameStartTime) >= maxFrameDuration)
 	{
-		for (int i = 0; i < msg.size(); i++) { future->valuesR60[i] = msg[i].getFloat32(); }
+		messageFrameOpen = false;
+		bundleFrameOpen = false;
 	}
 
-	//    else {
-	//        DBG(String("unhandled osc msg: ") + msg.getAddressPattern().toString() + String(" size: ") + String(msg.size()));
-	//
-	//        for (int i = 1; i < msg.size(); i++) {
-	//            if (msg[i].isInt32()) DBG(String(i) + String(" Int32") );
-	//            if (msg[i].isFloat32()) DBG(String(i) + String(" Float32") );
-	//            if (msg[i].isString()) DBG(String(i) + String(" String") );
-	//            if (msg[i].isBlob()) DBG(String(i) + String(" Blob") );
-	//        }
-	//    }
+	// loaded state replaces the whole scene: frame of its own
+	if (stateLoadRequested.exchange(false) && stateFiles.acquire())
+	{
+		applyState(stateFiles.getReadBuffer());
+		messageFrameOpen = false;
+		bundleFrameOpen = false;
+		updatePending = true;
+	}
+	const bool atFrameBoundary = !messageFrameOpen && !bundleFrameOpen;
 
-	sendChangeMessage();
+	if (clearRequested.exchange(false))
+	{
+		applyClear(clearForced.exchange(false));
+		updatePending = true;
+	}
+	if (updateRequested.exchange(false))
+	{
+		future->sceneChanged = true;
+		future->fullUpdateRequired = true;
+		updatePending = true;
+	}
+
+	if (!updatePending || sceneListener == nullptr) { return; }
+
+	// listener rotation only: neither frame nor rate limited
+	if (future->sceneChanged && (!atFrameBoundary || !commitAllowed)) { return; }
+
+	updateInternals();
+	if (sceneListener->oscSceneUpdated(*this))
+	{
+		updatePending = false;
+		if (current->sceneChanged) { lastCommitTime = now; }
+		sendChangeMessage(); // GUI log
+	}
+	// not consumed: keep track of scene changes for next attempt
+	else { carryOverChanges(); }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void OSCHandler::oscBundleReceived(const OSCBundle& bundle)
-// Process received OSC bundle
+void OSCHandler::pushDelta(const SceneDelta& delta)
+// Receiver thread: hand delta over to scene thread
 {
-	OSCAddressPattern pSource("/source");
-	OSCAddressPattern pListener("/listener");
-	OSCAddressPattern pOut("/out");
+	// queue full (scene thread stalled): delta lost, scene out of sync with client until resync
+	if (!deltaQueue.push(delta))
+	{
+		numDroppedDeltas++;
+		resyncRequested = true;
+	}
+}
 
-	//    DBG(bundle.size());
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	for (int i = 0; i < bundle.size(); i++)
-	{
-		OSCMessage msg = bundle[i].getMessage();
-		OSCAddress msgAdress(msg.getAddressPattern().toString());
-		// DBG("osc msg (bundle " + String(i) + String("):") + msgAdress.toString() + String(" size: ") + String(msg.size()));
+void OSCHandler::pushFrameEnd(const bool isExplicit)
+// Receiver thread: mark frame boundary
+{
+	SceneDelta delta;
+	delta.type = SceneDelta::frameEnd;
+	delta.id = isExplicit ? 1 : 0;
+	delta.inBundle = !isExplicit;
+	pushDelta(delta);
+}
 
-		//        for (int i = 0; i < msg.size(); i++) {
-		//            if (msg[i].isInt32()) DBG(String(i) + String(" Int32") );
-		//            if (msg[i].isFloat32()) DBG(String(i) + String(" Float32") );
-		//            if (msg[i].isString()) DBG(String(i) + String(" String") );
-		//            if (msg[i].isBlob()) DBG(String(i) + String(" Blob") );
-		//        }
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-		if (pSource.matches(msgAdress))
+void OSCHandler::applyDelta(const SceneDelta& delta)
+// Scene thread: insert / update / remove future scene element
+{
+	switch (delta.type)
+	{
+		case SceneDelta::imageUpdate:
 		{
-			EL_Source source;
-			source.name = msg[0].getString();
-			source.position(0) = msg[1].getFloat32();
-			source.position(1) = msg[2].getFloat32();
-			source.position(2) = msg[3].getFloat32();
-
+			// insert or update (values: r1 xyz, rN xyz, dist, abs1 .. abs10)
+			future->sourceImages.set(delta.id, delta.reflectionOrder, delta.values, delta.values + 3, delta.values[6], delta.values + 7, getSourceKey(delta.name));
+			future->sceneChanged = true;
+			break;
+		}
+		case SceneDelta::imageRemove:
+		{
+			future->sourceImages.remove(SourceImageStore::makeKey(getSourceKey(delta.name), delta.id));
+			future->sceneChanged = true;
+			break;
+		}
+		case SceneDelta::sourceUpdate:
+		case SceneDelta::listenerUpdate:
+		{
+			Eigen::Vector3f position(delta.values[0], delta.values[1], delta.values[2]);
+			Eigen::Matrix3f rotationMatrix;
 			for (int j = 0; j < 3; j++)
 			{
 				for (int k = 0; k < 3; k++)
 				{
-					source.rotationMatrix(j, k) = msg[4 + (3 * j + k)].getFloat32();
+					rotationMatrix(j, k) = delta.values[3 + (3 * j + k)];
 				}
 			}
+			String name = String::fromUTF8(delta.name);
 
-			// insert or update
-			future->sourceMap[source.name] = source;
-		}
-		else if (pListener.matches(msgAdress))
-		{
-			EL_Listener listener;
-			listener.name = msg[0].getString();
-			listener.position(0) = msg[1].getFloat32();
-			listener.position(1) = msg[2].getFloat32();
-			listener.position(2) = msg[3].getFloat32();
-
-			for (int j = 0; j < 3; j++)
+			if (delta.type == SceneDelta::sourceUpdate)
 			{
-				for (int k = 0; k < 3; k++)
+				EL_Source source;
+				source.name = name;
+				source.position = position;
+				source.rotationMatrix = rotationMatrix;
+
+				// insert or update
+				auto previous = findByName(future->sources, name);
+				if (previous == future->sources.end() || previous->name != name) { future->sources.insert(previous, source); }
+				else { *previous = source; }
+				future->sourceChanged = true;
+				future->sceneChanged = true;
+			}
+			else
+			{
+				EL_Listener listener;
+				listener.name = name;
+				listener.position = position;
+				listener.rotationMatrix = rotationMatrix;
+
+				// a moving listener changes the scene, a rotating one only its orientation
+				auto previous = findByName(future->listeners, name);
+				const bool isNew = previous == future->listeners.end() || previous->name != name;
+				if (isNew || previous->position != position)
 				{
-					listener.rotationMatrix(j, k) = msg[4 + (3 * j + k)].getFloat32();
+					future->listenerMoved = true;
+					future->sceneChanged = true;
 				}
+				if (isNew || previous->rotationMatrix != rotationMatrix)
+				{
+					future->listenerRotated = true;
+				}
+
+				// insert or update
+				if (isNew) { future->listeners.insert(previous, listener); }
+				else { *previous = listener; }
 			}
+			break;
+		}
+		case SceneDelta::rt60Update:
+		{
+			for (int i = 0; i < delta.numValues; i++) { future->valuesR60[i] = delta.values[i]; }
+			future->rt60Changed = true;
+			future->sceneChanged = true;
+			break;
+		}
+		default: jassertfalse; break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int OSCHandler::getSourceKey(const char* sourceName)
+// Scene thread: source key stored with images of source sourceName (0 if unnamed, first source)
+{
+	if (*sourceName == '\0') { return 0; }
 
-			// insert or update
-			future->listenerMap[listener.name] = listener;
+	for (int i = 0; i < sourceKeyNames.size(); i++)
+	{
+		if (sourceKeyNames[i] == sourceName) { return i + 1; }
+	}
+	sourceKeyNames.push_back(String::fromUTF8(sourceName));
+	return (int)sourceKeyNames.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::applyImageFrame(const ImageSourceFrame& frame)
+// Scene thread: replace future source images with those of frame, only images added, updated or
+// removed are reported as changed. Returns false if frame holds the same images as future.
+{
+	const int numImages = frame.getNumImages();
+	const int* ids = frame.getIds();
+	const int* orders = frame.getReflectionOrders();
+	const float* positionsFirst = frame.getPositionsFirst();
+	const float* positionsLast = frame.getPositionsLast();
+	const float* distances = frame.getPathDistances();
+	const float* absorptions = frame.getAbsorptions();
+	SourceImageStore& sourceImages = future->sourceImages;
+	bool changed = false;
+
+	// remove images not in frame (frame images all from the first source, see getSourceKey)
+	frameKeysSorted.resize(numImages);
+	for (int i = 0; i < numImages; i++) { frameKeysSorted[i] = SourceImageStore::makeKey(0, ids[i]); }
+	std::sort(frameKeysSorted.begin(), frameKeysSorted.end());
+	for (int slot = sourceImages.getNumImages() - 1; slot >= 0; slot--)
+	{
+		const SourceImageStore::Key key = sourceImages.getKeys()[slot];
+		if (std::binary_search(frameKeysSorted.begin(), frameKeysSorted.end(), key)) { continue; }
+		sourceImages.remove(key);
+		changed = true;
+	}
+
+	// insert or update others (left untouched if unchanged)
+	for (int i = 0; i < numImages; i++)
+	{
+		if (sourceImages.set(ids[i], orders[i], positionsFirst + 3 * i, positionsLast + 3 * i, distances[i], absorptions + NUM_OCTAVE_BANDS * i))
+		{
+			changed = true;
+		}
+	}
+
+	if (changed) { future->sceneChanged = true; }
+	return changed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::applyState(const OSCStateFile& state)
+// Scene thread: replace future scene with state, only source images added, updated or removed
+// are reported as changed
+{
+	const SourceImageStore& stateImages = state.getSourceImages();
+	SourceImageStore& sourceImages = future->sourceImages;
+	const int numImages = stateImages.getNumImages();
+
+	// state source keys mapped to ours (0: first source, same in both)
+	std::vector<int> sourceKeys(1, 0);
+	for (const String& name : state.getSourceKeyNames()) { sourceKeys.push_back(getSourceKey(name.toRawUTF8())); }
+
+	// remove images not in state
+	frameKeysSorted.resize(numImages);
+	for (int i = 0; i < numImages; i++)
+	{
+		frameKeysSorted[i] = SourceImageStore::makeKey(sourceKeys[stateImages.getSourceKeys()[i]], stateImages.getIds()[i]);
+	}
+	std::sort(frameKeysSorted.begin(), frameKeysSorted.end());
+	for (int slot = sourceImages.getNumImages() - 1; slot >= 0; slot--)
+	{
+		const SourceImageStore::Key key = sourceImages.getKeys()[slot];
+		if (!std::binary_search(frameKeysSorted.begin(), frameKeysSorted.end(), key)) { sourceImages.remove(key); }
+	}
+
+	// insert or update others (left untouched if unchanged)
+	for (int i = 0; i < numImages; i++)
+	{
+		sourceImages.set(stateImages.getIds()[i], stateImages.getReflectionOrders()[i],
+			stateImages.getPositionsFirst().data() + 3 * i, stateImages.getPositionsLast().data() + 3 * i,
+			stateImages.getPathLengths()[i], stateImages.getAbsorptions().data() + NUM_OCTAVE_BANDS * i,
+			sourceKeys[stateImages.getSourceKeys()[i]]);
+	}
+
+	future->sources = state.getSources();
+	future->listeners = state.getListeners();
+	future->valuesR60 = state.getRT60Values();
+	future->sourceChanged = true;
+	future->listenerMoved = true;
+	future->listenerRotated = true;
+	future->rt60Changed = true;
+	future->sceneChanged = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCHandler::parseMessage(const OSCMessage& msg, SceneDelta& delta)
+// Receiver thread: parse message into scene delta, false if not a scene message
+{
+	OSCAddress msgAdress(msg.getAddressPattern().toString());
+
+	if ((patternIn.matches(msgAdress) || patternUpd.matches(msgAdress)) && (msg.size() == 19 || (msg.size() == 20 && msg[19].isString())))
+	{
+		// format: [ /in pathID order r1x r1y r1z rNx rNy rNz dist abs1 .. abs9 (sourceName) ]
+		delta.type = SceneDelta::imageUpdate;
+		delta.id = msg[0].getInt32();
+		delta.reflectionOrder = msg[1].getInt32();
+		delta.numValues = 17;
+		for (int i = 0; i < delta.numValues; i++) { delta.values[i] = msg[2 + i].getFloat32(); }
+		if (msg.size() == 20) { msg[19].getString().copyToUTF8(delta.name, sizeof(delta.name)); }
+		else { delta.name[0] = '\0'; }
+	}
+	else if (patternR60.matches(msgAdress))
+	{
+		delta.type = SceneDelta::rt60Update;
+		delta.numValues = jmin(msg.size(), (int)NUM_OCTAVE_BANDS);
+		for (int i = 0; i < delta.numValues; i++) { delta.values[i] = msg[i].getFloat32(); }
+	}
+	else if ((patternSource.matches(msgAdress) || patternListener.matches(msgAdress)) && msg.size() >= 13)
+	{
+		// format: [ /source name x y z r11 r12 r13 r21 .. r33 ]
+		delta.type = patternSource.matches(msgAdress) ? SceneDelta::sourceUpdate : SceneDelta::listenerUpdate;
+		msg[0].getString().copyToUTF8(delta.name, sizeof(delta.name));
+		delta.numValues = 12;
+		for (int j = 0; j < delta.numValues; j++) { delta.values[j] = msg[1 + j].getFloat32(); }
+	}
+	else if (patternOut.matches(msgAdress) && msg.size() > 0)
+	{
+		// format: [ /out pathID (sourceName) ]
+		delta.type = SceneDelta::imageRemove;
+		delta.id = msg[0].getInt32();
+		if (msg.size() > 1 && msg[1].isString()) { msg[1].getString().copyToUTF8(delta.name, sizeof(delta.name)); }
+		else { delta.name[0] = '\0'; }
+	}
+	else if (patternFrame.matches(msgAdress) && msg.size() > 0 && msg[0].isBlob())
+	{
+		// format: [ /frame blob ], whole source image set (see ImageSourceFrame), ends frame
+		const MemoryBlock& blob = msg[0].getBlob();
+		ImageSourceFrame& frame = imageFrames.getWriteBuffer();
+		if (!frame.decodeBlob(blob.getData(), blob.getSize()))
+		{
+			DBG("invalid /frame blob (" + String((int)blob.getSize()) + " bytes)");
+			return false;
 		}
-		else if (pOut.matches(msgAdress))
+		// frame split over several blobs: wait for the last one
+		if (!frame.isComplete()) { return false; }
+
+		delta.type = SceneDelta::imageFrame;
+		delta.id = (int)frame.getFrameId();
+		imageFrames.publish();
+	}
+	else if (patternFrame.matches(msgAdress))
+	{
+		// format: [ /frame ], sent by client after the last message of a frame
+		delta.type = SceneDelta::frameEnd;
+		delta.id = 1;
+	}
+
+	//    else {
+	//        DBG(String("unhandled osc msg: ") + msg.getAddressPattern().toString() + String(" size: ") + String(msg.size()));
+	//
+	//        for (int i = 1; i < msg.size(); i++) {
+	//            if (msg[i].isInt32()) DBG(String(i) + String(" Int32") );
+	//            if (msg[i].isFloat32()) DBG(String(i) + String(" Float32") );
+	//            if (msg[i].isString()) DBG(String(i) + String(" String") );
+	//            if (msg[i].isBlob()) DBG(String(i) + String(" Blob") );
+	//        }
+	//    }
+
+	else { return false; }
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::oscMessageReceived(const OSCMessage& msg)
+// Receiver thread: parse message into scene delta
+{
+	captureWriter.write(msg);
+
+	SceneDelta delta;
+	if (!parseMessage(msg, delta)) { return; }
+
+	delta.inBundle = false;
+	pushDelta(delta);
+	notify();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCHandler::oscBundleReceived(const OSCBundle& bundle)
+// Receiver thread: parse bundle into scene deltas. Consecutive bundles sharing a time tag (frame
+// split over several datagrams) form a single frame, an immediate bundle is a frame on its own.
+{
+	//    DBG(bundle.size());
+	captureWriter.write(bundle);
+
+	const OSCTimeTag timeTag = bundle.getTimeTag();
+	if (bundleTimeTagOpen && (timeTag.isImmediately() || timeTag.getRawTimeTag() != bundleTimeTag))
+	{
+		pushFrameEnd(false);
+		bundleTimeTagOpen = false;
+	}
+
+	for (int i = 0; i < bundle.size(); i++)
+	{
+		if (!bundle[i].isMessage()) { continue; }
+		// DBG("osc msg (bundle " + String(i) + String("):") + bundle[i].getMessage().getAddressPattern().toString());
+
+		SceneDelta delta;
+		if (parseMessage(bundle[i].getMessage(), delta))
 		{
-			future->sourceImageMap.erase(msg[0].getInt32());
+			delta.inBundle = true;
+			pushDelta(delta);
 		}
 	}
 
-	sendChangeMessage();
+	if (timeTag.isImmediately()) { pushFrameEnd(false); }
+	else
+	{
+		bundleTimeTag = timeTag.getRawTimeTag();
+		bundleTimeTagOpen = true;
+	}
+
+	notify();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void OSCHandler::showConnectionErrorMessage(const String& messageText)
-// Popup window if OSC connection failed 
+void OSCHandler::connectReceiver()
+// Connect OSC receiver. On failure, error left for the owner to report (see getConnectionError),
+// no GUI from here: the engine also runs headless.
 {
-	AlertWindow::showMessageBoxAsync(
-		AlertWindow::WarningIcon,
-		"Connection error",
-		messageText,
-		"OK");
+	if (connect(port)) { connectionError.clear(); return; }
+
+	connectionError = "Error: (OSC) could not connect to localhost@" + String(port) + ".";
+	DBG(connectionError);
+	sendChangeMessage();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,219 @@
+#include "OSCStateFile.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::load(const File& stateFile)
+// False if file can't be read or is not a valid state (see getErrorLine)
+{
+	MemoryBlock content;
+	errorLine = 0;
+	if (!stateFile.loadFileAsData(content)) { return false; }
+
+	content.append("", 1); // null terminated
+	return parse(static_cast<const char*>(content.getData()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::parse(const char* text)
+// Replace state with that described by text, false if a line is invalid (state then incomplete)
+{
+	sourceImages.clear();
+	sources.clear();
+	listeners.clear();
+	sourceKeyNames.clear();
+	valuesR60.assign(NUM_OCTAVE_BANDS, 0.f);
+	errorLine = 0;
+
+	for (int line = 1; *text != '\0'; line++)
+	{
+		if (!parseLine(text))
+		{
+			errorLine = line;
+			return false;
+		}
+	}
+
+	sourceImages.clearChanges();
+	sourceImages.buildIndex();
+	std::stable_sort(sources.begin(), sources.end(), [](const EL_Source& a, const EL_Source& b) { return a.name < b.name; });
+	std::stable_sort(listeners.begin(), listeners.end(), [](const EL_Listener& a, const EL_Listener& b) { return a.name < b.name; });
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::parseLine(const char*& text)
+// Parse one line, text advanced to the start of next one
+{
+	if (isEndOfLine(text)) { return true; }
+
+	if (readKeyword(text, "imgSrc:"))
+	{
+		int id, order;
+		float positionFirst[3], positionLast[3], pathLength, absorption[NUM_OCTAVE_BANDS];
+		if (!readInt(text, id)
+			|| !readKeyword(text, "order:") || !readInt(text, order)
+			|| !readKeyword(text, "posFirst:") || !readFloats(text, positionFirst, 3)
+			|| !readKeyword(text, "posLast:") || !readFloats(text, positionLast, 3)
+			|| !readKeyword(text, "pathLength:") || !readFloats(text, &pathLength, 1)
+			|| !readKeyword(text, "abs:") || !readFloats(text, absorption, NUM_OCTAVE_BANDS))
+		{
+			return false;
+		}
+
+		// named source, if any
+		int sourceKey = 0;
+		String sourceName;
+		if (readKeyword(text, "src:"))
+		{
+			if (!readName(text, sourceName)) { return false; }
+			sourceKey = (int)std::distance(sourceKeyNames.begin(), std::find(sourceKeyNames.begin(), sourceKeyNames.end(), sourceName)) + 1;
+			if (sourceKey > sourceKeyNames.size()) { sourceKeyNames.push_back(sourceName); }
+		}
+		sourceImages.set(id, order, positionFirst, positionLast, pathLength, absorption, sourceKey);
+	}
+	else if (readKeyword(text, "listener:"))
+	{
+		if (!parseElement(text, true)) { return false; }
+	}
+	else if (readKeyword(text, "source:"))
+	{
+		if (!parseElement(text, false)) { return false; }
+	}
+	else if (readKeyword(text, "rt60:"))
+	{
+		// as many values as saved (at most one per band), missing bands left to 0
+		for (int i = 0; i < NUM_OCTAVE_BANDS; i++)
+		{
+			skipSpaces(text);
+			if (*text == '\r' || *text == '\n' || *text == '\0') { break; }
+			if (!readFloats(text, &valuesR60[i], 1)) { return false; }
+		}
+	}
+	else { return false; }
+
+	return isEndOfLine(text);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::parseElement(const char*& text, const bool isListener)
+// Listener / source, after its keyword: name pos: x y z rot: r11 r12 r13 r21 .. r33
+{
+	String name;
+	float values[12]; // pos xyz, rot 3x3
+	if (!readName(text, name)
+		|| !readKeyword(text, "pos:") || !readFloats(text, values, 3)
+		|| !readKeyword(text, "rot:") || !readFloats(text, values + 3, 9))
+	{
+		return false;
+	}
+
+	Eigen::Vector3f position(values[0], values[1], values[2]);
+	Eigen::Matrix3f rotationMatrix;
+	for (int j = 0; j < 3; j++)
+	{
+		for (int k = 0; k < 3; k++) { rotationMatrix(j, k) = values[3 + (3 * j + k)]; }
+	}
+
+	if (isListener)
+	{
+		EL_Listener listener;
+		listener.name = name;
+		listener.position = position;
+		listener.rotationMatrix = rotationMatrix;
+		listeners.push_back(listener);
+	}
+	else
+	{
+		EL_Source source;
+		source.name = name;
+		source.position = position;
+		source.rotationMatrix = rotationMatrix;
+		sources.push_back(source);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::readKeyword(const char*& text, const char* keyword)
+{
+	skipSpaces(text);
+	const size_t length = strlen(keyword);
+	if (strncmp(text, keyword, length) != 0) { return false; }
+
+	text += length;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::readName(const char*& text, String& name)
+{
+	skipSpaces(text);
+	const char* start = text;
+	while (*text != ' ' && *text != '\t' && *text != '\r' && *text != '\n' && *text != '\0') { text++; }
+	if (text == start) { return false; }
+
+	name = String::fromUTF8(start, (int)(text - start));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::readInt(const char*& text, int& value)
+{
+	// strtol would skip line breaks as well
+	skipSpaces(text);
+	if (*text == '\r' || *text == '\n') { return false; }
+
+	char* end;
+	value = (int)strtol(text, &end, 10);
+	if (end == text) { return false; }
+
+	text = end;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::readFloats(const char*& text, float* values, const int numValues)
+{
+	for (int i = 0; i < numValues; i++)
+	{
+		// strtof would skip line breaks as well
+		skipSpaces(text);
+		if (*text == '\r' || *text == '\n') { return false; }
+
+		char* end;
+		values[i] = strtof(text, &end);
+		if (end == text) { return false; }
+		text = end;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OSCStateFile::isEndOfLine(const char*& text)
+// True if nothing but spaces left on line, text then advanced to the start of next line
+{
+	skipSpaces(text);
+	if (*text == '\r') { text++; }
+	if (*text == '\n') { text++; }
+	else if (*text != '\0') { return false; }
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OSCStateFile::skipSpaces(const char*& text)
+{
+	while (*text == ' ' || *text == '\t') { text++; }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
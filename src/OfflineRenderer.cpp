@@ -0,0 +1,288 @@
+#include "OfflineRenderer.h"
+#include "EvertimsEngine.h"
+
+#include <memory>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Host driven engine (see EvertimsEngine), fed from an audio file and advanced at audio time,
+// rendering the first listener to Ambisonic channels followed by their binaural decoding.
+
+class OfflineRenderer::RenderChain
+{
+	public:
+
+		RenderChain(const Settings& renderSettings);
+
+		void render(Job& job, const ThreadPoolJob* poolJob);
+
+	private:
+
+		bool loadScene(const File& sceneFile, String& error);
+
+		const Settings& settings;
+		EvertimsEngine engine;
+
+		// Buffers: input (one channel per source), Ambisonic + binaural channels
+		AudioBuffer<float> inputBuffer;
+		AudioBuffer<float> outputBuffer;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderChain)
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OfflineRenderer::RenderChain::RenderChain(const Settings& renderSettings) :
+	settings(renderSettings),
+	engine(EvertimsEngine::hostDriven)
+{
+	engine.setParameter(EvertimsEngine::ambisonicOrder, settings.ambisonicOrder);
+	engine.setParameter(EvertimsEngine::outputFormat, EvertimsEngine::ambisonicAndBinauralOutput);
+	engine.setParameter(EvertimsEngine::numFrequencyBands, settings.numFreqBands);
+	engine.setParameter(EvertimsEngine::enableReverbTail, settings.enableReverbTail);
+	engine.setParameter(EvertimsEngine::enableDirectToBinaural, settings.enableDirectToBinaural);
+	engine.setParameter(EvertimsEngine::numBinauralImages, settings.numBinauralImages);
+	engine.setParameter(EvertimsEngine::maxSceneUpdateRate, settings.maxSceneUpdateRate);
+	engine.setParameter(EvertimsEngine::numRenderThreads, settings.numRenderThreads);
+	engine.setParameter(EvertimsEngine::sphericalHarmonicDirectivity, settings.sphericalHarmonicDirectivity);
+	engine.setSourceDirectivity(settings.sourceDirectivity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OfflineRenderer::RenderChain::loadScene(const File& sceneFile, String& error)
+// OSC capture (replayed at audio time) or saved OSC state (loaded at time 0)
+{
+	char magic[8] = { 0 };
+	FileInputStream stream(sceneFile);
+	if (stream.failedToOpen())
+	{
+		error = "cannot read scene " + sceneFile.getFullPathName();
+		return false;
+	}
+
+	if (stream.read(magic, 8) == 8 && memcmp(magic, OSCCaptureFormat::magic(), 8) == 0)
+	{
+		if (engine.getScene().startOfflineReplay(sceneFile)) { return true; }
+		error = "invalid OSC capture " + sceneFile.getFullPathName();
+		return false;
+	}
+
+	int errorLine = 0;
+	if (engine.getScene().loadState(sceneFile, errorLine)) { return true; }
+	error = "invalid OSC state " + sceneFile.getFullPathName() + " (line " + String(errorLine) + ")";
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OfflineRenderer::RenderChain::render(Job& job, const ThreadPoolJob* poolJob)
+// Render job input through job scene to job outputs, tail included. Stops early (job failed) if
+// poolJob is asked to exit.
+{
+	job.succeeded = false;
+	if (job.ambisonicOutput == File() && job.binauralOutput == File())
+	{
+		job.error = "no output file";
+		return;
+	}
+
+	AudioFormatManager formatManager;
+	formatManager.registerBasicFormats();
+	std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(job.input));
+	if (reader == nullptr)
+	{
+		job.error = "cannot read audio file " + job.input.getFullPathName();
+		return;
+	}
+	if (!loadScene(job.scene, job.error)) { return; }
+
+	// first listener only: Ambisonic channels then both ears
+	const double sampleRate = reader->sampleRate;
+	const int blockSize = settings.blockSize;
+	const int numAmbiChannels = getNumAmbiChannels(settings.ambisonicOrder);
+	inputBuffer.setSize(jmax(2, (int)SourceImagesHandler::maxNumSources), blockSize);
+	outputBuffer.setSize(engine.getNumChannelsPerListener(), blockSize);
+	engine.prepare(sampleRate, blockSize, inputBuffer.getNumChannels(), outputBuffer.getNumChannels());
+	const AudioBuffer<float> ambisonicOutput(outputBuffer.getArrayOfWritePointers(), numAmbiChannels, blockSize);
+	const AudioBuffer<float> binauralOutput(outputBuffer.getArrayOfWritePointers() + numAmbiChannels, 2, blockSize);
+
+	// output writers (WAV, 32 bit float)
+	WavAudioFormat wavFormat;
+	std::unique_ptr<AudioFormatWriter> ambisonicWriter, binauralWriter;
+	auto createWriter = [&](const File& file, const int numChannels, std::unique_ptr<AudioFormatWriter>& writer) -> bool
+	{
+		if (file == File()) { return true; }
+		file.deleteFile();
+		std::unique_ptr<FileOutputStream> stream(file.createOutputStream());
+		if (stream == nullptr) { return false; }
+		writer.reset(wavFormat.createWriterFor(stream.get(), sampleRate, numChannels, 32, StringPairArray(), 0));
+		if (writer == nullptr) { return false; }
+		stream.release(); // owned by writer
+		return true;
+	};
+	if (!createWriter(job.ambisonicOutput, numAmbiChannels, ambisonicWriter)
+		|| !createWriter(job.binauralOutput, 2, binauralWriter))
+	{
+		job.error = "cannot write output file";
+		return;
+	}
+
+	const int64 numSamples = reader->lengthInSamples + (int64)(settings.tailDuration * sampleRate);
+	const double startTime = Time::getMillisecondCounterHiRes();
+
+	for (int64 position = 0; position < numSamples; position += blockSize)
+	{
+		if (poolJob != nullptr && poolJob->shouldExit())
+		{
+			job.error = "interrupted";
+			return;
+		}
+
+		// scene at audio time (capture packets replayed up to now, frames committed as they would
+		// be by the scene thread)
+		engine.commitScene();
+
+		// one input channel per source (zeros past the end of the file), mono downmix for a single
+		// source, as AudioIOComponent does
+		const int numSources = engine.getNumSources();
+		AudioBuffer<float> sourceInputs(inputBuffer.getArrayOfWritePointers(), jmax(2, numSources), blockSize);
+		reader->read(&sourceInputs, 0, blockSize, position, true, true);
+		if (numSources <= 1)
+		{
+			sourceInputs.applyGain(0.5f);
+			sourceInputs.addFrom(0, 0, sourceInputs, 1, 0, blockSize);
+		}
+
+		engine.process(inputBuffer.getArrayOfReadPointers(), outputBuffer.getArrayOfWritePointers(), blockSize);
+
+		const int numSamplesToWrite = (int)jmin((int64)blockSize, numSamples - position);
+		if (ambisonicWriter != nullptr) { ambisonicWriter->writeFromAudioSampleBuffer(ambisonicOutput, 0, numSamplesToWrite); }
+		if (binauralWriter != nullptr) { binauralWriter->writeFromAudioSampleBuffer(binauralOutput, 0, numSamplesToWrite); }
+	}
+
+	job.renderDuration = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+	job.audioDuration = numSamples / sampleRate;
+	job.succeeded = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+class OfflineRenderer::RenderJob : public ThreadPoolJob
+{
+	public:
+
+		RenderJob(Job& jobToRender, const Settings& renderSettings) :
+			ThreadPoolJob("Offline render"),
+			job(jobToRender),
+			settings(renderSettings)
+		{}
+
+		JobStatus runJob() override
+		{
+			RenderChain chain(settings);
+			chain.render(job, this);
+			return jobHasFinished;
+		}
+
+	private:
+
+		Job& job;
+		const Settings& settings;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OfflineRenderer::OfflineRenderer() :
+	Thread("Offline renderer")
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+OfflineRenderer::~OfflineRenderer()
+{
+	stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool OfflineRenderer::start(const Array<Job>& jobsToRender, const Settings& renderSettings, const int numParallelJobs)
+// Render jobs on numParallelJobs threads (onFinished called once done), false if already rendering
+{
+	if (isRendering()) { return false; }
+
+	jobs = jobsToRender;
+	settings = renderSettings;
+	numThreads = jlimit(1, jmax(1, jobs.size()), numParallelJobs);
+	batchDuration = 0.0;
+	startThread();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OfflineRenderer::render(Job& job, const Settings& settings)
+// Render a single job on the calling thread
+{
+	RenderChain chain(settings);
+	chain.render(job, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OfflineRenderer::run()
+// Renderer thread: hand jobs over to a thread pool and wait for them (interrupted if stopped)
+{
+	const double startTime = Time::getMillisecondCounterHiRes();
+	{
+		ThreadPool pool(numThreads);
+		for (auto& job : jobs) { pool.addJob(new RenderJob(job, settings), true); }
+		while (pool.getNumJobs() > 0 && !threadShouldExit()) { wait(10); }
+		pool.removeAllJobs(true, -1);
+	}
+	batchDuration = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+	if (onFinished) { onFinished(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int OfflineRenderer::getNumFailedJobs() const
+{
+	int numFailed = 0;
+	for (auto& job : jobs) { if (!job.succeeded) { numFailed++; } }
+	return numFailed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+String OfflineRenderer::getReport() const
+// One line per job (speed-up over real time or error), then batch speed-up: audio rendered by all
+// jobs over batch duration
+{
+	String report;
+	double audioDuration = 0.0;
+	for (auto& job : jobs)
+	{
+		report << job.input.getFileName() << ": ";
+		if (job.succeeded)
+		{
+			report << String(job.audioDuration, 2) << " s rendered in " << String(job.renderDuration, 2) << " s ("
+				<< String(job.getSpeedUp(), 1) << "x real time)\n";
+			audioDuration += job.audioDuration;
+		}
+		else { report << "failed, " << job.error << "\n"; }
+	}
+
+	const double speedUp = batchDuration > 0.0 ? audioDuration / batchDuration : 0.0;
+	report << jobs.size() - getNumFailedJobs() << "/" << jobs.size() << " files, " << String(audioDuration, 2) << " s rendered in "
+		<< String(batchDuration, 2) << " s on " << numThreads << " threads (" << String(speedUp, 1) << "x real time)\n";
+	return report;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,82 @@
+#include "RenderThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderThreadPool::setNumThreads(const int numThreads)
+{
+	const int numWorkers = jlimit(1, maxNumThreads, numThreads) - 1;
+	if (numWorkers == workers.size()) { return; }
+
+	for (auto* worker : workers)
+	{
+		worker->signalThreadShouldExit();
+		worker->startEvent.signal();
+	}
+	for (auto* worker : workers) { worker->stopThread(1000); }
+	workers.clear();
+
+	for (int i = 0; i < numWorkers; i++)
+	{
+		Worker* worker = workers.add(new Worker(*this, i + 1));
+		worker->startThread(workerPriority);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderThreadPool::run(Job& job)
+// Run job on all threads, returns once all are done
+{
+	lastWaitTicks = 0;
+	if (workers.size() == 0)
+	{
+		job.runJob(0);
+		return;
+	}
+
+	currentJob = &job;
+	numWorkersRunning = workers.size();
+	for (auto* worker : workers) { worker->startEvent.signal(); }
+
+	job.runJob(0);
+
+	// join: workers finishing their last chunk, no lock (yield past a few microseconds)
+	if (numWorkersRunning.load(std::memory_order_acquire) == 0) { return; }
+	const int64 waitStart = StageProfiler::getTicks();
+	for (int i = 0; i < spinCount && numWorkersRunning.load(std::memory_order_acquire) > 0; i++) {}
+	while (numWorkersRunning.load(std::memory_order_acquire) > 0) { Thread::yield(); }
+	lastWaitTicks = StageProfiler::getTicks() - waitStart;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RenderThreadPool::getDefaultNumThreads()
+{
+	return jlimit(1, maxNumThreads, SystemStats::getNumCpus() - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+RenderThreadPool::Worker::Worker(RenderThreadPool& ownerPool, const int index) :
+	Thread("Render thread " + String(index)),
+	pool(ownerPool),
+	threadIndex(index)
+{}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderThreadPool::Worker::run()
+{
+	while (true)
+	{
+		startEvent.wait();
+		if (threadShouldExit()) { return; }
+
+		pool.currentJob->runJob(threadIndex);
+		pool.numWorkersRunning.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -5,10 +5,8 @@
 
 ReverbTail::ReverbTail()
 {
-	// Init local attributes
-	valuesRT60.resize(numOctaveBands, 0.0f);
-
 	// Define FDN parameters
+	defineFdnDelays();
 	defineFdnFeedbackMatrix();
 }
 
@@ -23,45 +21,54 @@ void ReverbTail::prepareToPlay(const unsigned int samplesPerBlockExpected, const
 	tailBuffer.setSize(fdnOrder, samplesPerBlockExpected);
 	workingBuffer.setSize(1, samplesPerBlockExpected, false, true);
 
-	// init delay line
+	// init delay line, once and for all at its max length (FDN delays are static)
 	delayLine.prepareToPlay(samplesPerBlockExpected, sampleRate);
-	delayLine.setSize(fdnOrder * numOctaveBands, sampleRate); // debug: set delay line max size
+	delayLine.setSize(fdnOrder * numOctaveBands, *std::max_element(fdnDelays.begin(), fdnDelays.end()) + samplesPerBlockExpected);
 
 	// keep local copies
 	localSampleRate = sampleRate;
 	localSamplesPerBlockExpected = samplesPerBlockExpected;
-
-	// update FDN parameters
-	updateFdnParameters();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ReverbTail::updateInternals(const std::vector<float>& rt60Values)
-// Update FDN gains and cie based on new RT60 values
+ReverbTail::FdnGains ReverbTail::getFdnGains(const std::vector<float>& rt60Values) const
+// FDN gains based on RT60 values (in sec, 10 bands), computed off the audio thread and handed over
+// to it with the render state (see setFdnGains)
 {
-	// store new RT60 values
-	valuesRT60 = from10to3bands(rt60Values);
+	const std::vector<float> valuesRT60 = from10to3bands(rt60Values);
 
-	// increase fdn delay line length if need be
-	float maxDelay = getMaxValue(valuesRT60);
-	delayLine.setSize(fdnOrder * numOctaveBands, maxDelay * localSampleRate);
-
-	// update FDN parameters
-	updateFdnParameters();
+	FdnGains gains;
+	for (int bandId = 0; bandId < numOctaveBands; bandId++)
+	{
+		for (int fdnId = 0; fdnId < fdnOrder; fdnId++)
+		{
+			gains[bandId][fdnId] = pow(10, -3 * (fdnDelays[fdnId] / localSampleRate) / valuesRT60[bandId]);
+		}
+	}
+	return gains;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ReverbTail::addToBus(const unsigned int busId, const AudioBuffer<float>& source)
+void ReverbTail::addToBus(const unsigned int busId, const AudioBuffer<float>& source, const int numBands)
 // Add source image to reverberation bus for latter use
+{
+	addToBus(busId, source, numBands, reverbBusBuffers);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ReverbTail::addToBus(const unsigned int busId, const AudioBuffer<float>& source, const int numBands, AudioBuffer<float>& busBuffers) const
+// Add source image (numBands first channels of source) to busBuffers (getNumBusChannels() channels),
+// e.g. one per render thread, later added to reverberation bus (see addBusBuffers)
 {
 	// If main thread operates with 3 bands
-	if (source.getNumChannels() == 3)
+	if (numBands == 3)
 	{
-		for (int k = 0; k < source.getNumChannels(); k++)
+		for (int k = 0; k < numBands; k++)
 		{
-			reverbBusBuffers.addFrom(k * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
+			busBuffers.addFrom(k * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
 		}
 	}
 	// If main thread operates with 10 bands (reduce to 3 here)
@@ -69,15 +76,26 @@ void ReverbTail::addToBus(const unsigned int busId, const AudioBuffer<float>& so
 		// low frequencies
 		for (int k = 0; k < 5; k++)
 		{
-			reverbBusBuffers.addFrom(0 * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
+			busBuffers.addFrom(0 * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
 		}
 		// mid frequencies
 		for (int k = 5; k < 9; k++)
 		{
-			reverbBusBuffers.addFrom(1 * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
+			busBuffers.addFrom(1 * fdnOrder + busId, 0, source, k, 0, localSamplesPerBlockExpected);
 		}
 		// last band
-		reverbBusBuffers.addFrom(2 * fdnOrder + busId, 0, source, 9, 0, localSamplesPerBlockExpected);
+		busBuffers.addFrom(2 * fdnOrder + busId, 0, source, 9, 0, localSamplesPerBlockExpected);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ReverbTail::addBusBuffers(const AudioBuffer<float>& busBuffers)
+// Add source images summed in busBuffers (see addToBus) to reverberation bus
+{
+	for (int k = 0; k < getNumBusChannels(); k++)
+	{
+		reverbBusBuffers.addFrom(k, 0, busBuffers, k, 0, localSamplesPerBlockExpected);
 	}
 }
 
@@ -151,7 +169,7 @@ void ReverbTail::clear()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ReverbTail::updateFdnParameters()
+void ReverbTail::defineFdnDelays()
 {
 
 	// Define FDN delays (put here even if static define to be ready for TODO)
@@ -173,15 +191,6 @@ void ReverbTail::updateFdnParameters()
 	fdnDelays[13] = 6241;
 	fdnDelays[14] = 6889;
 	fdnDelays[15] = 7921;
-
-	// Define FDN gains based on new delays
-	for (int bandId = 0; bandId < numOctaveBands; bandId++)
-	{
-		for (int fdnId = 0; fdnId < fdnOrder; fdnId++)
-		{
-			fdnGains[bandId][fdnId] = pow(10, -3 * (fdnDelays[fdnId] / localSampleRate) / valuesRT60[bandId]);
-		}
-	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
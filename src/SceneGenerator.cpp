@@ -0,0 +1,348 @@
+#include "SceneGenerator.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+SceneGenerator::SceneGenerator() :
+	Thread("Scene generator")
+{
+	lattices.reserve(maxNumImages);
+	sentIds.reserve(maxNumImages);
+	sentValues.reserve(17 * maxNumImages);
+	frameIds.reserve(maxNumImages);
+	frameValues.reserve(17 * maxNumImages);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+SceneGenerator::~SceneGenerator()
+{
+	stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneGenerator::start(const Settings& newSettings, OSCCapturePlayer::Target* newTarget)
+// Send scene to newTarget (in process)
+{
+	stop();
+
+	target = newTarget;
+	setSettings(newSettings);
+	startThread();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneGenerator::start(const Settings& newSettings, const int udpPort)
+// Send scene to localhost:udpPort, false if port not reachable
+{
+	stop();
+	if (!sender.connect("127.0.0.1", udpPort)) { return false; }
+
+	target = nullptr;
+	setSettings(newSettings);
+	startThread();
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::stop()
+// Stop sending, scene left as last sent
+{
+	stopThread(2000);
+	sender.disconnect();
+
+	sentIds.clear();
+	sentValues.clear();
+	rt60Pending = true;
+	numFramesSent = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::setSettings(const Settings& newSettings)
+{
+	const ScopedLock lock(settingsLock);
+	pendingSettings = newSettings;
+	settingsChanged = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::run()
+// Generator thread: one frame per update period (no catching up on late frames)
+{
+	const double startTime = Time::getMillisecondCounterHiRes();
+	double nextFrameTime = startTime;
+
+	while (!threadShouldExit())
+	{
+		{
+			const ScopedLock lock(settingsLock);
+			if (settingsChanged) { applySettings(); }
+		}
+
+		sendFrame(0.001 * (Time::getMillisecondCounterHiRes() - startTime));
+		numFramesSent++;
+
+		nextFrameTime += 1000.0 / settings.updateRate;
+		double now = Time::getMillisecondCounterHiRes();
+		if (nextFrameTime < now) { nextFrameTime = now; }
+		for (; now < nextFrameTime && !threadShouldExit(); now = Time::getMillisecondCounterHiRes())
+		{
+			wait(jmax(1, (int)(nextFrameTime - now)));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::applySettings()
+// Generator thread, settings lock held: select images (lowest orders first, sorted by id)
+{
+	settings = pendingSettings;
+	settingsChanged = false;
+
+	for (int a = 0; a < 3; a++) { settings.roomSize[a] = jmax(1.f, settings.roomSize[a]); }
+	settings.maxReflectionOrder = jlimit(0, 63, settings.maxReflectionOrder);
+	settings.numImages = jlimit(1, (int)maxNumImages, settings.numImages);
+	settings.updateRate = jlimit(0.1f, 1000.f, settings.updateRate);
+	rt60Pending = true;
+
+	lattices.clear();
+	for (int order = 0; order <= settings.maxReflectionOrder && lattices.size() < settings.numImages; order++)
+	{
+		for (int mx = -order; mx <= order; mx++)
+		{
+			const int remainderX = order - std::abs(mx);
+			for (int my = -remainderX; my <= remainderX; my++)
+			{
+				const int remainderY = remainderX - std::abs(my);
+				for (int mz = -remainderY; mz <= remainderY; mz += jmax(1, 2 * remainderY))
+				{
+					if (lattices.size() == settings.numImages) { break; }
+
+					Lattice lattice;
+					lattice.m[0] = mx;
+					lattice.m[1] = my;
+					lattice.m[2] = mz;
+					lattice.order = order;
+					lattice.id = ((mx + 64) << 14) | ((my + 64) << 7) | (mz + 64);
+					lattices.push_back(lattice);
+				}
+			}
+		}
+	}
+	std::sort(lattices.begin(), lattices.end(), [](const Lattice& a, const Lattice& b) { return a.id < b.id; });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::sendFrame(const double time)
+// Send source, listener and images changed since last frame (time in s since start)
+{
+	const Eigen::Vector3f margin = Eigen::Vector3f::Constant(0.1f);
+	sourcePosition = getPosition(settings.sourcePath, time).cwiseMax(margin).cwiseMin(settings.roomSize - margin);
+	listenerPosition = getPosition(settings.listenerPath, time).cwiseMax(margin).cwiseMin(settings.roomSize - margin);
+
+	// frame bundles share a time tag
+	frameTimeTag = OSCTimeTag(Time::getCurrentTime());
+	bundleSize = 0;
+
+	// format: [ /source name x y z r11 r12 r13 r21 .. r33 ], world to element rotation
+	const float yaw = degreesToRadians(settings.listenerYawRate * (float)time);
+	const Eigen::Matrix3f sourceRotation = Eigen::Matrix3f::Identity();
+	const Eigen::Matrix3f listenerRotation = Eigen::AngleAxisf(-yaw, Eigen::Vector3f::UnitZ()).toRotationMatrix();
+	for (int e = 0; e < 2; e++)
+	{
+		OSCMessage message(e == 0 ? "/source" : "/listener");
+		const Eigen::Vector3f& position = e == 0 ? sourcePosition : listenerPosition;
+		const Eigen::Matrix3f& rotation = e == 0 ? sourceRotation : listenerRotation;
+		message.addString(e == 0 ? "source" : "listener");
+		for (int a = 0; a < 3; a++) { message.addFloat32(position[a]); }
+		for (int j = 0; j < 3; j++)
+		{
+			for (int k = 0; k < 3; k++) { message.addFloat32(rotation(j, k)); }
+		}
+		addMessage(message);
+	}
+
+	// Sabine's formula
+	if (rt60Pending)
+	{
+		const Eigen::Vector3f& size = settings.roomSize;
+		const float volume = size[0] * size[1] * size[2];
+		const float surface = 2.f * (size[0] * size[1] + size[0] * size[2] + size[1] * size[2]);
+		OSCMessage message("/rt60");
+		for (int k = 0; k < NUM_OCTAVE_BANDS; k++)
+		{
+			message.addFloat32(0.161f * volume / (surface * jmax(0.001f, settings.wallAbsorption[k])));
+		}
+		addMessage(message);
+		rt60Pending = false;
+	}
+
+	// images, diffed against last frame (both sorted by id)
+	frameIds.resize(lattices.size());
+	frameValues.resize(17 * lattices.size());
+	int j = 0;
+	for (int i = 0; i < lattices.size(); i++)
+	{
+		const int id = lattices[i].id;
+		float* values = frameValues.data() + 17 * i;
+		frameIds[i] = id;
+		computeImage(lattices[i], values);
+
+		for (; j < sentIds.size() && sentIds[j] < id; j++) { addMessage(OSCMessage("/out", sentIds[j])); }
+		const bool isNew = j == sentIds.size() || sentIds[j] != id;
+		if (!isNew && std::equal(values, values + 17, sentValues.begin() + 17 * j))
+		{
+			j++;
+			continue;
+		}
+		if (!isNew) { j++; }
+
+		// format: [ /in pathID order r1x r1y r1z rNx rNy rNz dist abs1 .. abs10 ]
+		OSCMessage message(isNew ? "/in" : "/upd");
+		message.addInt32(id);
+		message.addInt32(lattices[i].order);
+		for (int k = 0; k < 17; k++) { message.addFloat32(values[k]); }
+		addMessage(message);
+	}
+	for (; j < sentIds.size(); j++) { addMessage(OSCMessage("/out", sentIds[j])); }
+	flushBundle();
+
+	sentIds.swap(frameIds);
+	sentValues.swap(frameValues);
+
+	send(OSCMessage("/frame"));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::computeImage(const Lattice& lattice, float* values) const
+// Image source values: first and last reflection points, path length and absorption
+{
+	const Eigen::Vector3f& size = settings.roomSize;
+
+	// image position, walls crossed by the (unfolded) path from listener to image
+	Eigen::Vector3f image;
+	for (int a = 0; a < 3; a++)
+	{
+		const int m = lattice.m[a];
+		image[a] = (m % 2 == 0) ? m * size[a] + sourcePosition[a] : (m + 1) * size[a] - sourcePosition[a];
+	}
+	const Eigen::Vector3f direction = image - listenerPosition;
+
+	Eigen::Vector3f firstPoint = listenerPosition; // direct path: DOD towards listener
+	Eigen::Vector3f lastPoint = sourcePosition; // direct path: DOA from source
+	if (lattice.order > 0)
+	{
+		// reflection points at min (last reflection) and max (first reflection) crossing
+		float tMin = 1.f;
+		float tMax = 0.f;
+		for (int a = 0; a < 3; a++)
+		{
+			const int m = lattice.m[a];
+			if (m == 0) { continue; }
+			const float nearestWall = m > 0 ? size[a] : 0.f;
+			const float farthestWall = m > 0 ? m * size[a] : (m + 1) * size[a];
+			tMin = jmin(tMin, (nearestWall - listenerPosition[a]) / direction[a]);
+			tMax = jmax(tMax, (farthestWall - listenerPosition[a]) / direction[a]);
+		}
+		lastPoint = foldIntoRoom(listenerPosition + tMin * direction);
+		firstPoint = foldIntoRoom(listenerPosition + tMax * direction);
+	}
+
+	for (int a = 0; a < 3; a++)
+	{
+		values[a] = firstPoint[a];
+		values[3 + a] = lastPoint[a];
+	}
+	values[6] = direction.norm();
+	for (int k = 0; k < NUM_OCTAVE_BANDS; k++)
+	{
+		values[7 + k] = 1.f - std::pow(1.f - settings.wallAbsorption[k], (float)lattice.order);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Eigen::Vector3f SceneGenerator::foldIntoRoom(const Eigen::Vector3f& position) const
+// Map point of the unfolded (mirrored rooms) space back into the room
+{
+	Eigen::Vector3f folded;
+	for (int a = 0; a < 3; a++)
+	{
+		const float size = settings.roomSize[a];
+		float u = std::fmod(position[a], 2.f * size);
+		if (u < 0.f) { u += 2.f * size; }
+		folded[a] = u > size ? 2.f * size - u : u;
+	}
+	return folded;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+Eigen::Vector3f SceneGenerator::getPosition(const MotionPath& path, const double time) const
+{
+	if (path.radius <= 0.f || path.period <= 0.f) { return path.centre; }
+
+	const float angle = (float)(2.0 * M_PI * std::fmod(time / path.period, 1.0));
+	return path.centre + path.radius * Eigen::Vector3f(std::cos(angle), std::sin(angle), 0.f);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::addMessage(const OSCMessage& message)
+// Add message to current frame bundle (sent once full), or send it alone
+{
+	if (settings.messagesPerBundle <= 0)
+	{
+		send(message);
+		return;
+	}
+
+	if (bundleSize == 0) { bundle = OSCBundle(frameTimeTag); }
+	bundle.addElement(message);
+	bundleSize++;
+	if (bundleSize >= settings.messagesPerBundle) { flushBundle(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::flushBundle()
+{
+	if (bundleSize == 0) { return; }
+
+	if (target == nullptr) { sender.send(bundle); }
+	else if (waitForTarget()) { target->replayBundle(bundle); }
+	bundleSize = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SceneGenerator::send(const OSCMessage& message)
+{
+	if (target == nullptr) { sender.send(message); }
+	else if (waitForTarget()) { target->replayMessage(message); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SceneGenerator::waitForTarget()
+// In process target busy (large frames): packet delayed rather than dropped. False if stopping.
+{
+	while (!target->isReadyForReplay())
+	{
+		if (threadShouldExit()) { return false; }
+		wait(1);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,260 @@
+#include "SourceImageStore.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceImageStore::SourceImageStore()
+{
+	// typical scene size, grown on reception of larger ones
+	const int initialCapacity = 1024;
+	keys.reserve(initialCapacity);
+	ids.reserve(initialCapacity);
+	reflectionOrders.reserve(initialCapacity);
+	positionsFirst.reserve(3 * initialCapacity);
+	positionsLast.reserve(3 * initialCapacity);
+	pathLengths.reserve(initialCapacity);
+	delays.reserve(initialCapacity);
+	absorptions.reserve(NUM_OCTAVE_BANDS * initialCapacity);
+	sourceKeys.reserve(initialCapacity);
+	changed.reserve(initialCapacity);
+	changedKeys.reserve(initialCapacity);
+	index.reserve(2 * initialCapacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SourceImageStore::set(const int id, const int reflectionOrder, const float* positionFirst, const float* positionLast, const float pathLength, const float* absorption, const int sourceKey)
+// Image id of source sourceKey (see makeKey)
+{
+	const Key key = makeKey(sourceKey, id);
+	int slot = (int)std::distance(keys.begin(), std::lower_bound(keys.begin(), keys.end(), key));
+	if (slot < keys.size() && keys[slot] == key)
+	{
+		if (reflectionOrders[slot] == reflectionOrder && pathLengths[slot] == pathLength
+			&& std::equal(positionFirst, positionFirst + 3, positionsFirst.begin() + 3 * slot)
+			&& std::equal(positionLast, positionLast + 3, positionsLast.begin() + 3 * slot)
+			&& std::equal(absorption, absorption + NUM_OCTAVE_BANDS, absorptions.begin() + NUM_OCTAVE_BANDS * slot))
+		{
+			return false;
+		}
+	}
+	else { insertAt(slot, key); }
+
+	reflectionOrders[slot] = reflectionOrder;
+	std::copy(positionFirst, positionFirst + 3, positionsFirst.begin() + 3 * slot);
+	std::copy(positionLast, positionLast + 3, positionsLast.begin() + 3 * slot);
+	pathLengths[slot] = pathLength;
+	delays[slot] = pathLength / SOUND_SPEED;
+	std::copy(absorption, absorption + NUM_OCTAVE_BANDS, absorptions.begin() + NUM_OCTAVE_BANDS * slot);
+	flagChanged(slot);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SourceImageStore::remove(const Key key)
+// Returns false if not found
+{
+	auto it = std::lower_bound(keys.begin(), keys.end(), key);
+	if (it == keys.end() || *it != key) { return false; }
+	const int slot = (int)std::distance(keys.begin(), it);
+
+	keys.erase(it);
+	ids.erase(ids.begin() + slot);
+	reflectionOrders.erase(reflectionOrders.begin() + slot);
+	positionsFirst.erase(positionsFirst.begin() + 3 * slot, positionsFirst.begin() + 3 * (slot + 1));
+	positionsLast.erase(positionsLast.begin() + 3 * slot, positionsLast.begin() + 3 * (slot + 1));
+	pathLengths.erase(pathLengths.begin() + slot);
+	delays.erase(delays.begin() + slot);
+	absorptions.erase(absorptions.begin() + NUM_OCTAVE_BANDS * slot, absorptions.begin() + NUM_OCTAVE_BANDS * (slot + 1));
+	sourceKeys.erase(sourceKeys.begin() + slot);
+	changed.erase(changed.begin() + slot);
+	indexValid = false;
+
+	changedKeys.push_back(key);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::clear()
+// Remove all images
+{
+	changedKeys.insert(changedKeys.end(), keys.begin(), keys.end());
+
+	keys.clear();
+	ids.clear();
+	reflectionOrders.clear();
+	positionsFirst.clear();
+	positionsLast.clear();
+	pathLengths.clear();
+	delays.clear();
+	absorptions.clear();
+	sourceKeys.clear();
+	changed.clear();
+	indexValid = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int SourceImageStore::findSlot(const Key key) const
+// Hash lookup if index is up to date, binary search otherwise (store being written)
+{
+	if (indexValid)
+	{
+		const uint32 mask = (uint32)index.size() - 1;
+		for (uint32 h = (hash(key) >> indexShift) & mask; index[h] >= 0; h = (h + 1) & mask)
+		{
+			if (keys[index[h]] == key) { return index[h]; }
+		}
+		return -1;
+	}
+
+	auto it = std::lower_bound(keys.begin(), keys.end(), key);
+	if (it == keys.end() || *it != key) { return -1; }
+	return (int)std::distance(keys.begin(), it);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SourceImageStore::isChanged(const Key key) const
+// True if image added, updated or removed since last clearChanges()
+{
+	const int slot = findSlot(key);
+	if (slot >= 0) { return changed[slot] != 0; }
+	return std::find(changedKeys.begin(), changedKeys.end(), key) != changedKeys.end();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::markChanged(const Key key)
+// Report image as changed, whether or not it is (still) in store
+{
+	const int slot = findSlot(key);
+	if (slot >= 0) { flagChanged(slot); }
+	else if (std::find(changedKeys.begin(), changedKeys.end(), key) == changedKeys.end()) { changedKeys.push_back(key); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::clearChanges()
+{
+	for (Key key : changedKeys)
+	{
+		const int slot = findSlot(key);
+		if (slot >= 0) { changed[slot] = 0; }
+	}
+	changedKeys.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::syncFrom(const SourceImageStore& other)
+// Copy images changed in other, or the whole store if most of them changed
+{
+	if (4 * other.changedKeys.size() > other.keys.size())
+	{
+		copyFrom(other);
+		return;
+	}
+
+	for (Key key : other.changedKeys)
+	{
+		const int otherSlot = other.findSlot(key);
+		if (otherSlot < 0)
+		{
+			remove(key);
+			continue;
+		}
+
+		int slot = (int)std::distance(keys.begin(), std::lower_bound(keys.begin(), keys.end(), key));
+		if (slot >= keys.size() || keys[slot] != key) { insertAt(slot, key); }
+		copyImage(other, otherSlot, slot);
+	}
+	clearChanges();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::buildIndex()
+// Build key -> slot hash table, to be called once done writing the store
+{
+	int numBits = 4;
+	while ((1 << numBits) < 2 * keys.size()) { numBits++; }
+	indexShift = 32 - numBits;
+	index.assign(1 << numBits, -1);
+
+	const uint32 mask = (uint32)index.size() - 1;
+	for (int slot = 0; slot < keys.size(); slot++)
+	{
+		uint32 h = (hash(keys[slot]) >> indexShift) & mask;
+		while (index[h] >= 0) { h = (h + 1) & mask; }
+		index[h] = slot;
+	}
+	indexValid = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+int SourceImageStore::insertAt(const int slot, const Key key)
+// Insert (uninitialised) image at slot, keeping keys sorted (id and source key set from key)
+{
+	keys.insert(keys.begin() + slot, key);
+	ids.insert(ids.begin() + slot, (int)(uint32)key);
+	reflectionOrders.insert(reflectionOrders.begin() + slot, 0);
+	positionsFirst.insert(positionsFirst.begin() + 3 * slot, 3, 0.f);
+	positionsLast.insert(positionsLast.begin() + 3 * slot, 3, 0.f);
+	pathLengths.insert(pathLengths.begin() + slot, 0.f);
+	delays.insert(delays.begin() + slot, 0.f);
+	absorptions.insert(absorptions.begin() + NUM_OCTAVE_BANDS * slot, NUM_OCTAVE_BANDS, 0.f);
+	sourceKeys.insert(sourceKeys.begin() + slot, (int)(key >> 32));
+	changed.insert(changed.begin() + slot, 0);
+	indexValid = false;
+
+	return slot;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::copyImage(const SourceImageStore& other, const int otherSlot, const int slot)
+{
+	reflectionOrders[slot] = other.reflectionOrders[otherSlot];
+	std::copy(other.positionsFirst.begin() + 3 * otherSlot, other.positionsFirst.begin() + 3 * (otherSlot + 1), positionsFirst.begin() + 3 * slot);
+	std::copy(other.positionsLast.begin() + 3 * otherSlot, other.positionsLast.begin() + 3 * (otherSlot + 1), positionsLast.begin() + 3 * slot);
+	pathLengths[slot] = other.pathLengths[otherSlot];
+	delays[slot] = other.delays[otherSlot];
+	std::copy(other.absorptions.begin() + NUM_OCTAVE_BANDS * otherSlot, other.absorptions.begin() + NUM_OCTAVE_BANDS * (otherSlot + 1), absorptions.begin() + NUM_OCTAVE_BANDS * slot);
+	sourceKeys[slot] = other.sourceKeys[otherSlot];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::copyFrom(const SourceImageStore& other)
+// Copy all images (changes cleared), storage reused
+{
+	keys = other.keys;
+	ids = other.ids;
+	reflectionOrders = other.reflectionOrders;
+	positionsFirst = other.positionsFirst;
+	positionsLast = other.positionsLast;
+	pathLengths = other.pathLengths;
+	delays = other.delays;
+	absorptions = other.absorptions;
+	sourceKeys = other.sourceKeys;
+	changed.assign(keys.size(), 0);
+	changedKeys.clear();
+	indexValid = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImageStore::flagChanged(const int slot)
+{
+	if (changed[slot] != 0) { return; }
+	changed[slot] = 1;
+	changedKeys.push_back(keys[slot]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3,16 +3,46 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+SourceImagesHandler::SourceImagesHandler()
+{
+	// preallocate binaural encoders of each listener (share a single HRIR set)
+	for (int i = 0; i < maxNumListeners * numEncodersPerListener; i++)
+	{
+		binauralEncoders.add(new BinauralEncoder());
+	}
+
+	// one Ambisonic encoder / sound field rotation per possible listener
+	for (int i = 0; i < maxNumListeners; i++)
+	{
+		ambisonicEncoders.add(new AmbixEncoder());
+		ambisonicRotations.add(new AmbisonicRotation());
+	}
+
+	// one render context per possible render thread
+	for (int i = 0; i < RenderThreadPool::maxNumThreads; i++)
+	{
+		renderContexts.add(new RenderContext());
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
 void SourceImagesHandler::prepareToPlay(const unsigned int samplesPerBlockExpected, const double sampleRate)
 // Local equivalent of prepareToPlay
 {
-	// prepare buffers
-	workingBuffer.setSize(1, samplesPerBlockExpected);
-	workingBuffer.clear();
-	workingBufferTemp = workingBuffer;
-	clipboardBuffer = workingBuffer;
-	bandBuffer.setSize(NUM_OCTAVE_BANDS, samplesPerBlockExpected);
-	binauralBuffer.setSize(2, samplesPerBlockExpected);
+	// prepare render thread buffers
+	for (auto* context : renderContexts)
+	{
+		context->workingBuffer.setSize(1, samplesPerBlockExpected);
+		context->workingBuffer.clear();
+		context->workingBufferTemp = context->workingBuffer;
+		context->delayBuffer = context->workingBuffer;
+		context->listenerBuffer = context->workingBuffer;
+		context->bandBuffer.setSize(NUM_OCTAVE_BANDS, samplesPerBlockExpected);
+		context->binauralBuffer.setSize(2, samplesPerBlockExpected);
+		context->ambisonicBuffer.setSize(maxNumListeners * (2 + getNumAmbiChannels(ambisonicOrder)), samplesPerBlockExpected);
+		context->reverbBusBuffer.setSize(reverbTail.getNumBusChannels(), samplesPerBlockExpected);
+	}
 
 	// keep local copies
 	localSampleRate = sampleRate;
@@ -20,14 +50,30 @@ void SourceImagesHandler::prepareToPlay(const unsigned int samplesPerBlockExpect
 
 	// init filter bank
 	filterBank.prepareToPlay(samplesPerBlockExpected, sampleRate);
-	filterBank.setNumFilters(NUM_OCTAVE_BANDS, current->ids.size());
 
 	// init reverb tail
 	reverbTail.prepareToPlay(samplesPerBlockExpected, sampleRate);
 	tailBuffer.setSize(reverbTail.fdnOrder, samplesPerBlockExpected);
 
-	// init binaural encoder
-	binauralEncoder.prepareToPlay(samplesPerBlockExpected, sampleRate);
+	// init binaural encoders
+	for (auto* binauralEncoder : binauralEncoders)
+	{
+		binauralEncoder->prepareToPlay(samplesPerBlockExpected, sampleRate);
+	}
+
+	// init sound field rotations
+	for (auto* ambisonicRotation : ambisonicRotations)
+	{
+		ambisonicRotation->prepareToPlay(samplesPerBlockExpected, sampleRate);
+	}
+
+	// init listener offset delay lines (added as source images come, see reserveListenerOffsetLines)
+	maxListenerOffsetSamples = (int)ceil(maxListenerPathDifference / SOUND_SPEED * sampleRate);
+	for (int j = 0; j < numListenerOffsetChannels; j += listenerOffsetChunkSize)
+	{
+		getListenerOffsetLine(j).prepareToPlay(samplesPerBlockExpected, sampleRate);
+		getListenerOffsetLine(j).setSize(listenerOffsetChunkSize, maxListenerOffsetSamples + samplesPerBlockExpected + 2);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -41,312 +87,795 @@ float SourceImagesHandler::getMaxDelayFuture()
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void SourceImagesHandler::getNextAudioBlock(DelayLine<float>* delayLine, AudioBuffer<float>& ambisonicBuffer)
-// Main: loop over sources images, apply delay + room coloration + spatialization
+void SourceImagesHandler::getNextAudioBlock(const OwnedArray<DelayLine<float>>& delayLines, AudioBuffer<float>& ambisonicBuffer)
+// Main: loop over sources images, apply delay + room coloration + spatialization. delayLines
+// holds the input of each source, source images of sources without delay line are skipped.
+// ambisonicBuffer holds a group of stereo + Ambisonic channels per listener (listeners without
+// one in ambisonicBuffer are not rendered).
 {
+	// stages timed (see StageProfiler) if enabled at block start
+	isProfiling = profiler != nullptr && profiler->isEnabled();
 
 	// update crossfade mechanism
 	updateCrossfade();
 
-	// clear output buffer (since used as cumulative buffer, iteratively summing sources images buffers)
+	// listeners rendered, and whether source images go through the listener offset delay line
+	// (shared tap not necessarily at the delay of the first listener as soon as there are several)
+	const int numChannelsPerListener = 2 + getNumAmbiChannels(ambisonicOrder);
+	numRenderListeners = jmin(getNumListeners(), ambisonicBuffer.getNumChannels() / numChannelsPerListener, (int)maxNumListeners);
+	listenerOffsetLineUsed = getNumListeners() > 1;
+	numListenerOffsetImages = numListenerOffsetChannels.load(std::memory_order_acquire);
+
+	// loop over sources images (spread over render threads unless only a few of them), each
+	// thread summing its source images in its own accumulators
+	renderDelayLines = &delayLines;
+	nextImageChunk = 0;
+	int64 renderThreadWaitTicks = 0;
+	if (numSourceImages > imageChunkSize)
+	{
+		renderThreadPool.run(*this);
+		renderThreadWaitTicks = renderThreadPool.getLastWaitTicks();
+	}
+	else { runJob(0); }
+
+	for (int j = 0; j < numListenerOffsetImages && listenerOffsetLineUsed; j += listenerOffsetChunkSize)
+	{
+		getListenerOffsetLine(j).incrementWriteIndex(localSamplesPerBlockExpected);
+	}
+
+	// clear output buffer (since used as cumulative buffer, summing render threads accumulators)
 	ambisonicBuffer.clear();
+	int64 stageTicks[StageProfiler::numStages] = {};
+	stageTicks[StageProfiler::renderThreadWait] = renderThreadWaitTicks;
+	for (auto* context : renderContexts)
+	{
+		if (!context->isUsed) { continue; }
 
-	// loop over sources images
-	for (int j = 0; j < numSourceImages; j++)
+		for (int s = 0; s < StageProfiler::numStages; s++)
+		{
+			stageTicks[s] += context->stageTicks[s];
+			context->stageTicks[s] = 0;
+		}
+
+		const int numChannels = jmin(ambisonicBuffer.getNumChannels(), context->ambisonicBuffer.getNumChannels(), numRenderListeners * numChannelsPerListener);
+		for (int k = 0; k < numChannels; k++)
+		{
+			ambisonicBuffer.addFrom(k, 0, context->ambisonicBuffer, k, 0, localSamplesPerBlockExpected);
+		}
+		if (enableReverbTail) { reverbTail.addBusBuffers(context->reverbBusBuffer); }
+		context->isUsed = false;
+	}
+
+	//==========================================================================
+	// ADD REVERB TAIL (SHARED BY ALL LISTENERS)
+
+	int64 ticks = isProfiling ? StageProfiler::getTicks() : 0;
+	if (enableReverbTail)
 	{
+		// get tail buffer
+		reverbTail.extractBusToBuffer(tailBuffer);
 
-		//==========================================================================
-		// GET DELAYED BUFFER
-		float delayInFractionalSamples = 0.0;
-		if (!crossfadeOver) // Add old and new tapped delayed buffers with gain crossfade
+		// apply gain
+		tailBuffer.applyGain(reverbTailGain);
+
+		// add to ambisonic channels
+		int ambiId; int fdnId;
+		for (int l = 0; l < numRenderListeners; l++)
 		{
-			// get old delay, tap from delay line, apply gain=f(delay)
-			if (j < current->delays.size())
+			for (int k = 0; k < fmin(getNumAmbiChannels(ambisonicOrder), reverbTail.fdnOrder); k++)
 			{
-				delayInFractionalSamples = current->delays[j] * localSampleRate;
-				delayLine->fillBufferWithPreciselyDelayedChunk(workingBuffer, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected);
-				workingBuffer.applyGain(1.0 - crossfadeGain);
+				ambiId = k % 4; // only add reverb tail to WXYZ
+				fdnId = k % reverbTail.fdnOrder;
+				ambisonicBuffer.addFrom(getListenerFirstChannel(l) + 2 + ambiId, 0, tailBuffer, fdnId, 0, localSamplesPerBlockExpected);
 			}
-			else { workingBuffer.clear(); }
+		}
+	}
 
-			// get new delay, tap from delay line, apply gain=f(delay)
-			if (j < future->delays.size())
-			{
-				delayInFractionalSamples = future->delays[j] * localSampleRate;
-				delayLine->fillBufferWithPreciselyDelayedChunk(workingBufferTemp, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected);
-				workingBufferTemp.applyGain(crossfadeGain);
-			}
-			else { workingBufferTemp.clear(); }
+	if (isProfiling)
+	{
+		const int64 now = StageProfiler::getTicks();
+		stageTicks[StageProfiler::reverbTail] += enableReverbTail ? now - ticks : 0;
+		ticks = now;
+	}
 
-			// add both buffers
-			workingBuffer.addFrom(0, 0, workingBufferTemp, 0, 0, localSamplesPerBlockExpected);
-		}
-		else // simple update
+	//==========================================================================
+	// ROTATE SOUND FIELD (HEAD TRACKING)
+
+	if (enableSoundFieldRotation)
+	{
+		for (int l = 0; l < numRenderListeners; l++)
 		{
-			// get delay, tap from delay line
-			if (j < current->delays.size())
-			{
-				delayInFractionalSamples = (current->delays[j] * localSampleRate);
-				delayLine->fillBufferWithPreciselyDelayedChunk(workingBuffer, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected);
-			}
+			ambisonicRotations[l]->process(ambisonicBuffer, getListenerFirstChannel(l) + 2);
 		}
+	}
+
+	if (!isProfiling) { return; }
 
-		//==========================================================================
-		// APPLY GAIN BASED ON SOURCE IMAGE PATH LENGTH
-		float gainDelayLine = 0.0f;
-		if (!crossfadeOver)
+	// stages run this block, render threads summed
+	stageTicks[StageProfiler::soundFieldRotation] += enableSoundFieldRotation ? StageProfiler::getTicks() - ticks : 0;
+	for (int s = 0; s < StageProfiler::numStages; s++)
+	{
+		if (stageTicks[s] != 0) { profiler->addStageTime((StageProfiler::Stage)s, stageTicks[s]); }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+SourceImagesHandler::RenderCost SourceImagesHandler::getRenderCost() const
+// Multiply-adds per sample (see RenderCost), counting: 3 per linearly interpolated delay read,
+// 10 per filter bank band (biquad, remainder update, absorption / directivity gains, recompose),
+// 1 per band for the reverb tail feed, 1 per Ambisonic channel, ~100 per binaural image (FFT
+// convolution of both ears and ITD), (2l+1)^2 per order l of the sound field rotation.
+{
+	const int numListeners = jmax(1, getNumListeners());
+	const int numBands = future->numBands;
+	const int numAmbiChannels = getNumAmbiChannels(ambisonicOrder);
+	const int numBinaural = enableDirectToBinaural ? jmin(jmax(numBinauralImages, 0), (int)maxNumBinauralImages, numSourceImages) : 0;
+
+	RenderCost cost;
+
+	// delay tap, path length gain, filter bank, early / direct gain, reverb tail feed
+	cost.shared = numSourceImages * (3.0f + 1.0f + 10.0f * numBands + 1.0f + (enableReverbTail ? numBands : 0));
+
+	// delay offset read and path gain (several listeners only), encoding, tail, rotation
+	if (numListeners > 1) { cost.perListener += numSourceImages * (3.0f + 1.0f); }
+	cost.perListener += (numSourceImages - numBinaural) * numAmbiChannels + numBinaural * 100.0f;
+	if (enableReverbTail) { cost.perListener += 4.0f; }
+	if (enableSoundFieldRotation)
+	{
+		for (int l = 1; l <= ambisonicOrder; l++) { cost.perListener += (2 * l + 1) * (2 * l + 1); }
+	}
+
+	return cost;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::runJob(const int threadIndex)
+// Render thread: render chunks of source images until none left (RenderThreadPool::Job)
+{
+	RenderContext& context = *renderContexts[threadIndex];
+
+	for (int first = nextImageChunk.fetch_add(imageChunkSize); first < numSourceImages; first = nextImageChunk.fetch_add(imageChunkSize))
+	{
+		if (!context.isUsed)
 		{
-			if (j < current->pathLengths.size()) { gainDelayLine += (1.0 - crossfadeGain) * (1.0 / current->pathLengths[j]); }
-			if (j < future->pathLengths.size()) { gainDelayLine += crossfadeGain * (1.0 / future->pathLengths[j]); }
+			context.ambisonicBuffer.clear();
+			context.reverbBusBuffer.clear();
+			context.isUsed = true;
+			if (isProfiling) { context.lapTicks = StageProfiler::getTicks(); }
 		}
-		else
+
+		const int last = jmin(first + imageChunkSize, numSourceImages);
+		for (int j = first; j < last; j++) { renderSourceImage(j, context); }
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::renderSourceImage(const int j, RenderContext& context)
+// Apply delay + room coloration + spatialization to source image j, added to context
+// accumulators. Only touches state of image j (filters, binaural encoders, listener offset delay
+// line channel): thread safe.
+{
+	// only images changed by last update are crossfaded, others rendered from current state
+	const bool crossfadeImage = !crossfadeOver && (j >= future->imageChanged.size() || future->imageChanged[j]);
+
+	AudioBuffer<float>& workingBuffer = context.workingBuffer;
+	AudioBuffer<float>& workingBufferTemp = context.workingBufferTemp;
+	AudioBuffer<float>& bandBuffer = context.bandBuffer;
+	const int numBands = future->numBands; // same as current one during crossfades (see acquireUpdate)
+
+	// delay line of the source the image originates from, in past and future states
+	const OwnedArray<DelayLine<float>>& delayLines = *renderDelayLines;
+	DelayLine<float>* delayLinePast = nullptr;
+	DelayLine<float>* delayLineFuture = nullptr;
+	if (j < current->delays.size()) { delayLinePast = delayLines[j < current->sourceIndices.size() ? current->sourceIndices[j] : 0]; }
+	if (j < future->delays.size()) { delayLineFuture = delayLines[j < future->sourceIndices.size() ? future->sourceIndices[j] : 0]; }
+
+	//==========================================================================
+	// GET DELAYED BUFFER
+	float delayInFractionalSamples = 0.0;
+	if (crossfadeImage) // Add old and new tapped delayed buffers with gain crossfade
+	{
+		// get old delay, tap from delay line, apply gain=f(delay)
+		if (delayLinePast != nullptr)
 		{
-			if (j < current->pathLengths.size())
-			{
-				gainDelayLine = 1.0 / current->pathLengths[j];
-			}
+			delayInFractionalSamples = current->delays[j] * localSampleRate;
+			delayLinePast->fillBufferWithPreciselyDelayedChunk(workingBuffer, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected, context.delayBuffer);
+			workingBuffer.applyGain(1.0 - crossfadeGain);
 		}
-		workingBuffer.applyGain(fmin(1.0, fmax(0.0, gainDelayLine)));
+		else { workingBuffer.clear(); }
 
-		//==========================================================================
-		// APPLY FREQUENCY SPECIFIC GAINS (ABSORPTION, DIRECTIVITY)
+		// get new delay, tap from delay line, apply gain=f(delay)
+		if (delayLineFuture != nullptr)
+		{
+			delayInFractionalSamples = future->delays[j] * localSampleRate;
+			delayLineFuture->fillBufferWithPreciselyDelayedChunk(workingBufferTemp, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected, context.delayBuffer);
+			workingBufferTemp.applyGain(crossfadeGain);
+		}
+		else { workingBufferTemp.clear(); }
 
-		// decompose in frequency bands
-		//DBG( "Number of images sources in getNextAudioBlock = " << numSourceImages);
-		filterBank.decomposeBuffer(workingBuffer, bandBuffer, j);
+		// add both buffers
+		workingBuffer.addFrom(0, 0, workingBufferTemp, 0, 0, localSamplesPerBlockExpected);
+	}
+	else // simple update
+	{
+		// get delay, tap from delay line
+		if (delayLinePast != nullptr)
+		{
+			delayInFractionalSamples = (current->delays[j] * localSampleRate);
+			delayLinePast->fillBufferWithPreciselyDelayedChunk(workingBuffer, 0, 0, 0, delayInFractionalSamples, localSamplesPerBlockExpected, context.delayBuffer);
+		}
+		else { workingBuffer.clear(); }
+	}
 
-		// apply absorption gains and recompose
-		workingBuffer.clear();
-		float absorptionCoef, dirGain;
-		for (int k = 0; k < bandBuffer.getNumChannels(); k++)
+	//==========================================================================
+	// APPLY GAIN BASED ON SOURCE IMAGE PATH LENGTH
+	float gainDelayLine = 0.0f;
+	if (crossfadeImage)
+	{
+		if (j < current->pathLengths.size()) { gainDelayLine += (1.0 - crossfadeGain) * (1.0 / current->pathLengths[j]); }
+		if (j < future->pathLengths.size()) { gainDelayLine += crossfadeGain * (1.0 / future->pathLengths[j]); }
+	}
+	else
+	{
+		if (j < current->pathLengths.size())
 		{
-			absorptionCoef = 0.f;
-			dirGain = 0.f;
+			gainDelayLine = 1.0 / current->pathLengths[j];
+		}
+	}
+	workingBuffer.applyGain(fmin(1.0, fmax(0.0, gainDelayLine)));
+	if (isProfiling) { context.lap(StageProfiler::delayTaps); }
+
+	//==========================================================================
+	// APPLY FREQUENCY SPECIFIC GAINS (ABSORPTION, DIRECTIVITY)
+
+	// decompose in frequency bands
+	//DBG( "Number of images sources in getNextAudioBlock = " << numSourceImages);
+	filterBank.decomposeBuffer(workingBuffer, bandBuffer, j, numBands);
 
-			// apply crossfade
-			if (!crossfadeOver)
+	// apply absorption gains and recompose
+	workingBuffer.clear();
+	float absorptionCoef, dirGain;
+	for (int k = 0; k < numBands; k++)
+	{
+		absorptionCoef = 0.f;
+		dirGain = 0.f;
+
+		// apply crossfade
+		if (crossfadeImage)
+		{
+			if (j < current->absorptionCoefs.size())
 			{
-				if (j < current->absorptionCoefs.size())
-				{
-					absorptionCoef += (1.0 - crossfadeGain) * current->absorptionCoefs[j][k];
-					dirGain += (1.0 - crossfadeGain) * current->directivityGains[j][k];
-				}
-				if (j < future->absorptionCoefs.size())
-				{
-					absorptionCoef += crossfadeGain * future->absorptionCoefs[j][k];
-					dirGain += crossfadeGain * future->directivityGains[j][k];
-				}
+				absorptionCoef += (1.0 - crossfadeGain) * current->absorptionCoefs[j][k];
+				dirGain += (1.0 - crossfadeGain) * current->directivityGains[j * NUM_OCTAVE_BANDS + k];
 			}
-			else
+			if (j < future->absorptionCoefs.size())
 			{
-				if (j < current->absorptionCoefs.size())
-				{
-					absorptionCoef = current->absorptionCoefs[j][k];
-					dirGain = current->directivityGains[j][k]; // only using real part here
-				}
+				absorptionCoef += crossfadeGain * future->absorptionCoefs[j][k];
+				dirGain += crossfadeGain * future->directivityGains[j * NUM_OCTAVE_BANDS + k];
 			}
+		}
+		else
+		{
+			if (j < current->absorptionCoefs.size())
+			{
+				absorptionCoef = current->absorptionCoefs[j][k];
+				dirGain = current->directivityGains[j * NUM_OCTAVE_BANDS + k]; // only using real part here
+			}
+		}
+
+		// bound gains
+		absorptionCoef = fmin(1.0, fmax(0.0, 1.f - absorptionCoef));
+		dirGain = fmin(1.0, fmax(0.0, dirGain));
 
-			// bound gains
-			absorptionCoef = fmin(1.0, fmax(0.0, 1.f - absorptionCoef));
-			dirGain = fmin(1.0, fmax(0.0, dirGain));
+		// apply absorption gains (TODO: sometimes crashes here at startup because absorptionCoefs data is null pointer)
+		bandBuffer.applyGain(k, 0, localSamplesPerBlockExpected, absorptionCoef);
 
-			// apply absorption gains (TODO: sometimes crashes here at startup because absorptionCoefs data is null pointer)
-			bandBuffer.applyGain(k, 0, localSamplesPerBlockExpected, absorptionCoef);
+		// apply directivity gain (TODO: merge with absorption gain above)
+		bandBuffer.applyGain(k, 0, localSamplesPerBlockExpected, dirGain);
 
-			// apply directivity gain (TODO: merge with absorption gain above)
-			bandBuffer.applyGain(k, 0, localSamplesPerBlockExpected, dirGain);
+		// recompose (add-up frequency bands)
+		workingBuffer.addFrom(0, 0, bandBuffer, k, 0, localSamplesPerBlockExpected);
+	}
+	if (isProfiling) { context.lap(StageProfiler::filterBank); }
 
-			// recompose (add-up frequency bands)
-			workingBuffer.addFrom(0, 0, bandBuffer, k, 0, localSamplesPerBlockExpected);
+	//==========================================================================
+	// FEED REVERB TAIL FDN
+	if (enableReverbTail)
+	{
+		int busId = j % reverbTail.fdnOrder;
+		reverbTail.addToBus(busId, bandBuffer, numBands, context.reverbBusBuffer);
+		if (isProfiling) { context.lap(StageProfiler::reverbTail); }
+	}
+
+	//==========================================================================
+	// APPLY DIRECT PATH / EARLY GAINS
+	if (j < current->ids.size() && directPathId == current->ids[j])
+	{
+		workingBuffer.applyGain(directPathGain);
+	}
+	else
+	{
+		workingBuffer.applyGain(earlyGain);
+	}
+
+	//==========================================================================
+	// SPATIALIZATION, PER LISTENER (READ BACK AT THEIR DELAY OFFSET IF SEVERAL)
+	if (listenerOffsetLineUsed && j < numListenerOffsetImages)
+	{
+		getListenerOffsetLine(j).copyFrom(j % listenerOffsetChunkSize, workingBuffer, 0, 0, localSamplesPerBlockExpected);
+	}
+	if (isProfiling) { context.lap(StageProfiler::delayTaps); }
+
+	for (int l = 0; l < numRenderListeners; l++)
+	{
+		renderListenerImage(j, l, crossfadeImage, context);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::renderListenerImage(const int j, const int listenerIndex, const bool crossfadeImage, RenderContext& context)
+// Binaural / Ambisonic encoding of filtered source image j (context working buffer) for a
+// listener, added to its channels of context accumulators
+{
+	const int firstChannel = getListenerFirstChannel(listenerIndex);
+	const ListenerState* listenerPast = listenerIndex < current->listeners.size() ? &current->listeners[listenerIndex] : nullptr;
+	const ListenerState* listenerFuture = listenerIndex < future->listeners.size() ? &future->listeners[listenerIndex] : nullptr;
+
+	//==========================================================================
+	// DELAY OFFSET / PATH GAIN OF THIS LISTENER
+	AudioBuffer<float>& workingBuffer = context.workingBuffer;
+	AudioBuffer<float>& listenerBuffer = context.listenerBuffer;
+	AudioBuffer<float>* input = &workingBuffer;
+	if (listenerOffsetLineUsed)
+	{
+		// past and future (crossfade) offsets / gains, listener absent from a state is silent in it
+		float offsets[2] = { 0.0f, 0.0f };
+		float gains[2] = { 0.0f, 0.0f };
+		if (listenerPast != nullptr && j < listenerPast->pathGains.size())
+		{
+			offsets[0] = listenerPast->delayOffsets[j];
+			gains[0] = listenerPast->pathGains[j] * (crossfadeImage ? 1.0f - crossfadeGain : 1.0f);
+		}
+		if (crossfadeImage && listenerFuture != nullptr && j < listenerFuture->pathGains.size())
+		{
+			offsets[1] = listenerFuture->delayOffsets[j];
+			gains[1] = listenerFuture->pathGains[j] * crossfadeGain;
+		}
+		if (offsets[0] == offsets[1])
+		{
+			gains[0] += gains[1];
+			gains[1] = 0.0f;
 		}
 
-		//==========================================================================
-		// FEED REVERB TAIL FDN
-		if (enableReverbTail)
+		listenerBuffer.clear();
+		for (int k = 0; k < 2; k++)
 		{
-			int busId = j % reverbTail.fdnOrder;
-			reverbTail.addToBus(busId, bandBuffer);
+			if (gains[k] == 0.0f) { continue; }
+
+			// closest listener reads the shared tap as is
+			const float offsetInFractionalSamples = jmin(offsets[k] * (float)localSampleRate, (float)maxListenerOffsetSamples);
+			if (offsetInFractionalSamples <= 0.0f || j >= numListenerOffsetImages)
+			{
+				listenerBuffer.addFrom(0, 0, workingBuffer, 0, 0, localSamplesPerBlockExpected, gains[k]);
+				continue;
+			}
+			getListenerOffsetLine(j).fillBufferWithPreciselyDelayedChunk(context.workingBufferTemp, 0, 0, j % listenerOffsetChunkSize, offsetInFractionalSamples, localSamplesPerBlockExpected, context.delayBuffer);
+			listenerBuffer.addFrom(0, 0, context.workingBufferTemp, 0, 0, localSamplesPerBlockExpected, gains[k]);
 		}
+		input = &listenerBuffer;
+		if (isProfiling) { context.lap(StageProfiler::delayTaps); }
+	}
 
-		//==========================================================================
-		// APPLY DIRECT PATH / EARLY GAINS
-		if (j < current->ids.size() && directPathId == current->ids[j])
+	//==========================================================================
+	// BINAURAL ENCODING (DIRECT PATH + MOST ENERGETIC EARLY REFLECTIONS)
+	if (enableDirectToBinaural)
+	{
+		AudioBuffer<float>& binauralBuffer = context.binauralBuffer;
+
+		// image may enter / leave the binaural set during crossfade (same encoder if in both)
+		int encoderIds[2] = { -1, -1 };
+		float encoderGains[2] = { 0.0f, 0.0f };
+		if (listenerPast != nullptr && j < listenerPast->binauralEncoderIds.size())
 		{
-			workingBuffer.applyGain(directPathGain);
+			encoderIds[0] = listenerPast->binauralEncoderIds[j];
+			encoderGains[0] = crossfadeImage ? 1.0f - crossfadeGain : 1.0f;
 		}
-		else
+		if (crossfadeImage && listenerFuture != nullptr && j < listenerFuture->binauralEncoderIds.size())
 		{
-			workingBuffer.applyGain(earlyGain);
+			encoderIds[1] = listenerFuture->binauralEncoderIds[j];
+			encoderGains[1] = crossfadeGain;
+		}
+		if (encoderIds[0] >= 0 && encoderIds[0] == encoderIds[1])
+		{
+			encoderGains[0] = 1.0f;
+			encoderIds[1] = -1;
 		}
 
-		//==========================================================================
-		// BINAURAL ENCODING (DIRECT PATH ONLY)
-		if (enableDirectToBinaural && j < current->ids.size() && directPathId == current->ids[j])
+		float binauralGain = 0.0f;
+		for (int k = 0; k < 2; k++)
 		{
+			if (encoderIds[k] < 0) { continue; }
+
 			// apply filter
-			binauralEncoder.encodeBuffer(workingBuffer, binauralBuffer);
+			binauralEncoders[encoderIds[k]]->encodeBuffer(*input, binauralBuffer);
 
 			// manual loudness normalization (todo: handle this during hrir filter creation)
-			binauralBuffer.applyGain(3.7f);
+			binauralBuffer.applyGain(3.7f * encoderGains[k]);
 
 			// add to output
-			ambisonicBuffer.copyFrom(0, 0, binauralBuffer, 0, 0, localSamplesPerBlockExpected);
-			ambisonicBuffer.copyFrom(1, 0, binauralBuffer, 1, 0, localSamplesPerBlockExpected);
+			context.ambisonicBuffer.addFrom(firstChannel, 0, binauralBuffer, 0, 0, localSamplesPerBlockExpected);
+			context.ambisonicBuffer.addFrom(firstChannel + 1, 0, binauralBuffer, 1, 0, localSamplesPerBlockExpected);
 
-			// skip remaining (ambisonic encoding)
-			continue;
+			binauralGain += encoderGains[k];
 		}
 
-		//==========================================================================
-		// AMBISONIC ENCODING
-
-		// keep local copy since working buffer will be used to store ambisonic buffers
-		clipboardBuffer = workingBuffer;
+		if (isProfiling) { context.lap(StageProfiler::binauralEncoding); }
 
-		for (int k = 0; k < N_AMBI_CH; k++)
-		{
-			// create working copy
-			workingBuffer = clipboardBuffer;
-
-			if (!crossfadeOver)
-			{
-				// create 2nd working copy
-				workingBufferTemp = clipboardBuffer;
-
-				// apply ambisonic gain past
-				if (j < current->ambisonicGains.size())
-				{
-					workingBuffer.applyGain((1.0 - crossfadeGain) * current->ambisonicGains[j][k]);
-				}
-
-				// apply ambisonic gain future
-				if (j < future->ambisonicGains.size())
-				{
-					workingBufferTemp.applyGain(crossfadeGain * future->ambisonicGains[j][k]);
-				}
-
-				// add past / future buffers
-				workingBuffer.addFrom(0, 0, workingBufferTemp, 0, 0, localSamplesPerBlockExpected);
-			}
-			else
-			{
-				// apply ambisonic gain
-				if (j < current->ambisonicGains.size())
-				{
-					workingBuffer.applyGain(current->ambisonicGains[j][k]);
-				}
-			}
+		// skip remaining (ambisonic encoding)
+		if (binauralGain >= 1.0f) { return; }
 
-			// iteratively fill in general ambisonic buffer with source image buffers (cumulative)
-			ambisonicBuffer.addFrom(2 + k, 0, workingBuffer, 0, 0, localSamplesPerBlockExpected);
-		}
+		// otherwise, image is crossfaded between binaural and Ambisonic encoding (working buffer
+		// is only modified if no other listener reads it)
+		if (binauralGain > 0.0f) { input->applyGain(1.0f - binauralGain); }
 	}
 
 	//==========================================================================
-	// ADD REVERB TAIL
+	// AMBISONIC ENCODING
 
-	if (enableReverbTail)
+	encodeAmbisonic(j, listenerIndex, crossfadeImage, *input, context.ambisonicBuffer);
+	if (isProfiling) { context.lap(StageProfiler::ambisonicEncoding); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <int NumAmbiChannels>
+void SourceImagesHandler::addToAmbisonicBuffer(const int j, const int listenerIndex, const bool crossfade, const AudioBuffer<float>& input, AudioBuffer<float>& ambisonicBuffer)
+// Ambisonic encoding kernel, number of channels known at compile time: past / future gains
+// merged (crossfade) then input added to each channel of the listener with its gain.
+{
+	static_assert(NumAmbiChannels <= N_AMBI_CH, "Ambisonic order above AMBI_ORDER");
+
+	float gains[NumAmbiChannels];
+	std::fill(gains, gains + NumAmbiChannels, 0.0f);
+
+	// gains computed for another order (changed since) are ignored, as are those of a listener
+	// absent from a state
+	const ListenerState* listenerPast = listenerIndex < current->listeners.size() ? &current->listeners[listenerIndex] : nullptr;
+	const ListenerState* listenerFuture = listenerIndex < future->listeners.size() ? &future->listeners[listenerIndex] : nullptr;
+	const bool hasGainsPast = listenerPast != nullptr && j < current->ids.size() && listenerPast->ambisonicGains.size() == current->ids.size() * NumAmbiChannels;
+	const bool hasGainsFuture = crossfade && listenerFuture != nullptr && j < future->ids.size() && listenerFuture->ambisonicGains.size() == future->ids.size() * NumAmbiChannels;
+
+	if (hasGainsPast)
 	{
-		// get tail buffer
-		reverbTail.extractBusToBuffer(tailBuffer);
+		const float gainPast = crossfade ? 1.0f - crossfadeGain : 1.0f;
+		const float* gainsPast = listenerPast->ambisonicGains.data() + j * NumAmbiChannels;
+		for (int k = 0; k < NumAmbiChannels; k++) { gains[k] += gainPast * gainsPast[k]; }
+	}
+	if (hasGainsFuture)
+	{
+		const float* gainsFuture = listenerFuture->ambisonicGains.data() + j * NumAmbiChannels;
+		for (int k = 0; k < NumAmbiChannels; k++) { gains[k] += crossfadeGain * gainsFuture[k]; }
+	}
 
-		// apply gain
-		tailBuffer.applyGain(reverbTailGain);
+	// skip channels of orders zeroed by spreading (in both past and future gains)
+	int numChannels = 0;
+	if (hasGainsPast)
+	{
+		numChannels = j < listenerPast->ambisonicNumChannels.size() ? listenerPast->ambisonicNumChannels[j] : NumAmbiChannels;
+	}
+	if (hasGainsFuture)
+	{
+		numChannels = jmax(numChannels, j < listenerFuture->ambisonicNumChannels.size() ? listenerFuture->ambisonicNumChannels[j] : NumAmbiChannels);
+	}
 
-		// add to ambisonic channels
-		int ambiId; int fdnId;
-		for (int k = 0; k < fmin(N_AMBI_CH, reverbTail.fdnOrder); k++)
-		{
-			ambiId = k % 4; // only add reverb tail to WXYZ
-			fdnId = k % reverbTail.fdnOrder;
-			ambisonicBuffer.addFrom(2 + ambiId, 0, tailBuffer, fdnId, 0, localSamplesPerBlockExpected);
-		}
+	// iteratively fill in general ambisonic buffer with source image buffers (cumulative)
+	const int firstChannel = getListenerFirstChannel(listenerIndex) + 2;
+	const float* inputSamples = input.getReadPointer(0);
+	for (int k = 0; k < numChannels; k++)
+	{
+		FloatVectorOperations::addWithMultiply(ambisonicBuffer.getWritePointer(firstChannel + k), inputSamples, gains[k], localSamplesPerBlockExpected);
 	}
+}
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::encodeAmbisonic(const int j, const int listenerIndex, const bool crossfade, const AudioBuffer<float>& input, AudioBuffer<float>& ambisonicBuffer)
+// Dispatch to the encoding kernel specialised for current order
+{
+	switch (ambisonicOrder)
+	{
+		case 1: addToAmbisonicBuffer<4>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 2: addToAmbisonicBuffer<9>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 3: addToAmbisonicBuffer<16>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 4: addToAmbisonicBuffer<25>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 5: addToAmbisonicBuffer<36>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 6: addToAmbisonicBuffer<49>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		case 7: addToAmbisonicBuffer<64>(j, listenerIndex, crossfade, input, ambisonicBuffer); break;
+		default: jassertfalse; break;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 void SourceImagesHandler::updateFromOscHandler(OSCHandler& oscHandler)
-// Update local attributes based on latest received OSC info
+// Scene thread: compute next render state based on latest received OSC info, published to the
+// audio thread (see acquireUpdate). Must only be called if isReadyForUpdate(). Only source images
+// changed since last update are recomputed, the others are copied from current state.
 {
-	// method should not be called while crossfade active.
-	// called by MainContentComponent::updateOnOscReveive that checks if crossfadeOver == true.
-	// should not need: if( !crossfadeOver ){ return; }
+	jassert(readyForUpdate);
+
+	Span<SourceImageStore::Key> ids = oscHandler.getSourceImageKeys();
+	next->ids.assign(ids.begin(), ids.end());
+	directPathId = oscHandler.getDirectPathKey();
+	next->numSources = jlimit(1, (int)maxNumSources, oscHandler.getNumSources());
+
+	const int numImages = (int)next->ids.size();
+	const int numAmbiChannels = getNumAmbiChannels(ambisonicOrder);
+	const int numListeners = jlimit(1, (int)maxNumListeners, oscHandler.getNumListeners());
+
+	// shared tap at the delay of the closest listener, each listener reading on from there
+	next->listeners.resize(numListeners);
+	listenerPathLengths.resize(numListeners);
+	for (int l = 0; l < numListeners; l++)
+	{
+		oscHandler.getSourceImagePathLengths(listenerPathLengths[l], l);
+	}
+	if (numListeners == 1)
+	{
+		Span<float> delays = oscHandler.getSourceImageDelays();
+		next->delays.assign(delays.begin(), delays.end());
+		next->pathLengths = listenerPathLengths[0];
+	}
+	else
+	{
+		next->pathLengths = listenerPathLengths[0];
+		for (int l = 1; l < numListeners; l++)
+		{
+			for (int j = 0; j < numImages; j++) { next->pathLengths[j] = fmin(next->pathLengths[j], listenerPathLengths[l][j]); }
+		}
+		next->delays.resize(numImages);
+		for (int j = 0; j < numImages; j++) { next->delays[j] = next->pathLengths[j] / SOUND_SPEED; }
+	}
+	for (int l = 0; l < numListeners; l++)
+	{
+		updateListenerPaths(l);
+	}
+
+	// source / listener motion and parameter changes affect all source images, as does an
+	// Ambisonic order change or a listener added / removed
+	bool updateAll = oscHandler.isFullUpdateRequired() || oscHandler.hasSourceChanged() || oscHandler.hasListenerMoved()
+		|| (oscHandler.hasListenerRotated() && !enableSoundFieldRotation)
+		|| current->listeners.size() != numListeners || current->numBands != numFreqBands;
+	for (int l = 0; l < current->listeners.size() && !updateAll; l++)
+	{
+		updateAll = current->listeners[l].ambisonicGains.size() != current->ids.size() * numAmbiChannels;
+	}
+
+	next->absorptionCoefs.resize(numImages);
+	next->directivityGains.resize(numImages * NUM_OCTAVE_BANDS);
+	next->imageChanged.resize(numImages);
+	next->sourceIndices.resize(numImages);
+	for (auto& listener : next->listeners)
+	{
+		listener.ambisonicGains.resize(numImages * numAmbiChannels);
+		listener.ambisonicNumChannels.resize(numImages);
+	}
 
-	future->ids = oscHandler.getSourceImageIDs();
-	
+	// match source images with current state (ids sorted in both): copy unchanged ones
+	changedIndices.clear();
+	int i = 0;
+	for (int j = 0; j < numImages; j++)
+	{
+		const SourceImageStore::Key id = next->ids[j];
+		while (i < current->ids.size() && current->ids[i] < id) { i++; }
 
+		if (updateAll || i >= current->ids.size() || current->ids[i] != id || oscHandler.isSourceImageChanged(id))
+		{
+			changedIndices.push_back(j);
+			next->imageChanged[j] = 1;
+			continue;
+		}
 
-	//DBG("current->ids :");
-	//for(auto id : current->ids)
-	//{
-	//	DBG(id);
-	//}
+		next->absorptionCoefs[j].clearQuick();
+		next->absorptionCoefs[j].addArray(current->absorptionCoefs[i]);
+		std::copy(current->directivityGains.begin() + i * NUM_OCTAVE_BANDS, current->directivityGains.begin() + (i + 1) * NUM_OCTAVE_BANDS, next->directivityGains.begin() + j * NUM_OCTAVE_BANDS);
+		next->sourceIndices[j] = current->sourceIndices[i]; // source changes are full updates
+		for (int l = 0; l < numListeners; l++) // same listeners (otherwise full update)
+		{
+			const ListenerState& listenerCurrent = current->listeners[l];
+			ListenerState& listenerNext = next->listeners[l];
+			std::copy(listenerCurrent.ambisonicGains.begin() + i * numAmbiChannels, listenerCurrent.ambisonicGains.begin() + (i + 1) * numAmbiChannels, listenerNext.ambisonicGains.begin() + j * numAmbiChannels);
+			listenerNext.ambisonicNumChannels[j] = listenerCurrent.ambisonicNumChannels[i];
+		}
 
-	//DBG("future->ids :");
-	//for(auto id : future->ids)
-	//{
-	//	DBG(id);
-	//}
-	
-	future->delays = oscHandler.getSourceImageDelays();
-	future->pathLengths = oscHandler.getSourceImagePathsLength();
-	directPathId = oscHandler.getDirectPathId();
+		// unchanged image moved to another index (images added / removed before it) is crossfaded
+		next->imageChanged[j] = (i != j) ? 1 : 0;
+	}
+	const int numChanged = (int)changedIndices.size();
 
-	// update absorption coefficients
-	future->absorptionCoefs.resize(future->ids.size());
-	for (int j = 0; j < future->ids.size(); j++)
+	// update absorption coefficients and originating source
+	for (int j : changedIndices)
 	{
-		future->absorptionCoefs[j] = oscHandler.getSourceImageAbsorption(future->ids[j]);
-		if (filterBank.numOctaveBands == 3)
+		next->sourceIndices[j] = jmin(oscHandler.getSourceImageSourceIndex(next->ids[j]), maxNumSources - 1);
+
+		Span<float> absorption = oscHandler.getSourceImageAbsorption(next->ids[j]);
+		next->absorptionCoefs[j].clearQuick();
+		next->absorptionCoefs[j].addArray(absorption.data(), absorption.size());
+		if (numFreqBands == 3)
 		{
-			future->absorptionCoefs[j] = from10to3bands(future->absorptionCoefs[j]);
+			next->absorptionCoefs[j] = from10to3bands(next->absorptionCoefs[j]);
 		}
 	}
 
-	// update directivity gains
-	auto sourceImageDODs = oscHandler.getSourceImageDODs();
+	// update directivity gains: changed images grouped by source, so that the directivity pattern
+	// of each source is evaluated once for all its images
+	changedBySource.resize(numChanged);
+	for (int c = 0; c < numChanged; c++) { changedBySource[c] = c; }
+	std::sort(changedBySource.begin(), changedBySource.end(), [this](int a, int b)
+	{
+		const int sourceA = next->sourceIndices[changedIndices[a]];
+		const int sourceB = next->sourceIndices[changedIndices[b]];
+		return sourceA < sourceB || (sourceA == sourceB && a < b);
+	});
+	dodAzims.resize(numChanged);
+	dodElevs.resize(numChanged);
+	for (int c = 0; c < numChanged; c++)
+	{
+		Eigen::Vector3f sourceImageDOD = oscHandler.getSourceImageDOD(next->ids[changedIndices[changedBySource[c]]], true);
+		dodAzims[c] = sourceImageDOD(0);
+		dodElevs[c] = sourceImageDOD(1);
+	}
+	changedGains.resize(numChanged * NUM_OCTAVE_BANDS);
+	for (int first = 0, last = 0; first < numChanged; first = last)
+	{
+		const int sourceIndex = next->sourceIndices[changedIndices[changedBySource[first]]];
+		while (last < numChanged && next->sourceIndices[changedIndices[changedBySource[last]]] == sourceIndex) { last++; }
+
+		// directions of departure in world frame, pattern rotated to the source orientation
+		DirectivityHandler& sourceDirectivity = getSourceDirectivity(sourceIndex);
+		sourceDirectivity.useSphericalHarmonics = useSphericalHarmonicDirectivity;
+		sourceDirectivity.setOrientation(oscHandler.getSourceRotationMatrix(sourceIndex).transpose());
+		sourceDirectivity.getGains(dodAzims.data() + first, dodElevs.data() + first, last - first, numFreqBands, changedGains.data() + first * NUM_OCTAVE_BANDS, NUM_OCTAVE_BANDS);
+	}
+	for (int c = 0; c < numChanged; c++)
+	{
+		const int j = changedIndices[changedBySource[c]];
+		std::copy(changedGains.begin() + c * NUM_OCTAVE_BANDS, changedGains.begin() + (c + 1) * NUM_OCTAVE_BANDS, next->directivityGains.begin() + j * NUM_OCTAVE_BANDS);
+	}
 
-	future->directivityGains.resize(future->ids.size());
-	for (int j = 0; j < future->ids.size(); j++)
+	// update reverb tail (even if not enabled, not cpu demanding and that way it's ready to use)
+	if (updateAll || oscHandler.hasRT60Changed())
 	{
-		future->directivityGains[j] = directivityHandler.getGains(sourceImageDODs[j](0), sourceImageDODs[j](1));
-		if (filterBank.numOctaveBands == 3)
+		fdnGains = reverbTail.getFdnGains(oscHandler.getRT60Values());
+	}
+	next->fdnGains = fdnGains;
+	next->numBands = numFreqBands;
+
+	// save (compute) new Ambisonic gains of each listener, in world frame if sound field is
+	// rotated afterwards
+	changedIds.resize(numChanged);
+	for (int c = 0; c < numChanged; c++) { changedIds[c] = next->ids[changedIndices[c]]; }
+
+	// encoder gain caches keep unchanged images, only those that disappeared are released (as are
+	// all those of listeners removed)
+	removedIds.clear();
+	std::set_difference(current->ids.begin(), current->ids.end(), next->ids.begin(), next->ids.end(), std::back_inserter(removedIds));
+	for (int l = numListeners; l < current->listeners.size(); l++) { ambisonicEncoders[l]->clearGainCache(); }
+	doaAzims.resize(numChanged);
+	doaElevs.resize(numChanged);
+	spreads.resize(numChanged);
+	changedNumChannels.resize(numChanged);
+	for (int l = 0; l < numListeners; l++)
+	{
+		ambisonicRotations[l]->setRotation(oscHandler.getListenerRotationMatrix(l), !enableSoundFieldRotation);
+
+		for (int c = 0; c < numChanged; c++)
+		{
+			Eigen::Vector3f ambisonicDOA = oscHandler.getSourceImageDOA(changedIds[c], enableSoundFieldRotation, l);
+			doaAzims[c] = ambisonicDOA(0);
+			doaElevs[c] = ambisonicDOA(1);
+		}
+		changedGains.resize(numChanged * numAmbiChannels);
+		ambisonicEncoders[l]->releaseGains(removedIds.data(), (int)removedIds.size());
+		ambisonicEncoders[l]->calcParams(changedIds.data(), doaAzims.data(), doaElevs.data(), numChanged, changedGains.data());
+
+		// spread source images based on their reflection order and path length
+		for (int c = 0; c < numChanged; c++)
 		{
-			future->directivityGains[j] = from10to3bands(future->directivityGains[j]);
+			const int j = changedIndices[c];
+			const int reflectionOrder = oscHandler.getSourceImageReflectionOrder(next->ids[j]);
+			spreads[c] = spreadFactor * (1.0f - std::exp(-reflectionOrder * listenerPathLengths[l][j] / spreadDistance));
 		}
+		ambisonicEncoders[l]->applySpread(spreads.data(), numChanged, changedGains.data(), changedNumChannels.data());
+
+		ListenerState& listenerNext = next->listeners[l];
+		for (int c = 0; c < numChanged; c++)
+		{
+			std::copy(changedGains.begin() + c * numAmbiChannels, changedGains.begin() + (c + 1) * numAmbiChannels, listenerNext.ambisonicGains.begin() + changedIndices[c] * numAmbiChannels);
+			listenerNext.ambisonicNumChannels[changedIndices[c]] = changedNumChannels[c];
+		}
+
+		// update binaural encoders (even if not enabled, not cpu demanding and that way it's ready to use)
+		updateBinauralEncoders(oscHandler, l, updateAll || oscHandler.hasListenerRotated());
 	}
 
-	// update reverb tail (even if not enabled, not cpu demanding and that way it's ready to use)
-	reverbTail.updateInternals(oscHandler.getRT60Values());
+	// filter banks / listener offset delay lines of new source images, allocated before the audio
+	// thread gets to them
+	filterBank.reserve(numImages);
+	if (numListeners > 1) { reserveListenerOffsetLines(numImages); }
 
-	// save (compute) new Ambisonic gains
-	auto sourceImageDOAs = oscHandler.getSourceImageDOAs();
+	// hand over to audio thread, no further update until crossfade towards it is over
+	readyForUpdate = false;
+	states.publish();
+	next = &states.getWriteBuffer();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
-	future->ambisonicGains.resize(future->ids.size());
-	for (int i = 0; i < future->ids.size(); i++)
+void SourceImagesHandler::updateListenerPaths(const int listenerIndex)
+// Delay offset and path gain of a listener, relative to the shared tap (see updateFromOscHandler)
+{
+	const std::vector<float>& pathLengths = listenerPathLengths[listenerIndex];
+	ListenerState& listenerNext = next->listeners[listenerIndex];
+	const int numImages = (int)next->ids.size();
+	listenerNext.delayOffsets.resize(numImages);
+	listenerNext.pathGains.resize(numImages);
+
+	// same bounds as path length gain of the shared tap (see renderSourceImage)
+	auto pathGain = [](const float pathLength) { return fmin(1.0f, 1.0f / fmax(pathLength, 1e-6f)); };
+	for (int j = 0; j < numImages; j++)
 	{
-		future->ambisonicGains[i] = ambisonicEncoder.calcParams(sourceImageDOAs[i](0), sourceImageDOAs[i](1));
+		listenerNext.delayOffsets[j] = fmax(0.0f, pathLengths[j] - next->pathLengths[j]) / SOUND_SPEED;
+		listenerNext.pathGains[j] = pathGain(pathLengths[j]) / pathGain(next->pathLengths[j]);
 	}
+}
 
-	// update binaural encoder (even if not enabled, not cpu demanding and that way it's ready to use)
-	if (current->ids.size() > 0 && directPathId > -1)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::reserveListenerOffsetLines(const int numImages)
+// Scene thread: listener offset delay lines of source images up to numImages (never freed, images
+// beyond the max number of source images read the shared tap as is, see renderListenerImage)
+{
+	const int numRequired = jmin(numImages, (int)FilterBank::maxNumSourceImages);
+	int numChannels = numListenerOffsetChannels.load(std::memory_order_relaxed);
+	if (numChannels >= numRequired) { return; }
+
+	while (numChannels < numRequired)
 	{
-		int directPathIndex = distance(future->ids.begin(), find(future->ids.begin(), future->ids.end(), directPathId));
-		binauralEncoder.setPosition(sourceImageDOAs[directPathIndex](0), sourceImageDOAs[directPathIndex](1));
+		DelayLine<float>* delayLine = new DelayLine<float>();
+		delayLine->prepareToPlay(localSamplesPerBlockExpected, localSampleRate);
+		delayLine->setSize(listenerOffsetChunkSize, maxListenerOffsetSamples + localSamplesPerBlockExpected + 2);
+		listenerOffsetLines[numChannels / listenerOffsetChunkSize].reset(delayLine);
+		numChannels += listenerOffsetChunkSize;
 	}
+	numListenerOffsetChannels.store(numChannels, std::memory_order_release);
+}
 
-	// update filter bank size
-	//DBG("filterBank.setNumFilters(filterBank.numOctaveBands, " << (int) future->ids.size() << ");");
-	filterBank.setNumFilters(filterBank.numOctaveBands, future->ids.size());
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SourceImagesHandler::acquireUpdate()
+// Audio thread: start crossfade towards latest published render state, if any and if previous
+// crossfade is over. Returns true if a new state has been acquired.
+{
+	if (!crossfadeOver || !states.acquire()) { return false; }
 
 	// trigger crossfade mechanism: default
+	future = &states.getReadBuffer();
 	crossfadeOver = false;
-	//numSourceImages = max(current->ids.size(), future->ids.size());
 	numSourceImages = future->ids.size();
 	crossfadeGain = 0.0;
 
+	// reverb tail FDN gains switched at once
+	reverbTail.setFdnGains(future->fdnGains);
+
+	// band layout change: filters and absorption coefficients of current state are not in it,
+	// switch to new state at once (crossfade ended at next block start, see updateCrossfade)
+	if (future->numBands != current->numBands) { crossfadeGain = 1.0; }
+
 	// crossfade mechanism: zero image source scenario (make sure MainComponent continues to play unprocessed input)
 	if (future->ids.size() == 0) {
 		crossfadeGain = 1.0;
@@ -354,14 +883,188 @@ void SourceImagesHandler::updateFromOscHandler(OSCHandler& oscHandler)
 		numSourceImages = 0;
 	}
 
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void SourceImagesHandler::setFilterBankSize(const unsigned int numFreqBands)
+bool SourceImagesHandler::updateListenerOrientation(OSCHandler& oscHandler)
+// Head tracking update: rotate sound field and move binaural images, source images left
+// untouched. Returns false if a full update (updateFromOscHandler) is required instead.
 {
-	filterBank.setNumFilters(numFreqBands, current->ids.size());
-	bandBuffer.setSize(numFreqBands, localSamplesPerBlockExpected);
+	// current is stable (and not written by audio thread) while ready for update
+	if (!enableSoundFieldRotation || !readyForUpdate) { return false; }
+	Span<SourceImageStore::Key> ids = oscHandler.getSourceImageKeys();
+	if (ids.size() != current->ids.size() || !std::equal(ids.begin(), ids.end(), current->ids.begin())) { return false; }
+	if (current->listeners.size() != jlimit(1, (int)maxNumListeners, oscHandler.getNumListeners())) { return false; }
+
+	for (int l = 0; l < current->listeners.size(); l++)
+	{
+		ambisonicRotations[l]->setRotation(oscHandler.getListenerRotationMatrix(l), false);
+
+		// binaural encoders use head related directions, handed over like the rotation (encoders
+		// render meanwhile, new HRIR filters applied at their next block, see setTargetPosition)
+		const std::vector<int>& binauralEncoderIds = current->listeners[l].binauralEncoderIds;
+		oscHandler.getSourceImageDOAs(headDOAs, l);
+		for (int j = 0; j < binauralEncoderIds.size(); j++)
+		{
+			int encoderId = binauralEncoderIds[j];
+			if (encoderId >= 0)
+			{
+				binauralEncoders[encoderId]->setTargetPosition(headDOAs[j](0), headDOAs[j](1), false);
+			}
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::setFilterBankSize(const int numBands)
+// Number of frequency bands of the filter bank (3 or 10). To be called while holding the scene lock
+// (see OSCHandler::getSceneLock), applied at next update (full update required).
+{
+	numFreqBands = numBands == 3 ? 3 : NUM_OCTAVE_BANDS;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SourceImagesHandler::setSourceDirectivity(const int sourceIndex, const String& filename)
+// Directivity pattern of a single source, others keep the default one (directivityHandler). To be
+// called while holding the scene lock (see OSCHandler::getSceneLock), applied at next update.
+// False if the file failed to load (source then omni).
+{
+	if (sourceIndex < 0 || sourceIndex >= maxNumSources) { return false; }
+
+	while (sourceDirectivityHandlers.size() <= sourceIndex) { sourceDirectivityHandlers.add(nullptr); }
+	sourceDirectivityHandlers.set(sourceIndex, new DirectivityHandler());
+	return sourceDirectivityHandlers[sourceIndex]->loadFile(filename);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+DirectivityHandler& SourceImagesHandler::getSourceDirectivity(const int sourceIndex)
+{
+	DirectivityHandler* sourceDirectivity = sourceDirectivityHandlers[sourceIndex];
+	return sourceDirectivity != nullptr ? *sourceDirectivity : directivityHandler;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::setAmbisonicOrder(const int order)
+// Not thread safe: to be called while audio is stopped (see MainComponent::prepareToPlay)
+{
+	if (order == ambisonicOrder) { return; }
+
+	ambisonicOrder = order;
+	for (int l = 0; l < maxNumListeners; l++)
+	{
+		ambisonicEncoders[l]->setOrder(order);
+		ambisonicRotations[l]->setOrder(order);
+	}
+
+	// gains of previous order are meaningless, images fade back in at next update
+	for (auto* state : { current, future })
+	{
+		for (auto& listener : state->listeners)
+		{
+			listener.ambisonicGains.clear();
+			listener.ambisonicNumChannels.clear();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::setBinauralCrossfadeStep(const float step)
+{
+	for (auto* binauralEncoder : binauralEncoders)
+	{
+		binauralEncoder->crossfadeStep = step;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SourceImagesHandler::updateBinauralEncoders(OSCHandler& oscHandler, const int listenerIndex, const bool updateAllPositions)
+// Select the source images rendered binaurally for a listener (direct path first, then the most
+// energetic ones) and assign them encoders from the listener pool. Encoder positions only updated
+// for changed images, unless updateAllPositions.
+{
+	int numImages = (int)next->ids.size();
+	int numSelected = jmin(jmax(numBinauralImages, 0), maxNumBinauralImages, numImages);
+	const std::vector<float>& pathLengths = listenerPathLengths[listenerIndex];
+	const ListenerState* listenerCurrent = listenerIndex < current->listeners.size() ? &current->listeners[listenerIndex] : nullptr;
+	ListenerState& listenerNext = next->listeners[listenerIndex];
+
+	// rank source images on their energy at listener position (spreading loss, absorption, directivity)
+	binauralEnergies.resize(numImages);
+	for (int j = 0; j < numImages; j++)
+	{
+		if (next->ids[j] == directPathId) { binauralEnergies[j] = std::numeric_limits<float>::max(); continue; }
+
+		int numBands = jmin(next->absorptionCoefs[j].size(), numFreqBands);
+		float bandEnergy = 0.f;
+		for (int k = 0; k < numBands; k++)
+		{
+			float gain = (1.f - next->absorptionCoefs[j][k]) * next->directivityGains[j * NUM_OCTAVE_BANDS + k];
+			bandEnergy += gain * gain;
+		}
+		binauralEnergies[j] = bandEnergy / jmax(1, numBands) / fmax(pathLengths[j] * pathLengths[j], 1e-6f);
+	}
+	binauralSelected.resize(numImages);
+	for (int j = 0; j < numImages; j++) { binauralSelected[j] = j; }
+	std::partial_sort(binauralSelected.begin(), binauralSelected.begin() + numSelected, binauralSelected.end(),
+		[this](int a, int b) { return binauralEnergies[a] > binauralEnergies[b]; });
+
+	// encoders still in use by current images are not available (current is stable, see updateFromOscHandler)
+	const int firstEncoderId = listenerIndex * numEncodersPerListener;
+	binauralEncoderInUse.assign(numEncodersPerListener, false);
+	if (listenerCurrent != nullptr)
+	{
+		for (int encoderId : listenerCurrent->binauralEncoderIds)
+		{
+			if (encoderId >= 0) { binauralEncoderInUse[encoderId - firstEncoderId] = true; }
+		}
+	}
+
+	// keep encoder of images that stay at the same index (smooth HRTF crossfade), assign free
+	// encoders to the others (no crossfade: encoder output is faded-in by the main crossfade)
+	listenerNext.binauralEncoderIds.assign(numImages, -1);
+	for (int s = 0; s < numSelected; s++)
+	{
+		const int j = binauralSelected[s];
+		int encoderId = -1;
+		bool isNewEncoder = false;
+		if (listenerCurrent != nullptr && j < current->ids.size() && j < listenerCurrent->binauralEncoderIds.size() && current->ids[j] == next->ids[j])
+		{
+			encoderId = listenerCurrent->binauralEncoderIds[j];
+		}
+		if (encoderId < 0)
+		{
+			encoderId = firstEncoderId + (int)std::distance(binauralEncoderInUse.begin(), std::find(binauralEncoderInUse.begin(), binauralEncoderInUse.end(), false));
+			binauralEncoderInUse[encoderId - firstEncoderId] = true;
+			isNewEncoder = true;
+		}
+
+		// encoders render meanwhile: HRIR filters handed over, applied at their next block
+		if (isNewEncoder || updateAllPositions || oscHandler.isSourceImageChanged(next->ids[j]))
+		{
+			Eigen::Vector3f sourceImageDOA = oscHandler.getSourceImageDOA(next->ids[j], false, listenerIndex);
+			binauralEncoders[encoderId]->setTargetPosition(sourceImageDOA(0), sourceImageDOA(1), isNewEncoder);
+		}
+		listenerNext.binauralEncoderIds[j] = encoderId;
+	}
+
+	// image entering / leaving the binaural set is crossfaded (encoding changed)
+	for (int j = 0; j < numImages; j++)
+	{
+		if (listenerCurrent == nullptr || j >= listenerCurrent->binauralEncoderIds.size() || listenerNext.binauralEncoderIds[j] != listenerCurrent->binauralEncoderIds[j])
+		{
+			next->imageChanged[j] = 1;
+		}
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -378,13 +1081,15 @@ void SourceImagesHandler::updateCrossfade()
 	// or stop crossfade mechanism if not already stopped
 	else if (!crossfadeOver)
 	{
-		// set past = future
-		// (objective: atomic swap to make sure no value is updated in middle of audio processing loop)
-		std::swap(current, future);
+		// set past = future (previous current buffer released to the triple buffer)
+		current = future;
 
 		// reset crossfade internals
 		crossfadeGain = 1.0; // just to make sure for the last loop using crossfade gain
 		crossfadeOver = true;
+
+		// scene thread may now write next state
+		readyForUpdate = true;
 	}
 }
 
@@ -0,0 +1,261 @@
+#include "StageProfiler.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+StageProfiler::StageProfiler() :
+	Thread("Stage profiler")
+{
+	for (int s = 0; s < numStages; s++)
+	{
+		for (int b = 0; b < numBuckets; b++)
+		{
+			counters[s].histogram[b] = 0;
+			previousHistograms[s][b] = 0;
+		}
+		counters[s].totalTicks = 0;
+		counters[s].maxTicks = 0;
+		previousTotalTicks[s] = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+StageProfiler::~StageProfiler()
+{
+	setEnabled(false);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::setEnabled(const bool enable)
+// Start / stop timing and publishing (blocks timed before enabling are not published)
+{
+	if (enable == isEnabled()) { return; }
+
+	if (enable)
+	{
+		getTicksPerSecond(); // calibrated here rather than on the audio thread
+		enabled.store(true, std::memory_order_release);
+		startThread(2); // low priority
+		return;
+	}
+
+	enabled.store(false, std::memory_order_release);
+	stopThread(2 * publishInterval);
+
+	const ScopedLock lock(summaryLock);
+	summary.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StageProfiler::setOscTarget(const String& host, const int port)
+// Send /stats messages to host:port (none if host is empty), false if it cannot be reached
+{
+	const ScopedLock lock(senderLock);
+	sender.disconnect();
+	hasOscTarget = host.isNotEmpty() && sender.connect(host, port);
+	return hasOscTarget || host.isEmpty();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+String StageProfiler::getSummary() const
+{
+	const ScopedLock lock(summaryLock);
+	return summary;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::addStageTime(const Stage stage, const int64 ticks)
+// Time spent in stage during current block, in getTicks ticks (negative if measured across cores
+// with unsynchronised counters: counted as 0)
+{
+	const int64 duration = jmax((int64)0, ticks);
+	StageCounters& stageCounters = counters[stage];
+
+	int bucket = 0;
+	for (uint64 t = (uint64)duration; t != 0 && bucket < numBuckets - 1; t >>= 1) { bucket++; }
+
+	stageCounters.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+	stageCounters.totalTicks.fetch_add(duration, std::memory_order_relaxed);
+	int64 maxTicks = stageCounters.maxTicks.load(std::memory_order_relaxed);
+	while (duration > maxTicks && !stageCounters.maxTicks.compare_exchange_weak(maxTicks, duration, std::memory_order_relaxed)) {}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::addCallbackTime(const int64 ticks, const int numSamples, const double sampleRate)
+// Whole audio callback, rendering numSamples samples: deadline missed if longer than their duration
+{
+	addStageTime(callback, ticks);
+	if (ticks > numSamples / sampleRate * getTicksPerSecond()) { deadlineMisses.fetch_add(1, std::memory_order_relaxed); }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+double StageProfiler::getTicksPerSecond()
+{
+#if JUCE_INTEL
+	// TSC rate, measured once against the high resolution counter
+	static const double ticksPerSecond = []()
+	{
+		const int64 startTicks = getTicks();
+		const int64 startCounter = Time::getHighResolutionTicks();
+		Thread::sleep(20);
+		const int64 endTicks = getTicks();
+		return (endTicks - startTicks) / Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startCounter);
+	}();
+	return ticksPerSecond;
+#else
+	return 1.0e9;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* StageProfiler::getStageName(const Stage stage)
+{
+	switch (stage)
+	{
+		case delayTaps: return "delayTaps";
+		case filterBank: return "filterBank";
+		case reverbTail: return "reverbTail";
+		case binauralEncoding: return "binauralEncoding";
+		case ambisonicEncoding: return "ambisonicEncoding";
+		case soundFieldRotation: return "soundFieldRotation";
+		case binauralDecoding: return "binauralDecoding";
+		case levelMeter: return "levelMeter";
+		case renderThreadWait: return "renderThreadWait";
+		case callback: return "callback";
+		default: return "";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::run()
+// Publisher thread: statistics of blocks timed over each publishInterval
+{
+	StageStats stats[numStages];
+	uint32 numDeadlineMisses = 0;
+	readStats(stats, numDeadlineMisses, 1.0); // blocks timed before enabling discarded
+	totalDeadlineMisses = 0;
+
+	int64 lastRead = Time::getHighResolutionTicks();
+	while (!threadShouldExit())
+	{
+		wait(publishInterval);
+		if (threadShouldExit()) { return; }
+
+		const int64 now = Time::getHighResolutionTicks();
+		const double intervalDuration = Time::highResolutionTicksToSeconds(now - lastRead);
+		lastRead = now;
+
+		readStats(stats, numDeadlineMisses, intervalDuration);
+		publish(stats, numDeadlineMisses, intervalDuration);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::readStats(StageStats* stats, uint32& numDeadlineMisses, const double intervalDuration)
+// Statistics of blocks timed since previous read, stats holding numStages entries (publisher thread).
+// Counters are read one by one: a block timed meanwhile may only be partly accounted for until next read.
+{
+	const double ticksToMicroseconds = 1.0e6 / getTicksPerSecond();
+
+	for (int s = 0; s < numStages; s++)
+	{
+		StageCounters& stageCounters = counters[s];
+		StageStats& stageStats = stats[s];
+
+		// histogram over interval (counters wrap around)
+		uint32 histogram[numBuckets];
+		stageStats.count = 0;
+		for (int b = 0; b < numBuckets; b++)
+		{
+			const uint32 total = stageCounters.histogram[b].load(std::memory_order_relaxed);
+			histogram[b] = total - previousHistograms[s][b];
+			previousHistograms[s][b] = total;
+			stageStats.count += histogram[b];
+		}
+		const int64 totalTicks = stageCounters.totalTicks.load(std::memory_order_relaxed);
+		const int64 ticks = totalTicks - previousTotalTicks[s];
+		previousTotalTicks[s] = totalTicks;
+
+		stageStats.max = stageCounters.maxTicks.exchange(0, std::memory_order_relaxed) * ticksToMicroseconds;
+		stageStats.mean = stageStats.count > 0 ? ticks * ticksToMicroseconds / stageStats.count : 0.0;
+		stageStats.load = ticks * ticksToMicroseconds * 1.0e-6 / intervalDuration;
+
+		// 99th percentile: upper bound of the bucket it falls in (at most max)
+		stageStats.p99 = 0.0;
+		const uint64 rank = ((uint64)stageStats.count * 99 + 99) / 100;
+		uint64 cumulatedCount = 0;
+		for (int b = 0; b < numBuckets && stageStats.count > 0; b++)
+		{
+			cumulatedCount += histogram[b];
+			if (cumulatedCount < rank) { continue; }
+			stageStats.p99 = jmin(stageStats.max, (double)((int64)1 << b) * ticksToMicroseconds);
+			break;
+		}
+	}
+
+	const uint32 misses = deadlineMisses.load(std::memory_order_relaxed);
+	numDeadlineMisses = misses - previousDeadlineMisses;
+	previousDeadlineMisses = misses;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StageProfiler::publish(const StageStats* stats, const uint32 numDeadlineMisses, const double intervalDuration)
+// Send OSC /stats message and update text summary. Message arguments: interval duration (s),
+// callbacks, deadline misses over interval, deadline misses since enabled, then for each stage:
+// name, blocks timed, mean, 99th percentile and max time per block (us), load (time over interval)
+{
+	totalDeadlineMisses += numDeadlineMisses;
+
+	{
+		const ScopedLock lock(senderLock);
+		if (hasOscTarget)
+		{
+			OSCMessage message("/stats");
+			message.addFloat32((float)intervalDuration);
+			message.addInt32((int32)stats[callback].count);
+			message.addInt32((int32)numDeadlineMisses);
+			message.addInt32((int32)totalDeadlineMisses);
+			for (int s = 0; s < numStages; s++)
+			{
+				message.addString(getStageName((Stage)s));
+				message.addInt32((int32)stats[s].count);
+				message.addFloat32((float)stats[s].mean);
+				message.addFloat32((float)stats[s].p99);
+				message.addFloat32((float)stats[s].max);
+				message.addFloat32((float)stats[s].load);
+			}
+			sender.send(message);
+		}
+	}
+
+	// one line per stage timed over interval
+	String text = String::formatted("%d callbacks in %.1f s, %d deadline misses (%d since enabled)\n",
+		(int)stats[callback].count, intervalDuration, (int)numDeadlineMisses, (int)totalDeadlineMisses);
+	text += String::formatted("%-20s %10s %10s %10s %8s\n", "stage", "mean us", "p99 us", "max us", "load %");
+	for (int s = 0; s < numStages; s++)
+	{
+		if (stats[s].count == 0) { continue; }
+		text += String::formatted("%-20s %10.1f %10.1f %10.1f %8.1f\n", getStageName((Stage)s),
+			stats[s].mean, stats[s].p99, stats[s].max, 100.0 * stats[s].load);
+	}
+
+	{
+		const ScopedLock lock(summaryLock);
+		summary = text;
+	}
+	sendChangeMessage();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////